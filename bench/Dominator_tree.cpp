@@ -0,0 +1,108 @@
+// Time per group of building a dominator tree with the iterative algorithm,
+// with Lengauer-Tarjan and with AUTO picking between them, on CFGs of
+// growing size. See kIterativeDominatorPassLimit in IR/dominator_tree.h.
+//
+// Usage: sc_dominator_bench [max_group_count] [groups_per_size]
+
+#include "IR/dominator_tree.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace SiiIR;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+enum class Shape { TREE, CHAIN, LADDER };
+
+// TREE and CHAIN link the groups from the entry by a random spanning tree,
+// so every group is reachable, plus one random edge for every four groups.
+// A bushy tree is a CFG of many branches, a chain a CFG of long runs with
+// loops.
+//
+// LADDER is the worst case of the iterative algorithm: a chain where every
+// group also branches back to the one before, and the entry jumps to the
+// last group. The cycle is entered at both ends, so it is irreducible, and
+// each pass over the reverse postorder only moves the immediate dominator
+// of one more group up to the entry.
+FunctionPtr RandomFunction(size_t group_count, Shape shape, std::mt19937& mt) {
+  FunctionPtr func = std::make_shared<Function>();
+  for(size_t i = 0; i < group_count; ++i) {
+    func->basic_groups_.push_back(std::make_shared<BasicGroup>());
+  }
+  func->entry_ = func->basic_groups_[0].get();
+  auto link    = [&](size_t from, size_t to) {
+    BasicGroup* from_group = func->basic_groups_[from].get();
+    BasicGroup* to_group   = func->basic_groups_[to].get();
+    from_group->follows_.push_back(to_group);
+    to_group->precedes_.push_back(from_group);
+  };
+  for(size_t i = 1; i < group_count; ++i) {
+    link(shape == Shape::TREE ? mt() % i : i - 1, i);
+  }
+  if(shape == Shape::LADDER) {
+    for(size_t i = 2; i < group_count; ++i) {
+      link(i, i - 1);
+    }
+    link(0, group_count - 1);
+    return func;
+  }
+  for(size_t i = 0; i < group_count / 4; ++i) {
+    link(mt() % group_count, mt() % group_count);
+  }
+  return func;
+}
+
+double NanosecondsPerGroup(const std::vector<FrozenFunctionPtr>& funcs,
+                           DominatorAlgorithm                    algorithm) {
+  size_t groups = 0;
+  auto   start  = Clock::now();
+  for(const FrozenFunctionPtr& func: funcs) {
+    groups += BuildDominatorTree(*func, algorithm)->size();
+  }
+  std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+  return elapsed.count() / static_cast<double>(groups);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t max_group_count
+      = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 16;
+  size_t groups_per_size
+      = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1 << 20;
+
+  std::mt19937 mt(0);
+  const std::pair<Shape, const char*> shapes[] = {
+    { Shape::TREE, "tree" },
+    { Shape::CHAIN, "chain" },
+    { Shape::LADDER, "ladder" },
+  };
+  for(auto [shape, name]: shapes) {
+    std::cout << name
+              << " groups, iterative ns/group, lengauer-tarjan ns/group,"
+                 " auto ns/group\n";
+    for(size_t group_count = 4; group_count <= max_group_count;
+        group_count *= 2) {
+      std::vector<FunctionPtr>       funcs;
+      std::vector<FrozenFunctionPtr> frozen;
+      size_t function_count
+          = std::max<size_t>(groups_per_size / group_count, 1);
+      for(size_t i = 0; i < function_count; ++i) {
+        funcs.push_back(RandomFunction(group_count, shape, mt));
+        frozen.push_back(Freeze(*funcs.back()));
+      }
+      double iterative
+          = NanosecondsPerGroup(frozen, DominatorAlgorithm::ITERATIVE);
+      double lengauer_tarjan
+          = NanosecondsPerGroup(frozen, DominatorAlgorithm::LENGAUER_TARJAN);
+      double automatic = NanosecondsPerGroup(frozen, DominatorAlgorithm::AUTO);
+      std::cout << group_count << ", " << iterative << ", " << lengauer_tarjan
+                << ", " << automatic << "\n";
+    }
+  }
+  return 0;
+}
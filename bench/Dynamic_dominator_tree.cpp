@@ -0,0 +1,117 @@
+// Time per edge update of keeping a dominator tree current with
+// DynamicDominatorTree, against rebuilding it from scratch after each
+// update, on random CFGs of growing size. Updates insert a random edge or
+// delete one inserted before, so the CFG stays about the same size.
+//
+// An insertion only visits the groups it affects and the deeper groups on
+// the way to them. A deletion that changes the tree rebuilds the subtree
+// of the nearest common dominator of its two ends, which for random edges
+// is most of the tree.
+//
+// Usage: sc_dynamic_dominator_bench [max_group_count] [update_count]
+
+#include "IR/dynamic_dominator_tree.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <tuple>
+
+using namespace SiiIR;
+
+namespace {
+
+using Clock    = std::chrono::steady_clock;
+using Duration = std::chrono::duration<double, std::micro>;
+
+// A random spanning tree from the entry, so every group is reachable, plus
+// one random edge for every four groups.
+FunctionPtr RandomFunction(size_t group_count, std::mt19937& mt) {
+  FunctionPtr func = std::make_shared<Function>();
+  for(size_t i = 0; i < group_count; ++i) {
+    func->basic_groups_.push_back(std::make_shared<BasicGroup>());
+  }
+  func->entry_ = func->basic_groups_[0].get();
+  auto link    = [&](size_t from, size_t to) {
+    BasicGroup* from_group = func->basic_groups_[from].get();
+    BasicGroup* to_group   = func->basic_groups_[to].get();
+    from_group->follows_.push_back(to_group);
+    to_group->precedes_.push_back(from_group);
+  };
+  for(size_t i = 1; i < group_count; ++i) {
+    link(mt() % i, i);
+  }
+  for(size_t i = 0; i < group_count / 4; ++i) {
+    link(mt() % group_count, mt() % group_count);
+  }
+  return func;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t max_group_count
+      = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 16;
+  size_t update_count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 200;
+
+  std::mt19937 mt(0);
+  std::cout << "groups, insert us/update, delete us/update, "
+               "rebuild us/update"
+            << std::endl;
+  for(size_t group_count = 256; group_count <= max_group_count;
+      group_count *= 4) {
+    FunctionPtr          func = RandomFunction(group_count, mt);
+    DynamicDominatorTree dynamic(*Freeze(*func));
+    Duration             insert_time{ 0 };
+    Duration             delete_time{ 0 };
+    Duration             rebuild_time{ 0 };
+    size_t               insert_count = 0;
+    std::vector<std::pair<uint32_t, uint32_t>> inserted;
+    for(size_t i = 0; i < update_count; ++i) {
+      bool     insert = inserted.empty() || mt() % 2 == 0;
+      uint32_t from   = mt() % group_count;
+      uint32_t to     = mt() % group_count;
+      if(!insert) {
+        size_t index = mt() % inserted.size();
+        std::tie(from, to) = inserted[index];
+        inserted.erase(inserted.begin() + index);
+      }
+      BasicGroup* from_group = func->basic_groups_[from].get();
+      BasicGroup* to_group   = func->basic_groups_[to].get();
+      if(insert) {
+        inserted.push_back({ from, to });
+        from_group->follows_.push_back(to_group);
+        to_group->precedes_.push_back(from_group);
+      } else {
+        auto& follows  = from_group->follows_;
+        auto& precedes = to_group->precedes_;
+        follows.erase(std::find(follows.begin(), follows.end(), to_group));
+        precedes.erase(
+            std::find(precedes.begin(), precedes.end(), from_group));
+      }
+      func->cfg_changed();
+
+      auto start = Clock::now();
+      if(insert) {
+        dynamic.insert_edge(from, to);
+      } else {
+        dynamic.delete_edge(from, to);
+      }
+      dynamic.apply_updates();
+      auto middle = Clock::now();
+      BuildDominatorTree(*Freeze(*func));
+      auto end = Clock::now();
+      (insert ? insert_time : delete_time) += middle - start;
+      insert_count += insert;
+      rebuild_time += end - middle;
+    }
+    std::cout << group_count << ", "
+              << insert_time.count() / std::max<size_t>(insert_count, 1)
+              << ", "
+              << delete_time.count()
+                     / std::max<size_t>(update_count - insert_count, 1)
+              << ", " << rebuild_time.count() / update_count << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,94 @@
+// Time of placing phis for many variables on random CFGs of growing size:
+// building the IDF builder once, then one IDF per variable, each variable
+// defined in a few random groups.
+//
+// Usage: sc_IDF_bench [max_group_count] [variable_count]
+
+#include "IR/IDF_builder.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace SiiIR;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Groups linked from the entry by a random spanning tree plus one random
+// edge for every four groups, like in Dominator_tree.cpp.
+FunctionPtr RandomFunction(size_t group_count, std::mt19937& mt) {
+  FunctionPtr func = std::make_shared<Function>();
+  for(size_t i = 0; i < group_count; ++i) {
+    func->basic_groups_.push_back(std::make_shared<BasicGroup>());
+  }
+  func->entry_ = func->basic_groups_[0].get();
+  auto link    = [&](size_t from, size_t to) {
+    BasicGroup* from_group = func->basic_groups_[from].get();
+    BasicGroup* to_group   = func->basic_groups_[to].get();
+    from_group->follows_.push_back(to_group);
+    to_group->precedes_.push_back(from_group);
+  };
+  for(size_t i = 1; i < group_count; ++i) {
+    link(mt() % i, i);
+  }
+  for(size_t i = 0; i < group_count / 4; ++i) {
+    link(mt() % group_count, mt() % group_count);
+  }
+  return func;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t max_group_count
+      = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1 << 14;
+  size_t variable_count
+      = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 256;
+
+  std::mt19937 mt(0);
+  std::cout << "groups, build ms, IDF ms, batched IDF ms, phis\n";
+  for(size_t group_count = 64; group_count <= max_group_count;
+      group_count *= 4) {
+    FunctionPtr       func   = RandomFunction(group_count, mt);
+    FrozenFunctionPtr frozen = Freeze(*func);
+    std::vector<std::vector<uint32_t>>    def_indices(variable_count);
+    std::vector<std::vector<BasicGroup*>> def_groups(variable_count);
+    for(size_t i = 0; i < variable_count; ++i) {
+      for(size_t k = 0; k < 4; ++k) {
+        def_indices[i].push_back(mt() % group_count);
+        def_groups[i].push_back(frozen->groups_[def_indices[i].back()]);
+      }
+    }
+
+    auto                        start       = Clock::now();
+    std::unique_ptr<IDFBuilder> idf_builder = CreateIDFBuilder(frozen);
+    auto                        built       = Clock::now();
+    size_t                      phi_count   = 0;
+    for(const std::vector<BasicGroup*>& groups: def_groups) {
+      phi_count += idf_builder->get_IDF(groups).size();
+    }
+    auto one_by_one = Clock::now();
+    for(const std::vector<uint32_t>& phis: idf_builder->get_IDFs(def_indices)) {
+      phi_count -= phis.size();
+    }
+    auto batched = Clock::now();
+    if(phi_count != 0) {
+      std::cerr << "batched IDFs differ\n";
+      return 1;
+    }
+
+    std::chrono::duration<double, std::milli> build_time = built - start;
+    std::chrono::duration<double, std::milli> IDF_time   = one_by_one - built;
+    std::chrono::duration<double, std::milli> batch_time = batched - one_by_one;
+    size_t total = 0;
+    for(const std::vector<BasicGroup*>& groups: def_groups) {
+      total += idf_builder->get_IDF(groups).size();
+    }
+    std::cout << group_count << ", " << build_time.count() << ", "
+              << IDF_time.count() << ", " << batch_time.count() << ", "
+              << total << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,90 @@
+// Per instruction cost of walking the codes of a basic group, comparing the
+// RTTI based dereference the code list used to do with the static one and
+// with kind based dyn_cast.
+//
+// Usage: sc_ir_bench [code_count] [rounds]
+
+#include "IR/function.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+using namespace SiiIR;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+template<typename Body>
+double NanosecondsPerCode(size_t code_count, size_t rounds, Body body) {
+  auto start = Clock::now();
+  for(size_t i = 0; i < rounds; ++i) {
+    body();
+  }
+  std::chrono::duration<double, std::nano> elapsed = Clock::now() - start;
+  return elapsed.count() / static_cast<double>(code_count * rounds);
+}
+
+// Keep the optimizer from dropping the loops.
+volatile size_t g_sink;
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t code_count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+  size_t rounds     = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 100;
+
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), {}));
+  BasicGroup group;
+  auto address = ArenaNew<SiiIRAlloca>(ctx->arena_, 4, Type::Integer(32));
+  group.codes_.push_back(address);
+  for(size_t i = 1; i < code_count; ++i) {
+    if(i % 2 == 0) {
+      group.codes_.push_back(ArenaNew<SiiIRLoad>(ctx->arena_, address));
+    } else {
+      group.codes_.push_back(ArenaNew<SiiIRStore>(
+          ctx->arena_, ctx->constant(i, Type::Integer(32)), address));
+    }
+  }
+
+  auto& codes = group.codes_;
+  std::cout << "codes: " << code_count << ", rounds: " << rounds << "\n";
+
+  double rtti_deref = NanosecondsPerCode(code_count, rounds, [&] {
+    size_t sum = 0;
+    for(auto iter = codes.begin(); iter != codes.end(); ++iter) {
+      ListNode<SiiIRCode>& node = *iter;
+      sum += dynamic_cast<SiiIRCode*>(&node)->num_operands();
+    }
+    g_sink = sum;
+  });
+  double static_deref = NanosecondsPerCode(code_count, rounds, [&] {
+    size_t sum = 0;
+    for(auto iter = codes.begin(); iter != codes.end(); ++iter) {
+      sum += iter->num_operands();
+    }
+    g_sink = sum;
+  });
+  std::cout << "iterate, dynamic_cast:     " << rtti_deref << " ns/code\n";
+  std::cout << "iterate, static_cast:      " << static_deref << " ns/code\n";
+
+  double rtti_filter = NanosecondsPerCode(code_count, rounds, [&] {
+    size_t loads = 0;
+    for(auto& code: codes) {
+      loads += dynamic_cast<SiiIRLoad*>(&code) != nullptr;
+    }
+    g_sink = loads;
+  });
+  double kind_filter = NanosecondsPerCode(code_count, rounds, [&] {
+    size_t loads = 0;
+    for(auto& code: codes) {
+      loads += dyn_cast<SiiIRLoad>(&code) != nullptr;
+    }
+    g_sink = loads;
+  });
+  std::cout << "find loads, dynamic_cast:  " << rtti_filter << " ns/code\n";
+  std::cout << "find loads, dyn_cast:      " << kind_filter << " ns/code\n";
+
+  return 0;
+}
@@ -0,0 +1,105 @@
+// Time of promoting the locals of generated functions. Each function is a
+// run of diamonds, each branching on a load of a random local and storing
+// to random locals on both arms. Besides those variables, a function has
+// locals stored once in the entry and read anywhere, and scratch locals
+// stored and read inside a single group, like the temporaries of
+// expressions.
+//
+// Usage: sc_mem2reg_bench [function_count] [local_count] [group_count]
+
+#include "IR/Pass/memory_to_register.h"
+#include "IR/code_builder.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace SiiIR;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+FunctionPtr
+GenerateFunction(size_t local_count, size_t group_count, std::mt19937& mt) {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), { Type::Integer(32) }));
+  auto parameter = std::make_shared<ParameterValue>(Type::Integer(32));
+  ctx->parameters_.push_back(parameter);
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto one          = ctx->constant(1, Type::Integer(32));
+
+  // Variables first, then locals stored once, then scratch locals.
+  std::vector<SiiIRAllocaPtr> locals;
+  for(size_t i = 0; i < local_count; ++i) {
+    locals.push_back(code_builder->append_alloca(4, Type::Integer(32)));
+  }
+  size_t variable_count = std::max<size_t>(local_count / 3, 1);
+  size_t read_count     = std::max<size_t>(2 * local_count / 3, 1);
+  size_t next_scratch   = read_count;
+  for(size_t i = 0; i < read_count; ++i) {
+    code_builder->append_store(ctx->constant(i, Type::Integer(32)),
+                               locals[i]);
+  }
+  auto variable = [&]() { return locals[mt() % variable_count]; };
+  auto readable = [&]() { return locals[mt() % read_count]; };
+
+  // Head, two arms and the join for each diamond.
+  for(size_t i = 0; i < group_count / 3; ++i) {
+    auto then_label = std::make_shared<Label>();
+    auto else_label = std::make_shared<Label>();
+    auto join_label = std::make_shared<Label>();
+    auto condition
+        = code_builder->append_less_than(code_builder->append_load(readable()),
+                                         parameter);
+    code_builder->append_condition_branch(condition, then_label, else_label);
+    code_builder->append_label(then_label);
+    ValuePtr sum
+        = code_builder->append_add(code_builder->append_load(readable()), one);
+    if(next_scratch < local_count) {
+      code_builder->append_store(sum, locals[next_scratch]);
+      sum = code_builder->append_load(locals[next_scratch++]);
+    }
+    code_builder->append_store(sum, variable());
+    code_builder->append_goto(join_label);
+    code_builder->append_label(else_label);
+    code_builder->append_store(code_builder->append_load(readable()),
+                               variable());
+    code_builder->append_goto(join_label);
+    code_builder->append_label(join_label);
+  }
+  code_builder->append_return(code_builder->append_load(locals[0]));
+  return code_builder->finish_function(ctx, "f");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  size_t function_count
+      = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100;
+  size_t local_count = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 300;
+  size_t group_count = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1000;
+
+  std::mt19937             mt(0);
+  std::vector<FunctionPtr> corpus;
+  for(size_t i = 0; i < function_count; ++i) {
+    corpus.push_back(GenerateFunction(local_count, group_count, mt));
+  }
+
+  MemoryToRegisterPass pass;
+  auto                 start = Clock::now();
+  for(FunctionPtr& func: corpus) {
+    pass.run(func);
+  }
+  std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+  const MemoryToRegisterPass::Statistics& statistics = pass.statistics();
+  std::cout << "functions: " << function_count << ", locals: " << local_count
+            << ", groups: " << group_count << "\n"
+            << "ms per function: " << elapsed.count() / function_count
+            << ", phis: " << statistics.phi_count << "\n"
+            << "store only: " << statistics.store_only_count
+            << ", single group: " << statistics.single_group_count
+            << ", single store: " << statistics.single_store_count
+            << ", phi placement: " << statistics.promoted_count << "\n";
+  return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include "IR/function.h"
+
+namespace SiiIR {
+
+// Replace the predecessors of group, the i-th new predecessor taking the phi
+// sources of the source_of[i]-th old one. Phis are rebuilt to the new arity.
+void SetPredecessors(Function&                  func,
+                     BasicGroup&                group,
+                     std::vector<BasicGroup*>   precedes,
+                     const std::vector<size_t>& source_of);
+// Drop every edge from precede into group along with its phi sources.
+void RemovePredecessor(Function&         func,
+                       BasicGroup&       group,
+                       const BasicGroup* precede);
+
+// Remove the groups that cannot be reached from the entry, dropping their
+// phi sources from the groups they branch to. Returns the number of groups
+// removed.
+size_t RemoveUnreachableGroups(Function& func);
+
+// Whether the follow_index-th edge out of group leaves a group with several
+// followers for a group with several predecessors.
+bool IsCriticalEdge(const BasicGroup& group, size_t follow_index);
+// Put a new group holding only a goto on the follow_index-th edge out of
+// group and return it. Phis of the old follower keep their sources, now
+// coming from the new group. The new group is appended to the function.
+BasicGroup* SplitEdge(Function& func, BasicGroup& group, size_t follow_index);
+// Split every critical edge, or with only_phi_edges only those into a group
+// starting with phis, the edges copies are placed on when leaving SSA.
+// Returns the number of edges split.
+size_t SplitCriticalEdges(Function& func, bool only_phi_edges = false);
+
+}  // namespace SiiIR
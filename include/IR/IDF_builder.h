@@ -1,19 +1,30 @@
 #pragma once
 #include "IR/dominator_tree.h"
-#include "IR/function.h"
+#include "IR/frozen_function.h"
 #include <set>
 
 namespace SiiIR {
 struct IDFBuilder {
-  FunctionPtr func_;
+  FrozenFunctionPtr func_;
   virtual ~IDFBuilder() = default;
-  IDFBuilder(FunctionPtr func)
+  IDFBuilder(FrozenFunctionPtr func)
       : func_(std::move(func)) {}
   virtual DominatorTreePtr      get_dom()                                = 0;
   virtual std::set<BasicGroup*> get_DF(const BasicGroup*)                = 0;
   virtual std::set<BasicGroup*> get_IDF(const std::vector<BasicGroup*>&) = 0;
+  // Iterated dominance frontier of each set of defining groups, by group
+  // index, in ascending order. The sets share their scratch space, so phis
+  // for every variable of a function are placed without allocating per
+  // variable.
+  virtual std::vector<std::vector<uint32_t>>
+  get_IDFs(const std::vector<std::vector<uint32_t>>& def_groups) = 0;
 };
 
+// The frontiers are never stored: each IDF is found by walking the dominator
+// tree and the CFG edges leaving each subtree, in time linear in the size of
+// the function.
+std::unique_ptr<IDFBuilder> CreateIDFBuilder(FrozenFunctionPtr func);
+// Freezes func and works on the snapshot.
 std::unique_ptr<IDFBuilder> CreateIDFBuilder(FunctionPtr func);
 
 }  // namespace SiiIR
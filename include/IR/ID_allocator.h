@@ -10,13 +10,18 @@ struct Value;
 class IDAllocator {
 public:
   IDAllocator() {}
+  // Print the slot of values numbered by Function::renumber() directly.
+  // Values without a slot are numbered from slot_count on.
+  explicit IDAllocator(size_t slot_count)
+      : use_slots_(true)
+      , next_id_(slot_count) {}
   std::string alloc(const Value* v);
 
 private:
-  int64_t alloc_id(const Value* v) {
-    auto [iter, inserted] = allocated_ids_.insert({ v, allocated_ids_.size() });
-    return iter->second;
-  }
+  int64_t alloc_id(const Value* v);
+
+  bool                                      use_slots_ = false;
+  int64_t                                   next_id_   = 0;
   std::unordered_map<const Value*, int64_t> allocated_ids_;
 };
 
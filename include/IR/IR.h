@@ -1,9 +1,9 @@
 #pragma once
 #include <cstdint>
-#include <functional>
 
 #include "IR/use.h"
 #include "IR/value.h"
+#include "utils/arena.h"
 #include "utils/list.h"
 
 namespace SiiIR {
@@ -56,7 +56,6 @@ using SiiIRStorePtr              = std::shared_ptr<SiiIRStore>;
 using SiiIRLoadPtr               = std::shared_ptr<SiiIRLoad>;
 using SiiIRPhiPtr                = std::shared_ptr<SiiIRPhi>;
 using SiiIRReturnPtr             = std::shared_ptr<SiiIRReturn>;
-using UseSetter                  = std::function<void(ValuePtr)>;
 
 struct SiiIRCode : public ListNode<SiiIRCode>, public Value {
   SiiIRCodeKind kind_;
@@ -66,160 +65,200 @@ struct SiiIRCode : public ListNode<SiiIRCode>, public Value {
       : kind_(kind)
       , Value(ValueKind::INSTRUCTION, std::move(type)) {}
 
+  static bool classof(const Value* value) {
+    return value->kind_ == ValueKind::INSTRUCTION;
+  }
   std::string to_string(IDAllocator& id_allocator) const override;
   virtual ~SiiIRCode() = default;
+
+  // Copy of this code allocated from arena. The copy refers to the same
+  // operands, it carries neither a label nor a group.
+  virtual SiiIRCodePtr clone(const ArenaPtr& arena) const = 0;
+
+  size_t     num_operands() const { return num_operands_; }
+  Use&       operand(size_t index) { return operands_[index]; }
+  const Use& operand(size_t index) const { return operands_[index]; }
+  Use*       op_begin() { return operands_; }
+  Use*       op_end() { return operands_ + num_operands_; }
+  const Use* op_begin() const { return operands_; }
+  const Use* op_end() const { return operands_ + num_operands_; }
+
+  // Relink operand index in place to value.
+  void set_operand(size_t index, ValuePtr value) {
+    operands_[index].set(std::move(value));
+  }
+
+  // Whether this code is placed before other, both must be in the same list.
+  // Amortized O(1): codes carry gap numbered order indices, which are only
+  // recomputed for the whole list when an insertion ran out of gap.
+  bool comes_before(const SiiIRCode& other) const;
+
+  // Release every operand, this breaks reference cycles between codes when
+  // the function owning them is torn down.
+  void drop_all_references() {
+    for(Use* use = op_begin(); use != op_end(); ++use) {
+      use->set(nullptr);
+    }
+  }
+
+protected:
+  // Whether value is a code of the given kind, for classof of subclasses.
+  static bool IsCodeOfKind(const Value* value, SiiIRCodeKind kind) {
+    return classof(value)
+           && static_cast<const SiiIRCode*>(value)->kind_ == kind;
+  }
+
+  void init_operands(Use* operands, size_t num_operands) {
+    operands_     = operands;
+    num_operands_ = num_operands;
+    for(Use* use = op_begin(); use != op_end(); ++use) {
+      use->user_ = this;
+    }
+  }
+
+  Use*   operands_     = nullptr;
+  size_t num_operands_ = 0;
+
+private:
+  friend struct ListTraits<SiiIRCode>;
+  static constexpr uint64_t kNoOrder     = 0;
+  static constexpr uint64_t kOrderStride = uint64_t(1) << 20;
+
+  // Number every code of list kOrderStride apart.
+  static void renumber_order(const List<SiiIRCode>& list);
+
+  // Order index among the codes of the same list, kNoOrder when unknown.
+  mutable uint64_t order_ = kNoOrder;
 };
 
-struct SiiIRBinaryOperation : public SiiIRCode {
+// Gives a code linked into a list an order index between the indices of its
+// neighbours, or leaves it unknown when there is no gap left.
+template<>
+struct ListTraits<SiiIRCode> {
+  static void added_to_list(List<SiiIRCode>&                  list,
+                            const List<SiiIRCode>::IterType& iter);
+};
+
+// Code whose operands live inline in the code itself.
+template<size_t NumOperands>
+struct SiiIRCodeWithOperands : public SiiIRCode {
+  SiiIRCodeWithOperands(SiiIRCodeKind kind, TypePtr type)
+      : SiiIRCode(kind, std::move(type)) {
+    init_operands(operand_storage_, NumOperands);
+  }
+
+private:
+  Use operand_storage_[NumOperands];
+};
+
+struct SiiIRBinaryOperation : public SiiIRCodeWithOperands<2> {
   SiiIRBinaryOperation(SiiIRCodeKind kind,
                        ValuePtr      lhs,
                        ValuePtr      rhs,
                        TypePtr       type)
-      : SiiIRCode(kind, std::move(type))
-      , lhs_(NewUse(this, std::move(lhs)))
-      , rhs_(NewUse(this, std::move(rhs))) {
-    lhs_->value_->users_.push_back(lhs_);
-    rhs_->value_->users_.push_back(rhs_);
+      : SiiIRCodeWithOperands(kind, std::move(type)) {
+    set_operand(0, std::move(lhs));
+    set_operand(1, std::move(rhs));
   }
 
-  ~SiiIRBinaryOperation() {
-    lhs_->remove_from_parent();
-    rhs_->remove_from_parent();
+  Use&        lhs() { return operand(0); }
+  const Use&  lhs() const { return operand(0); }
+  Use&        rhs() { return operand(1); }
+  const Use&  rhs() const { return operand(1); }
+  static bool classof(const Value* value) {
+    if(!SiiIRCode::classof(value)) {
+      return false;
+    }
+    switch(static_cast<const SiiIRCode*>(value)->kind_) {
+    case SiiIRCodeKind::MUL:
+    case SiiIRCodeKind::DIV:
+    case SiiIRCodeKind::ADD:
+    case SiiIRCodeKind::SUB:
+    case SiiIRCodeKind::EQUAL:
+    case SiiIRCodeKind::NOT_EQUAL:
+    case SiiIRCodeKind::LESS_THAN:
+    case SiiIRCodeKind::LESS_EQUAL: return true;
+    default: return false;
+    }
   }
-
-  template<size_t Idx>
-  UseSetter use_setter() {
-    return [this](ValuePtr value) {
-      if constexpr(Idx == 0) {
-        lhs_->remove_from_parent();
-        lhs_ = NewUse(this, std::move(value));
-        lhs_->value_->users_.push_back(lhs_);
-      } else if constexpr(Idx == 1) {
-        rhs_->remove_from_parent();
-        rhs_ = NewUse(this, std::move(value));
-        rhs_->value_->users_.push_back(rhs_);
-      }
-    };
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    return ArenaNew<SiiIRBinaryOperation>(
+        arena, kind_, lhs().value_, rhs().value_, type_);
   }
-
   std::string to_string(IDAllocator& id_allocator) const override;
-  UsePtr      lhs_;
-  UsePtr      rhs_;
 };
 
-struct SiiIRUnaryOperation : public SiiIRCode {
-  SiiIRUnaryOperation(SiiIRCodeKind kind, ValuePtr operand)
-      : SiiIRCode(kind, operand->type_)
-      , operand_(NewUse(this, std::move(operand))) {
-    operand_->value_->users_.push_back(operand_);
+struct SiiIRUnaryOperation : public SiiIRCodeWithOperands<1> {
+  SiiIRUnaryOperation(SiiIRCodeKind kind, ValuePtr child)
+      : SiiIRCodeWithOperands(kind, child->type_) {
+    set_operand(0, std::move(child));
   }
 
-  ~SiiIRUnaryOperation() { operand_->remove_from_parent(); }
-
-  template<size_t Idx>
-  UseSetter use_setter() {
-    return [this](ValuePtr value) {
-      if constexpr(Idx == 0) {
-        operand_->remove_from_parent();
-        operand_ = NewUse(this, value);
-        operand_->value_->users_.push_back(operand_);
-      }
-    };
+  Use&        child() { return operand(0); }
+  const Use&  child() const { return operand(0); }
+  static bool classof(const Value* value) {
+    return IsCodeOfKind(value, SiiIRCodeKind::NEG);
+  }
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    return ArenaNew<SiiIRUnaryOperation>(arena, kind_, child().value_);
   }
-
   std::string to_string(IDAllocator& id_allocator) const override;
-  UsePtr      operand_;
 };
 
-struct SiiIRGoto : public SiiIRCode {
+struct SiiIRGoto : public SiiIRCodeWithOperands<1> {
   explicit SiiIRGoto(LabelPtr dest)
-      : SiiIRCode(SiiIRCodeKind::GOTO, nullptr)
-      , dest_label_(NewUse(this, std::move(dest))) {
-    if(dest_label_->value_) {
-      dest_label_->value_->users_.push_back(dest_label_);
-    }
+      : SiiIRCodeWithOperands(SiiIRCodeKind::GOTO, nullptr) {
+    set_operand(0, std::move(dest));
   }
 
-  ~SiiIRGoto() {
-    if(dest_label_->value_) {
-      dest_label_->remove_from_parent();
-    }
+  Use&        dest_label() { return operand(0); }
+  const Use&  dest_label() const { return operand(0); }
+  static bool classof(const Value* value) {
+    return IsCodeOfKind(value, SiiIRCodeKind::GOTO);
   }
-
-  template<size_t Idx>
-  UseSetter use_setter() {
-    return [this](ValuePtr value) {
-      if constexpr(Idx == 0) {
-        dest_label_->remove_from_parent();
-        dest_label_ = NewUse(this, std::move(value));
-        dest_label_->value_->users_.push_back(dest_label_);
-      }
-    };
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    return ArenaNew<SiiIRGoto>(arena, cast<Label>(dest_label().value_));
   }
-
   std::string to_string(IDAllocator& id_allocator) const override;
-  UsePtr      dest_label_;
 };
 
-struct SiiIRConditionBranch : public SiiIRCode {
+struct SiiIRConditionBranch : public SiiIRCodeWithOperands<3> {
   SiiIRConditionBranch(ValuePtr condition,
                        LabelPtr true_label,
                        LabelPtr false_label)
-      : SiiIRCode(SiiIRCodeKind::CONDITION_BRANCH, nullptr)
-      , condition_(NewUse(this, std::move(condition)))
-      , true_label_(NewUse(this, std::move(true_label)))
-      , false_label_(NewUse(this, std::move(false_label))) {
-    if(condition_->value_) {
-      condition_->value_->users_.push_back(condition_);
-    }
-    if(true_label_->value_) {
-      true_label_->value_->users_.push_back(true_label_);
-    }
-    if(false_label_->value_) {
-      false_label_->value_->users_.push_back(false_label_);
-    }
+      : SiiIRCodeWithOperands(SiiIRCodeKind::CONDITION_BRANCH, nullptr) {
+    set_operand(0, std::move(condition));
+    set_operand(1, std::move(true_label));
+    set_operand(2, std::move(false_label));
   }
 
-  template<size_t Idx>
-  UseSetter use_setter() {
-    return [this](ValuePtr value) {
-      if constexpr(Idx == 0) {
-        condition_->remove_from_parent();
-        condition_ = NewUse(this, value);
-        if(value) {
-          condition_->value_->users_.push_back(condition_);
-        }
-      } else if constexpr(Idx == 1) {
-        true_label_->remove_from_parent();
-        true_label_ = NewUse(this, value);
-        if(value) {
-          true_label_->value_->users_.push_back(true_label_);
-        }
-      } else if constexpr(Idx == 2) {
-        false_label_->remove_from_parent();
-        false_label_ = NewUse(this, value);
-        if(value) {
-          false_label_->value_->users_.push_back(false_label_);
-        }
-      }
-    };
-  }
-
-  ~SiiIRConditionBranch() {
-    condition_->remove_from_parent();
-    true_label_->remove_from_parent();
-    false_label_->remove_from_parent();
+  Use&        condition() { return operand(0); }
+  const Use&  condition() const { return operand(0); }
+  Use&        true_label() { return operand(1); }
+  const Use&  true_label() const { return operand(1); }
+  Use&        false_label() { return operand(2); }
+  const Use&  false_label() const { return operand(2); }
+  static bool classof(const Value* value) {
+    return IsCodeOfKind(value, SiiIRCodeKind::CONDITION_BRANCH);
+  }
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    return ArenaNew<SiiIRConditionBranch>(arena,
+                                           condition().value_,
+                                           cast<Label>(true_label().value_),
+                                           cast<Label>(false_label().value_));
   }
-
   std::string to_string(IDAllocator& id_allocator) const override;
-  UsePtr      condition_;
-  UsePtr      true_label_;
-  UsePtr      false_label_;
 };
 
 struct SiiIRNope : public SiiIRCode {
   SiiIRNope()
       : SiiIRCode(SiiIRCodeKind::NOPE, nullptr) {}
+  static bool classof(const Value* value) {
+    return IsCodeOfKind(value, SiiIRCodeKind::NOPE);
+  }
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    return ArenaNew<SiiIRNope>(arena);
+  }
   std::string to_string(IDAllocator& id_allocator) const override;
 };
 
@@ -228,6 +267,12 @@ struct SiiIRFunctionDefinition : public SiiIRCode {
       : SiiIRCode(SiiIRCodeKind::FUNCTION_DEFINITION, function->type_)
       , function_(std::move(function)) {}
 
+  static bool classof(const Value* value) {
+    return IsCodeOfKind(value, SiiIRCodeKind::FUNCTION_DEFINITION);
+  }
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    return ArenaNew<SiiIRFunctionDefinition>(arena, function_);
+  }
   std::string      to_string(IDAllocator& id_allocator) const override;
   FunctionValuePtr function_;
 };
@@ -237,149 +282,146 @@ struct SiiIRAlloca : public SiiIRCode {
       : SiiIRCode(SiiIRCodeKind::ALLOCA, Type::Pointer(type))
       , size_(size) {}
 
+  static bool classof(const Value* value) {
+    return IsCodeOfKind(value, SiiIRCodeKind::ALLOCA);
+  }
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    return ArenaNew<SiiIRAlloca>(arena, size_, Type::GetAimType(type_));
+  }
   std::string to_string(IDAllocator& id_allocator) const override;
   uint32_t    size_;
 };
 
-struct SiiIRLoad : public SiiIRCode {
+struct SiiIRLoad : public SiiIRCodeWithOperands<1> {
   SiiIRLoad(ValuePtr source_address)
-      : SiiIRCode(SiiIRCodeKind::LOAD, Type::GetAimType(source_address->type_))
-      , src_(NewUse(this, std::move(source_address))) {
-    src_->value_->users_.push_back(src_);
+      : SiiIRCodeWithOperands(SiiIRCodeKind::LOAD,
+                              Type::GetAimType(source_address->type_)) {
+    set_operand(0, std::move(source_address));
   }
 
-  ~SiiIRLoad() override { src_->remove_from_parent(); }
-
-  template<size_t Idx>
-  UseSetter use_setter() {
-    return [this](ValuePtr value) {
-      if constexpr(Idx == 0) {
-        src_->remove_from_parent();
-        src_ = NewUse(this, value);
-        if(value) {
-          src_->value_->users_.push_back(src_);
-        }
-      }
-    };
+  Use&        src() { return operand(0); }
+  const Use&  src() const { return operand(0); }
+  static bool classof(const Value* value) {
+    return IsCodeOfKind(value, SiiIRCodeKind::LOAD);
+  }
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    return ArenaNew<SiiIRLoad>(arena, src().value_);
   }
-
   std::string to_string(IDAllocator& id_allocator) const override;
-  UsePtr      src_;
 };
 
-struct SiiIRStore : public SiiIRCode {
+struct SiiIRStore : public SiiIRCodeWithOperands<2> {
   SiiIRStore(ValuePtr src, ValuePtr dest)
-      : SiiIRCode(SiiIRCodeKind::STORE, nullptr)
-      , src_(NewUse(this, std::move(src)))
-      , dest_(NewUse(this, std::move(dest))) {
-
-    src_->value_->users_.push_back(src_);
-    dest_->value_->users_.push_back(dest_);
+      : SiiIRCodeWithOperands(SiiIRCodeKind::STORE, nullptr) {
+    set_operand(0, std::move(src));
+    set_operand(1, std::move(dest));
   }
 
-  ~SiiIRStore() override {
-    src_->remove_from_parent();
-    dest_->remove_from_parent();
+  Use&        src() { return operand(0); }
+  const Use&  src() const { return operand(0); }
+  Use&        dest() { return operand(1); }
+  const Use&  dest() const { return operand(1); }
+  static bool classof(const Value* value) {
+    return IsCodeOfKind(value, SiiIRCodeKind::STORE);
   }
-
-  template<size_t Idx>
-  UseSetter use_setter() {
-    return [this](ValuePtr value) {
-      if constexpr(Idx == 0) {
-        src_->remove_from_parent();
-        src_ = NewUse(this, value);
-        src_->value_->users_.push_back(src_);
-      } else if constexpr(Idx == 1) {
-        dest_->remove_from_parent();
-        dest_ = NewUse(this, value);
-        dest_->value_->users_.push_back(dest_);
-      }
-    };
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    return ArenaNew<SiiIRStore>(arena, src().value_, dest().value_);
   }
-
   std::string to_string(IDAllocator& id_allocator) const override;
-  UsePtr      src_;
-  UsePtr      dest_;
 };
 
+// The i-th source of a phi comes from the i-th predecessor of its group. The
+// sources are kept in one contiguous block sized on construction, drawn from
+// the arena of the phi rather than allocated on their own. Without an arena
+// the block comes from the heap.
 struct SiiIRPhi : public SiiIRCode {
-  SiiIRPhi(ValuePtr variale_address, size_t src_size)
-      : SiiIRCode(SiiIRCodeKind::PHI, Type::GetAimType(variale_address->type_))
-      , src_list_(src_size, nullptr) {
-    for(int i = 0; i < src_size; i++) {
-      src_list_[i] = NewUse(this, variale_address);
-      src_list_[i]->value_->users_.push_back(src_list_[i]);
+  SiiIRPhi(const ArenaPtr& arena, ValuePtr variale_address, size_t src_size)
+      : SiiIRPhi(arena, Type::GetAimType(variale_address->type_), src_size) {
+    for(size_t i = 0; i < src_size; i++) {
+      set_operand(i, variale_address);
+    }
+  }
+
+  // Phi of type whose sources are all unset.
+  SiiIRPhi(const ArenaPtr& arena, TypePtr type, size_t src_size)
+      : SiiIRCode(SiiIRCodeKind::PHI, type)
+      , heap_sources_(arena == nullptr) {
+    Use* sources;
+    if(heap_sources_) {
+      sources = new Use[src_size];
+    } else {
+      sources = static_cast<Use*>(
+          arena->allocate(src_size * sizeof(Use), alignof(Use)));
+      std::uninitialized_default_construct_n(sources, src_size);
     }
+    init_operands(sources, src_size);
   }
 
-  void replace_src(size_t index, ValuePtr new_src) {
-    src_list_[index]->remove_from_parent();
-    src_list_[index] = NewUse(this, new_src);
-    src_list_[index]->value_->users_.push_back(src_list_[index]);
+  ~SiiIRPhi() override {
+    if(heap_sources_) {
+      delete[] op_begin();
+    } else {
+      std::destroy(op_begin(), op_end());
+    }
   }
 
-  ~SiiIRPhi() override {}
+  size_t      src_size() const { return num_operands(); }
+  Use&        src(size_t index) { return operand(index); }
+  const Use&  src(size_t index) const { return operand(index); }
+  void        replace_src(size_t index, ValuePtr new_src) {
+    set_operand(index, std::move(new_src));
+  }
+  static bool classof(const Value* value) {
+    return IsCodeOfKind(value, SiiIRCodeKind::PHI);
+  }
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    auto result = ArenaNew<SiiIRPhi>(arena, arena, type_, src_size());
+    for(size_t i = 0; i < src_size(); i++) {
+      result->set_operand(i, src(i).value_);
+    }
+    return result;
+  }
+  std::string to_string(IDAllocator& id_allocator) const override;
 
-  std::string         to_string(IDAllocator& id_allocator) const override;
-  std::vector<UsePtr> src_list_;
+private:
+  bool heap_sources_;
 };
 
-struct SiiIRReturn : public SiiIRCode {
+struct SiiIRReturn : public SiiIRCodeWithOperands<1> {
   SiiIRReturn(ValuePtr value)
-      : SiiIRCode(SiiIRCodeKind::RETURN, nullptr)
-      , result_(NewUse(this, value)) {
-    result_->value_->users_.push_back(result_);
+      : SiiIRCodeWithOperands(SiiIRCodeKind::RETURN, nullptr) {
+    set_operand(0, std::move(value));
   }
 
-  ~SiiIRReturn() override { result_->remove_from_parent(); }
-
-  template<size_t Idx>
-  UseSetter use_setter() {
-    return [this](ValuePtr value) {
-      if constexpr(Idx == 0) {
-        result_->remove_from_parent();
-        result_ = NewUse(this, value);
-        result_->value_->users_.push_back(result_);
-      }
-    };
+  Use&        result() { return operand(0); }
+  const Use&  result() const { return operand(0); }
+  static bool classof(const Value* value) {
+    return IsCodeOfKind(value, SiiIRCodeKind::RETURN);
+  }
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    return ArenaNew<SiiIRReturn>(arena, result().value_);
   }
-
   std::string to_string(IDAllocator& id_allocator) const override;
-  UsePtr      result_;
 };
 
-struct SiiIRAssign : public SiiIRCode {
+struct SiiIRAssign : public SiiIRCodeWithOperands<2> {
   SiiIRAssign(ValuePtr dest, ValuePtr src)
-      : SiiIRCode(SiiIRCodeKind::ASSIGN, dest->type_)
-      , dest_(NewUse(this, std::move(dest)))
-      , src_(NewUse(this, std::move(src))) {
-    dest_->value_->users_.push_back(dest_);
-    src_->value_->users_.push_back(src_);
+      : SiiIRCodeWithOperands(SiiIRCodeKind::ASSIGN, dest->type_) {
+    set_operand(0, std::move(dest));
+    set_operand(1, std::move(src));
   }
 
-  ~SiiIRAssign() override {
-    dest_->remove_from_parent();
-    src_->remove_from_parent();
+  Use&        dest() { return operand(0); }
+  const Use&  dest() const { return operand(0); }
+  Use&        src() { return operand(1); }
+  const Use&  src() const { return operand(1); }
+  static bool classof(const Value* value) {
+    return IsCodeOfKind(value, SiiIRCodeKind::ASSIGN);
   }
-
-  template<size_t Idx>
-  UseSetter use_setter() {
-    return [this](ValuePtr value) {
-      if constexpr(Idx == 0) {
-        dest_->remove_from_parent();
-        dest_ = NewUse(this, std::move(value));
-        dest_->value_->users_.push_back(dest_);
-      } else if constexpr(Idx == 1) {
-        src_->remove_from_parent();
-        src_ = NewUse(this, std::move(value));
-        src_->value_->users_.push_back(src_);
-      }
-    };
+  SiiIRCodePtr clone(const ArenaPtr& arena) const override {
+    return ArenaNew<SiiIRAssign>(arena, dest().value_, src().value_);
   }
-
   std::string to_string(IDAllocator& id_allocator) const override;
-  UsePtr      dest_;
-  UsePtr      src_;
 };
 
 }  // namespace SiiIR
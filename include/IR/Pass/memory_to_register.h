@@ -4,7 +4,44 @@
 namespace SiiIR {
 class MemoryToRegisterPass : public FunctionPass {
 public:
+  enum class PhiPlacement {
+    // A phi in every group of the IDF of the stores, minimal SSA.
+    MINIMAL,
+    // No phi for a variable never read before being stored in the same
+    // group, semi-pruned SSA.
+    SEMI_PRUNED,
+    // A phi only where the variable is live on entry, pruned SSA.
+    PRUNED,
+  };
+  // Variables are promoted by the first of these paths that applies.
+  struct Statistics {
+    // Never read, removed along with their stores.
+    size_t store_only_count    = 0;
+    // Read and stored in one group only, a load before the first store
+    // aside.
+    size_t single_group_count  = 0;
+    // Stored once, before every read.
+    size_t single_store_count  = 0;
+    // Through phi placement and renaming.
+    size_t promoted_count      = 0;
+    size_t phi_count           = 0;
+    // Phis of the IDF left out by the placement.
+    size_t avoided_phi_count   = 0;
+    // Loads of a pointer variable replaced beforehand by the only alloca it
+    // may point to, see AllocaPointsTo.
+    size_t resolved_load_count = 0;
+  };
+
+  explicit MemoryToRegisterPass(PhiPlacement placement = PhiPlacement::PRUNED)
+      : placement_(placement) {}
+
   void run(FunctionPtr& func) override;
+  // Summed over every function this pass ran on.
+  const Statistics& statistics() const { return statistics_; }
+
+private:
+  PhiPlacement placement_;
+  Statistics   statistics_;
 };
 
 }  // namespace SiiIR
@@ -0,0 +1,19 @@
+#pragma once
+#include "IR/Pass/function_pass.h"
+
+namespace SiiIR {
+// Removes the groups unreachable from the entry, then cleans up the CFG left
+// by code generation until nothing changes:
+//   - a condition branch whose targets are the same group becomes a goto,
+//   - jumps into a group holding only a goto are forwarded to its target,
+//   - a group is merged into its only predecessor when it is that
+//     predecessor's only follower, which also folds the entry trampoline
+//     into the first group.
+// Phis are kept consistent with the predecessor lists. The entry group
+// stays first and never gains predecessors.
+class SimplifyCFGPass : public FunctionPass {
+public:
+  void run(FunctionPtr& func) override;
+};
+
+}  // namespace SiiIR
@@ -0,0 +1,54 @@
+#pragma once
+#include "IR/function.h"
+
+namespace SiiIR {
+
+// Flow-insensitive, Andersen style points-to sets of the addresses of the
+// allocas of a function. An address flows from its alloca through stores
+// into other allocas and out of them again through loads. Any other value,
+// and any memory reached through one, is unknown to the analysis.
+//
+// The address of an alloca escapes when it reaches anything but a load, a
+// store to it, or a store into another alloca: an operand of any other
+// code, or memory the analysis does not know. What an escaped alloca holds
+// is unknown as well.
+//
+// Allocas are referred to by their index in allocas_, their order in the
+// entry group. The sets are sorted, with unknown() standing for any address
+// the analysis does not know. They go stale as soon as the function is
+// modified.
+struct AllocaPointsTo {
+  static constexpr uint32_t kNoIndex = UINT32_MAX;
+
+  std::vector<SiiIRAlloca*>          allocas_;
+  // Index of the alloca of each slot, kNoIndex for other values.
+  std::vector<uint32_t>              alloca_index_;
+  // Addresses each alloca may hold.
+  std::vector<std::vector<uint32_t>> contents_;
+  // Addresses each load may read, by slot, empty for other values.
+  std::vector<std::vector<uint32_t>> loaded_;
+  std::vector<bool>                  escaped_;
+  // Whether every access to each alloca may be made through the alloca
+  // itself: it does not escape, every load reading its address reads
+  // nothing else, and the allocas holding its address are promotable too.
+  std::vector<bool>                  promotable_;
+
+  size_t   alloca_count() const { return allocas_.size(); }
+  uint32_t unknown() const { return allocas_.size(); }
+  // Index of alloca, kNoIndex when it is not an alloca of the entry group.
+  uint32_t index(const Value& alloca) const {
+    return alloca.slot_ < alloca_index_.size() ? alloca_index_[alloca.slot_]
+                                               : kNoIndex;
+  }
+  // Index of the only alloca whose address load may read, kNoIndex when it
+  // may read another address or none. Reading nothing stored before is
+  // undefined, so the address may stand for the load.
+  uint32_t must_point_to(const SiiIRLoad& load) const;
+};
+
+using AllocaPointsToPtr = std::shared_ptr<const AllocaPointsTo>;
+
+// Renumbers func first.
+AllocaPointsToPtr BuildAllocaPointsTo(Function& func);
+
+}  // namespace SiiIR
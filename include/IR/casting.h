@@ -0,0 +1,85 @@
+#pragma once
+#include <cassert>
+#include <memory>
+#include <type_traits>
+
+namespace SiiIR {
+
+// LLVM style checked casts driven by the kind fields of the IR instead of
+// RTTI. A class takes part by providing `static bool classof(const Value*)`.
+//
+//   isa<SiiIRLoad>(value)      whether value is a load.
+//   cast<SiiIRLoad>(value)     value as a load, asserting that it is one.
+//   dyn_cast<SiiIRLoad>(value) value as a load, or null when it is not one.
+//
+// Every cast accepts pointers, references and std::shared_ptr and keeps the
+// constness of its argument.
+
+template<typename To, typename From>
+using CastResult = typename std::conditional<std::is_const<From>::value,
+                                             const To,
+                                             To>::type;
+
+template<typename T>
+struct IsSharedPtr : std::false_type {};
+template<typename T>
+struct IsSharedPtr<std::shared_ptr<T>> : std::true_type {};
+
+// Keeps pointers and std::shared_ptr away from the reference overloads.
+template<typename From>
+using EnableIfReferable = typename std::enable_if<
+    !std::is_pointer<From>::value
+    && !IsSharedPtr<typename std::remove_const<From>::type>::value>::type;
+
+template<typename To, typename From>
+bool isa(const From* value) {
+  return To::classof(value);
+}
+
+template<typename To,
+         typename From,
+         typename = EnableIfReferable<From>>
+bool isa(const From& value) {
+  return To::classof(&value);
+}
+
+template<typename To, typename From>
+bool isa(const std::shared_ptr<From>& value) {
+  return To::classof(value.get());
+}
+
+template<typename To, typename From>
+CastResult<To, From>* cast(From* value) {
+  assert(isa<To>(value) && "cast<To>() on a value of another kind");
+  return static_cast<CastResult<To, From>*>(value);
+}
+
+template<typename To, typename From, typename = EnableIfReferable<From>>
+CastResult<To, From>& cast(From& value) {
+  assert(isa<To>(value) && "cast<To>() on a value of another kind");
+  return static_cast<CastResult<To, From>&>(value);
+}
+
+template<typename To, typename From>
+std::shared_ptr<CastResult<To, From>>
+cast(const std::shared_ptr<From>& value) {
+  assert(isa<To>(value) && "cast<To>() on a value of another kind");
+  return std::static_pointer_cast<CastResult<To, From>>(value);
+}
+
+template<typename To, typename From>
+CastResult<To, From>* dyn_cast(From* value) {
+  return value != nullptr && isa<To>(value)
+             ? static_cast<CastResult<To, From>*>(value)
+             : nullptr;
+}
+
+template<typename To, typename From>
+std::shared_ptr<CastResult<To, From>>
+dyn_cast(const std::shared_ptr<From>& value) {
+  return value != nullptr && isa<To>(value)
+             ? std::static_pointer_cast<CastResult<To, From>>(value)
+             : nullptr;
+}
+
+}  // namespace SiiIR
@@ -1,6 +1,8 @@
 #pragma once
 #include "IR/IR.h"
+#include "IR/function.h"
 #include "IR/value.h"
+#include "utils/arena.h"
 
 namespace SiiIR {
 
@@ -42,7 +44,16 @@ public:
   virtual SiiIRStorePtr  append_store(ValuePtr source, ValuePtr dest_address)
       = 0;
   virtual std::shared_ptr<std::vector<SiiIRCodePtr>> finish() = 0;
+  // Function of ctx made of the codes appended so far.
+  virtual FunctionPtr finish_function(FunctionContextPtr ctx, std::string name)
+      = 0;
 };
 
-CodeBuilderPtr CreateCodeBuilder();
+// Codes are allocated from arena when given, usually the arena of the
+// FunctionContext the codes belong to.
+CodeBuilderPtr CreateCodeBuilder(ArenaPtr arena = nullptr);
+// Builder that places codes into basic groups as they are appended, so
+// finish_function() hands out the function without a BuildFunction() pass.
+// finish() still returns the codes as a flat list.
+CodeBuilderPtr CreateFunctionCodeBuilder(ArenaPtr arena);
 }  // namespace SiiIR
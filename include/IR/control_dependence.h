@@ -0,0 +1,43 @@
+#pragma once
+#include "IR/dominator_tree.h"
+
+namespace SiiIR {
+
+// Control dependences between the groups of a function. Group b depends on
+// group a when the branch ending a decides whether b runs: b post-dominates
+// a successor of a but does not strictly post-dominate a. Put differently,
+// b depends on the groups of its post-dominance frontier.
+//
+// Groups are referred to by their index in the snapshot the graph was built
+// from. Like the snapshot, the graph never changes once built.
+struct ControlDependenceGraph {
+  DominatorTreePtr      post_dominator_tree_;
+  // The groups each group depends on, and the groups depending on each
+  // group, CSR encoded like the edges of FrozenFunction.
+  std::vector<uint32_t> dependence_begin_;
+  std::vector<uint32_t> dependences_;
+  std::vector<uint32_t> dependent_begin_;
+  std::vector<uint32_t> dependents_;
+
+  size_t group_count() const { return dependence_begin_.size() - 1; }
+
+  // Groups whose branch decides whether group runs.
+  IndexRange dependences(uint32_t group) const {
+    return IndexRange(dependences_.data() + dependence_begin_[group],
+                      dependences_.data() + dependence_begin_[group + 1]);
+  }
+  // Groups whose running is decided by the branch ending group.
+  IndexRange dependents(uint32_t group) const {
+    return IndexRange(dependents_.data() + dependent_begin_[group],
+                      dependents_.data() + dependent_begin_[group + 1]);
+  }
+};
+
+using ControlDependenceGraphPtr = std::shared_ptr<const ControlDependenceGraph>;
+
+ControlDependenceGraphPtr
+BuildControlDependenceGraph(const FrozenFunction& func);
+// Freezes func and builds the graph from the snapshot.
+ControlDependenceGraphPtr BuildControlDependenceGraph(FunctionPtr func);
+
+}  // namespace SiiIR
@@ -1,30 +1,112 @@
 #pragma once
 
-#include "IR/function.h"
+#include "IR/frozen_function.h"
 
 namespace SiiIR {
-struct DominatorTreeNode {
-  DominatorTreeNode*              parent_ = nullptr;
-  size_t                          level   = 0;
-  std::vector<DominatorTreeNode*> children_;
-  BasicGroup*                     basic_group_;
-  DominatorTreeNode(BasicGroup* basic_group_node)
-      : basic_group_(basic_group_node) {}
-  DominatorTreeNode() = default;
-};
-using DominatorTreeNodePtr = std::shared_ptr<DominatorTreeNode>;
 
+// Dominator tree of the groups reachable from the entry, packed into flat
+// arrays indexed by group index, the same indices as the FrozenFunction it
+// was built from. Groups that are not reachable are not part of the tree:
+// they have no immediate dominator and no preorder number.
+//
+// Like the snapshot, a tree never changes once built.
 struct DominatorTree {
-  std::vector<DominatorTreeNodePtr> nodes_;
-  DominatorTreeNode*                root_;
+  static constexpr uint32_t kNoIndex = FrozenFunction::kNoIndex;
+
+  std::vector<BasicGroup*> groups_;
+  uint32_t                 root_ = 0;
+  // Parent of each group in the tree, kNoIndex for the root.
+  std::vector<uint32_t>    immediate_dominator_;
+  // Depth of each group in the tree, 0 for the root.
+  std::vector<uint32_t>    level_;
+  // Position of each group in a preorder and a postorder walk of the tree.
+  // a dominates b iff a comes first in preorder and last in postorder.
+  std::vector<uint32_t>    preorder_number_;
+  std::vector<uint32_t>    postorder_number_;
+  // Groups of the tree in preorder.
+  std::vector<uint32_t>    preorder_;
+  // Children of each group, CSR encoded like the edges of FrozenFunction.
+  std::vector<uint32_t>    child_begin_;
+  std::vector<uint32_t>    children_;
+  // An ancestor of each group. The distances follow the skew binary
+  // pattern, so any ancestor is reached in O(log n) jumps and parent steps.
+  std::vector<uint32_t>    jump_;
+
+  size_t group_count() const { return groups_.size(); }
+  size_t size() const { return preorder_.size(); }
+  bool   contains(uint32_t group) const {
+    return preorder_number_[group] != kNoIndex;
+  }
+  IndexRange children(uint32_t group) const {
+    return IndexRange(children_.data() + child_begin_[group],
+                      children_.data() + child_begin_[group + 1]);
+  }
 
-  DominatorTree(DominatorTreeNodePtr root)
-      : root_(root.get()) {
-    nodes_.push_back(root);
+  // Whether a dominates b, in O(1). A group dominates itself.
+  bool dominates(uint32_t a, uint32_t b) const {
+    return contains(a) && preorder_number_[a] <= preorder_number_[b]
+           && postorder_number_[b] <= postorder_number_[a];
+  }
+  bool strictly_dominates(uint32_t a, uint32_t b) const {
+    return a != b && dominates(a, b);
   }
+  // Deepest group dominating both a and b, in O(log n). kNoIndex when
+  // either of them is not part of the tree.
+  uint32_t nearest_common_dominator(uint32_t a, uint32_t b) const;
+
+  // Index of group, kNoIndex when it is not part of the function.
+  uint32_t group_index(const BasicGroup* group) const;
+  bool     dominates(const BasicGroup* a, const BasicGroup* b) const;
+};
+
+using DominatorTreePtr = std::shared_ptr<const DominatorTree>;
+
+// Fill in a tree from the immediate dominator of each group, kNoIndex for
+// root and for groups outside the tree. order lists the groups of the tree,
+// children come in that order.
+DominatorTreePtr
+PackDominatorTree(std::vector<BasicGroup*>     groups,
+                  uint32_t                     root,
+                  std::vector<uint32_t>        immediate_dominator,
+                  const std::vector<uint32_t>& order);
+
+enum class DominatorAlgorithm {
+  // ITERATIVE for up to kIterativeDominatorPassLimit passes,
+  // LENGAUER_TARJAN when it needs more.
+  AUTO,
+  // Cooper, Harvey and Kennedy. Quadratic in the worst case but light on
+  // memory and fast on the small CFGs most functions have.
+  ITERATIVE,
+  // Lengauer and Tarjan. Near linear whatever the shape of the CFG.
+  LENGAUER_TARJAN,
 };
 
-using DominatorTreePtr = std::shared_ptr<DominatorTree>;
+// From bench/Dominator_tree.cpp: the iterative algorithm is faster on
+// random bushy and chain-like CFGs at every size measured, up to 262144
+// groups, so AUTO does not pick by size. Its worst case is a matter of
+// shape: on the irreducible ladder of the benchmark every pass settles one
+// more group, and Lengauer-Tarjan wins from 16 groups on. Reducible CFGs
+// settle in about as many passes as their loops are deeply nested, so past
+// this many passes AUTO gives up and runs Lengauer-Tarjan instead.
+constexpr size_t kIterativeDominatorPassLimit = 8;
+
+DominatorTreePtr
+BuildDominatorTree(const FrozenFunction& func,
+                   DominatorAlgorithm    algorithm = DominatorAlgorithm::AUTO);
+// Freezes func and builds the tree from the snapshot.
+DominatorTreePtr
+BuildDominatorTree(FunctionPtr        func,
+                   DominatorAlgorithm algorithm = DominatorAlgorithm::AUTO);
 
-DominatorTreePtr BuildDominatorTree(FunctionPtr func);
+// Post-dominator tree of func, the dominator tree of its reversed CFG. The
+// root is a virtual exit of index func.group_count(), whose group is null,
+// that every group without successors leads to. So a function returning
+// from several groups still has one tree. Groups that cannot reach a
+// return, such as the groups of an endless loop, are not part of the tree.
+DominatorTreePtr BuildPostDominatorTree(
+    const FrozenFunction& func,
+    DominatorAlgorithm    algorithm = DominatorAlgorithm::AUTO);
+DominatorTreePtr
+BuildPostDominatorTree(FunctionPtr        func,
+                       DominatorAlgorithm algorithm = DominatorAlgorithm::AUTO);
 }  // namespace SiiIR
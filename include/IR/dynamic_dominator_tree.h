@@ -0,0 +1,100 @@
+#pragma once
+#include "IR/dominator_tree.h"
+
+namespace SiiIR {
+
+// Dominator tree kept up to date while a pass edits the CFG, instead of
+// rebuilding it after every change. Groups are referred to by index, the
+// indices of the snapshot the tree started from followed by the groups
+// added since.
+//
+// Edge updates are queued until apply_updates(), where an insertion and a
+// deletion of the same edge cancel out and the edges left are applied one
+// at a time, following Georgiadis et al., "An Experimental Study of Dynamic
+// Dominators", as LLVM does:
+//  - An insertion between groups of the tree runs a depth based search
+//    from the group the edge leads to. It visits the groups whose immediate
+//    dominator changes and the deeper groups on the way to them, and moves
+//    the former right below the nearest common dominator of the two ends.
+//  - An insertion reaching new groups runs semi-NCA over just those groups,
+//    then handles their edges into the tree as insertions.
+//  - A deletion leaves the tree alone when another predecessor of the
+//    group the edge leads to dominates the group it leaves. Otherwise it
+//    runs semi-NCA over the subtree of the nearest common dominator of the
+//    two ends, where every group whose immediate dominator may change
+//    lives, after dropping what became unreachable.
+// So insertions cost about as much as what they change, while a deletion
+// may cost a large part of a rebuild. See bench/Dynamic_dominator_tree.cpp.
+class DynamicDominatorTree {
+public:
+  static constexpr uint32_t kNoIndex = DominatorTree::kNoIndex;
+
+  explicit DynamicDominatorTree(const FrozenFunction& func);
+
+  // Add a group without edges, returns its index.
+  uint32_t add_group(BasicGroup* group);
+  void     insert_edge(uint32_t from, uint32_t to);
+  void     delete_edge(uint32_t from, uint32_t to);
+  void     apply_updates();
+
+  size_t   group_count() const { return groups_.size(); }
+  // Whether group is reachable from the root, as of the last applied batch.
+  bool     contains(uint32_t group) const {
+    return group == root_ || immediate_dominator_[group] != kNoIndex;
+  }
+  uint32_t immediate_dominator(uint32_t group) const {
+    return immediate_dominator_[group];
+  }
+  uint32_t level(uint32_t group) const { return level_[group]; }
+  // Walks up the tree, O(depth). Use tree() for many queries.
+  uint32_t nearest_common_dominator(uint32_t a, uint32_t b) const;
+  bool     dominates(uint32_t a, uint32_t b) const;
+
+  // Packed copy of the current tree, made again only after updates.
+  DominatorTreePtr tree();
+
+private:
+  struct Update {
+    uint32_t from;
+    uint32_t to;
+    bool     insert;
+  };
+
+  void apply_insert(uint32_t from, uint32_t to);
+  // Insertion of an edge between two groups of the tree.
+  void insert_reachable(uint32_t from, uint32_t to);
+  void apply_delete(uint32_t from, uint32_t to);
+  // Make the groups reachable from to, none of which was reachable before,
+  // part of the tree below from.
+  void insert_unreachable(uint32_t from, uint32_t to);
+  // Drop the subtree of group, which is no longer reachable.
+  void delete_unreachable(uint32_t group);
+  // Recompute the immediate dominators of the subtree of root, which still
+  // dominates all of it.
+  void recompute_subtree(uint32_t root);
+  // Find the immediate dominators of the groups reachable from root through
+  // groups marked with mark_, with semi-NCA, and link them below root.
+  void build_subtree(uint32_t root);
+  void set_immediate_dominator(uint32_t group, uint32_t dominator);
+  // The groups of the subtree of root, root first.
+  std::vector<uint32_t> subtree(uint32_t root) const;
+
+  std::vector<BasicGroup*>           groups_;
+  uint32_t                           root_;
+  std::vector<std::vector<uint32_t>> successors_;
+  std::vector<std::vector<uint32_t>> predecessors_;
+  std::vector<uint32_t>              immediate_dominator_;
+  std::vector<uint32_t>              level_;
+  std::vector<std::vector<uint32_t>> children_;
+  std::vector<Update>                pending_;
+  // mark_[group] == mark_epoch_ selects the groups build_subtree() may
+  // visit, or those an update has seen, without clearing the array between
+  // calls.
+  std::vector<uint32_t>              mark_;
+  uint32_t                           mark_epoch_ = 0;
+  // Scratch for build_subtree(), kNoIndex outside of it.
+  std::vector<uint32_t>              position_;
+  DominatorTreePtr                   packed_;
+};
+
+}  // namespace SiiIR
@@ -0,0 +1,97 @@
+#pragma once
+#include "IR/function.h"
+
+namespace SiiIR {
+
+// Contiguous run of indices inside one of the arrays of a FrozenFunction.
+class IndexRange {
+public:
+  IndexRange(const uint32_t* begin, const uint32_t* end)
+      : begin_(begin)
+      , end_(end) {}
+
+  const uint32_t* begin() const { return begin_; }
+  const uint32_t* end() const { return end_; }
+  size_t          size() const { return end_ - begin_; }
+  bool            empty() const { return begin_ == end_; }
+  uint32_t        operator[](size_t index) const { return begin_[index]; }
+
+private:
+  const uint32_t* begin_;
+  const uint32_t* end_;
+};
+
+// Read only snapshot of a Function packed into flat arrays, for analyses
+// that only read the CFG and the codes. Groups and codes are referred to by
+// their index, values by their slot. Edges of the CFG and operands of the
+// codes are CSR encoded: the entries of element i are [begin[i], begin[i+1])
+// of the packed array.
+//
+// A snapshot never changes once built, so it may be shared between threads.
+// It goes stale as soon as the function it was taken from is modified.
+struct FrozenFunction {
+  static constexpr uint32_t kNoIndex = UINT32_MAX;
+
+  // Groups in the order of Function::basic_groups_, so the index of a group
+  // is its BasicGroup::number_.
+  std::vector<BasicGroup*> groups_;
+  uint32_t                 entry_ = 0;
+  // Indices of the groups reachable from the entry, in reverse postorder.
+  std::vector<uint32_t>    reverse_postorder_;
+  std::vector<uint32_t>    code_begin_;
+  std::vector<uint32_t>    successor_begin_;
+  std::vector<uint32_t>    successors_;
+  std::vector<uint32_t>    predecessor_begin_;
+  std::vector<uint32_t>    predecessors_;
+
+  // Codes, group by group.
+  std::vector<SiiIRCodeKind> kinds_;
+  // Slot of the value a code defines, kNoIndex when it defines none.
+  std::vector<uint32_t>      code_slots_;
+  std::vector<uint32_t>      operand_begin_;
+  // Slot of each operand, kNoIndex for a missing operand.
+  std::vector<uint32_t>      operands_;
+
+  // Values are numbered by slot. Values without a slot of their own, such as
+  // constants, are numbered after the slots of the function in this order.
+  uint32_t                  function_slot_count_ = 0;
+  std::vector<const Value*> extra_values_;
+
+  size_t group_count() const { return groups_.size(); }
+  size_t code_count() const { return kinds_.size(); }
+  size_t value_count() const {
+    return function_slot_count_ + extra_values_.size();
+  }
+
+  IndexRange successors(uint32_t group) const {
+    return Range(successor_begin_, successors_, group);
+  }
+  IndexRange predecessors(uint32_t group) const {
+    return Range(predecessor_begin_, predecessors_, group);
+  }
+  IndexRange operands(uint32_t code) const {
+    return Range(operand_begin_, operands_, code);
+  }
+  // Indices [first, last) of the codes of group.
+  std::pair<uint32_t, uint32_t> codes(uint32_t group) const {
+    return { code_begin_[group], code_begin_[group + 1] };
+  }
+
+  // Index of group, kNoIndex when it is not part of the function.
+  uint32_t group_index(const BasicGroup* group) const;
+
+private:
+  static IndexRange Range(const std::vector<uint32_t>& begin,
+                          const std::vector<uint32_t>& packed,
+                          uint32_t                     index) {
+    return IndexRange(packed.data() + begin[index],
+                      packed.data() + begin[index + 1]);
+  }
+};
+
+using FrozenFunctionPtr = std::shared_ptr<const FrozenFunction>;
+
+// Snapshot func, renumbering its values first.
+FrozenFunctionPtr Freeze(Function& func);
+
+}  // namespace SiiIR
@@ -5,12 +5,25 @@
 namespace SiiIR {
 
 struct BasicGroup {
+  static constexpr uint32_t kNoNumber = UINT32_MAX;
+
   List<SiiIRCode> codes_;
 
   std::vector<BasicGroup*> precedes_;
   std::vector<BasicGroup*> follows_;
   LabelPtr                 label_;
+  // Position of this group in Function::basic_groups_, assigned together
+  // with the block orders of the function. Analyses key side tables on it.
+  uint32_t                 number_ = kNoNumber;
   std::string              to_string(IDAllocator&) const;
+
+  // Code at position index of codes_. The positions are indexed once and
+  // reused until codes_ changes.
+  SiiIRCode& code_at(size_t index);
+
+private:
+  std::vector<SiiIRCode*> positions_;
+  uint64_t                positions_version_ = 0;
 };
 
 using BasicGroupPtr = std::shared_ptr<BasicGroup>;
@@ -20,8 +33,43 @@ struct Function {
   std::vector<BasicGroupPtr> basic_groups_;
   BasicGroup*                entry_;
   std::string                name_;
+  // Number of slots handed out by renumber() and assign_slot().
+  uint32_t                   slot_count_ = 0;
+
+  // Drops every operand of every code first, so codes referring to each
+  // other (e.g. through phis of a loop) are released together.
+  ~Function();
+
+  // Give parameters, labels and every code defining a value a dense slot,
+  // group by group in layout order. Returns the number of slots.
+  uint32_t renumber();
+  // Slot for a value created after the last renumber().
+  uint32_t assign_slot(Value& value);
 
   std::string to_string(IDAllocator* id_allocator = nullptr) const;
+  // Arena new instructions of this function should be allocated from, null
+  // when the function has no context.
+  const ArenaPtr& arena() const;
+
+  // Groups reachable from entry_ in reverse postorder and in postorder of a
+  // depth first walk along follows_. Both are computed on first use, along
+  // with the group numbers, and cached until the CFG changes.
+  const std::vector<BasicGroup*>& reverse_postorder() const;
+  const std::vector<BasicGroup*>& postorder() const;
+  // Must be called after adding or removing groups, or editing follows_ or
+  // precedes_ of a group. The orders above are only rebuilt then.
+  void     cfg_changed() { cfg_epoch_++; }
+  uint64_t cfg_epoch() const { return cfg_epoch_; }
+
+private:
+  void update_orders() const;
+
+  uint64_t                         cfg_epoch_          = 0;
+  mutable uint64_t                 orders_epoch_       = 0;
+  mutable size_t                   orders_group_count_ = 0;
+  mutable bool                     orders_valid_       = false;
+  mutable std::vector<BasicGroup*> reverse_postorder_;
+  mutable std::vector<BasicGroup*> postorder_;
 };
 
 using FunctionPtr = std::shared_ptr<Function>;
@@ -29,6 +77,11 @@ using FunctionPtr = std::shared_ptr<Function>;
 FunctionPtr BuildFunction(std::vector<SiiIRCodePtr> codes,
                           FunctionContextPtr        ctx,
                           std::string               name);
-// TODO merge BasicGroup with its following BasicGroup when there is only one
+// Deep copy of func with a context of its own: groups, labels, parameters,
+// constants and codes are all duplicated, operands are remapped to the
+// copies. Values keep their slots, so both functions print the same. The
+// codes of the copy are allocated from one arena sized after the arena of
+// func.
+FunctionPtr CloneFunction(Function& func);
 
 }  // namespace SiiIR
@@ -1,6 +1,9 @@
 #pragma once
 #include "IR/type.h"
 #include "IR/value.h"
+#include "utils/arena.h"
+#include <map>
+#include <unordered_map>
 
 namespace SiiIR {
 struct FunctionContext;
@@ -8,9 +11,24 @@ typedef std::shared_ptr<FunctionContext> FunctionContextPtr;
 struct FunctionContext {
   TypePtr               function_type_;
   std::vector<ValuePtr> parameters_;
+  // Backing storage of every instruction created for this function.
+  ArenaPtr              arena_;
 
   FunctionContext(TypePtr function_type)
-      : function_type_(std::move(function_type)) {}
+      : function_type_(std::move(function_type))
+      , arena_(CreateArena()) {}
+  FunctionContext(TypePtr function_type, ArenaPtr arena)
+      : function_type_(std::move(function_type))
+      , arena_(std::move(arena)) {}
+
+  // Constants are uniqued per function, so that the users of a constant
+  // never span more than one function.
+  ConstantIntPtr constant(int64_t value, TypePtr type);
+  UndefValuePtr  undef(TypePtr type);
+
+private:
+  std::map<std::pair<TypePtr, int64_t>, ConstantIntPtr> constants_;
+  std::unordered_map<TypePtr, UndefValuePtr>            undefs_;
 };
 
 }  // namespace SiiIR
@@ -0,0 +1,72 @@
+#pragma once
+#include "IR/dominator_tree.h"
+
+namespace SiiIR {
+
+// Natural loop: the groups of a cycle entered only through its header,
+// which dominates all of them. Loops sharing a header are one loop.
+struct Loop {
+  static constexpr uint32_t kNoIndex = FrozenFunction::kNoIndex;
+
+  uint32_t              header_;
+  // Enclosing loop, kNoIndex for an outermost loop.
+  uint32_t              parent_ = kNoIndex;
+  // 1 for an outermost loop.
+  uint32_t              depth_  = 1;
+  // Groups with a back edge to the header.
+  std::vector<uint32_t> latches_;
+  // Groups of the loop and of the loops nested in it, header first.
+  std::vector<uint32_t> groups_;
+  // Loops directly nested in this one.
+  std::vector<uint32_t> children_;
+  // Edges from a group of the loop to a group outside of it.
+  std::vector<std::pair<uint32_t, uint32_t>> exits_;
+};
+
+// Loop forest of a function. Groups are referred to by their index in the
+// snapshot the forest was built from, loops by their index in loops_, where
+// an enclosing loop comes before the loops nested in it.
+//
+// A cycle that can be entered at several groups has no header dominating
+// it, so it is irreducible and not a loop. Its retreating edges are listed
+// instead; its groups belong to the innermost natural loop around it, if
+// any. Like the snapshot, the forest never changes once built.
+struct LoopInfo {
+  static constexpr uint32_t kNoIndex = FrozenFunction::kNoIndex;
+
+  DominatorTreePtr                           dominator_tree_;
+  std::vector<Loop>                          loops_;
+  // Innermost loop of each group, kNoIndex outside of every loop.
+  std::vector<uint32_t>                      loop_of_;
+  // Edges closing a cycle whose target does not dominate their source.
+  std::vector<std::pair<uint32_t, uint32_t>> irreducible_edges_;
+
+  size_t group_count() const { return loop_of_.size(); }
+  bool   reducible() const { return irreducible_edges_.empty(); }
+  // Number of loops around group, 0 outside of every loop.
+  uint32_t depth(uint32_t group) const {
+    return loop_of_[group] == kNoIndex ? 0 : loops_[loop_of_[group]].depth_;
+  }
+  bool is_header(uint32_t group) const {
+    return loop_of_[group] != kNoIndex
+           && loops_[loop_of_[group]].header_ == group;
+  }
+  // Whether group is part of loop or of a loop nested in it.
+  bool contains(uint32_t loop, uint32_t group) const;
+};
+
+using LoopInfoPtr = std::shared_ptr<const LoopInfo>;
+
+LoopInfoPtr BuildLoopInfo(const FrozenFunction& func);
+// Freezes func and builds the forest from the snapshot.
+LoopInfoPtr BuildLoopInfo(FunctionPtr func);
+
+// Give every loop of func a preheader: a group outside of the loop whose
+// only follower is the header and which is the only way into the loop.
+// Headers entered from a single group with no other follower already have
+// one. Elsewhere the edges into the header are redirected to a new group
+// placed right before it, with phis merging the sources those edges gave
+// the phis of the header. Returns the number of groups added.
+size_t InsertPreheaders(Function& func);
+
+}  // namespace SiiIR
@@ -1,11 +1,18 @@
 #pragma once
 #include <cstdint>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
 namespace SiiIR {
 struct Type;
-using TypePtr = std::shared_ptr<Type>;
+class TypeContext;
+// Types are interned by TypeContext and never die, so they are passed around
+// as plain pointers and two types are equal iff they are the same object.
+using TypePtr = const Type*;
 struct Type {
   enum class Kind {
     INT      = 0,
@@ -14,12 +21,13 @@ struct Type {
     FUNCTION = 3,
   };
   Kind kind_;
-  Type(Kind kind)
-      : kind_(kind) {}
-  bool operator!=(const Type& other) const {
-    return !(this->operator==(other));
-  }
-  virtual bool operator==(const Type&) const = 0;
+
+  Type(const Type&)            = delete;
+  Type& operator=(const Type&) = delete;
+  virtual ~Type()              = default;
+
+  bool operator==(const Type& other) const { return this == &other; }
+  bool operator!=(const Type& other) const { return this != &other; }
 
   static TypePtr Integer(size_t num_bits);
   static TypePtr Pointer(TypePtr aim_type, uint64_t offset_limit);
@@ -28,14 +36,20 @@ struct Type {
   static TypePtr Function(TypePtr              return_type,
                           std::vector<TypePtr> parameter_types);
   static TypePtr GetAimType(TypePtr pointer_type);
+
+protected:
+  Type(Kind kind)
+      : kind_(kind) {}
 };
 
 struct IntegerType : public Type {
   size_t num_bits_;
+
+private:
+  friend class TypeContext;
   IntegerType(size_t num_bits)
       : Type(Type::Kind::INT)
       , num_bits_(num_bits) {}
-  bool operator==(const Type&) const override;
 };
 
 struct PointerType : public Type {
@@ -47,39 +61,79 @@ struct PointerType : public Type {
   OffsetLimitKind offset_limit_kind_;
   uint64_t        offset_limit_;
 
+private:
+  friend class TypeContext;
   PointerType(TypePtr aim_type, uint64_t offset_limit)
       : Type(Type::Kind::POINTER)
-      , aim_type_(std::move(aim_type))
+      , aim_type_(aim_type)
       , offset_limit_kind_(OffsetLimitKind::kOffsetLimit)
       , offset_limit_(offset_limit) {}
 
   PointerType(TypePtr aim_type)
       : Type(Type::Kind::POINTER)
-      , aim_type_(std::move(aim_type))
+      , aim_type_(aim_type)
       , offset_limit_kind_(OffsetLimitKind::kOffsetUnLimit)
       , offset_limit_(0) {}
-
-  bool operator==(const Type&) const override;
 };
 
 struct ArrayType : public Type {
   TypePtr element_type_;
   int64_t element_count_;
+
+private:
+  friend class TypeContext;
   ArrayType(TypePtr element_type, int64_t element_count)
       : Type(Type::Kind::ARRAY)
-      , element_type_(std::move(element_type))
+      , element_type_(element_type)
       , element_count_(element_count) {}
-  bool operator==(const Type&) const override;
 };
 
 struct FunctionType : public Type {
   TypePtr              return_type_;
   std::vector<TypePtr> parameter_types_;
+
+private:
+  friend class TypeContext;
   FunctionType(TypePtr return_type, std::vector<TypePtr> parameter_types)
       : Type(Type::Kind::FUNCTION)
-      , return_type_(std::move(return_type))
+      , return_type_(return_type)
       , parameter_types_(std::move(parameter_types)) {}
-  bool operator==(const Type&) const override;
+};
+
+// Owner of every IR type. Structurally equal types are built only once, the
+// derived types are found by hashing the pointers of their components.
+class TypeContext {
+public:
+  static TypeContext& Global();
+
+  TypePtr integer(size_t num_bits);
+  TypePtr pointer(TypePtr aim_type, uint64_t offset_limit);
+  TypePtr pointer(TypePtr aim_type);
+  TypePtr array(TypePtr element_type, int64_t element_count);
+  TypePtr function(TypePtr return_type, std::vector<TypePtr> parameter_types);
+
+  size_t size() const;
+
+private:
+  using PointerKey
+      = std::tuple<TypePtr, PointerType::OffsetLimitKind, uint64_t>;
+  using ArrayKey    = std::pair<TypePtr, int64_t>;
+  using FunctionKey = std::vector<TypePtr>;
+
+  struct KeyHash {
+    size_t operator()(const PointerKey& key) const;
+    size_t operator()(const ArrayKey& key) const;
+    size_t operator()(const FunctionKey& key) const;
+  };
+
+  TypePtr intern(std::unique_ptr<Type> type);
+
+  mutable std::mutex                                mutex_;
+  std::vector<std::unique_ptr<Type>>                types_;
+  std::map<size_t, TypePtr>                         integers_;
+  std::unordered_map<PointerKey, TypePtr, KeyHash>  pointers_;
+  std::unordered_map<ArrayKey, TypePtr, KeyHash>    arrays_;
+  std::unordered_map<FunctionKey, TypePtr, KeyHash> functions_;
 };
 
 }  // namespace SiiIR
@@ -2,26 +2,24 @@
 
 #include "utils/list.h"
 
-#pragma once
-
 namespace SiiIR {
 
 struct SiiIRCode;
 struct Value;
-struct Use;
 using ValuePtr = std::shared_ptr<Value>;
-using UsePtr   = std::shared_ptr<Use>;
 
-struct Use : public ListNode<Use> {
-  Use(SiiIRCode* user, ValuePtr value)
-      : user_(user)
-      , value_(std::move(value)) { }
-  ~Use() {}
-  SiiIRCode*     user_;
-  const ValuePtr value_;
-};
+// An operand slot of a code. Uses are stored inline in the code owning them
+// and linked into the use list of the value they refer to.
+struct Use : public ListNode<Use, ListOwnership::kRaw> {
+  Use()
+      : user_(nullptr)
+      , value_(nullptr) {}
+  SiiIRCode* user_;
+  ValuePtr   value_;
 
-// Create a use only, would not add to the value's use list
-UsePtr NewUse(SiiIRCode* user, ValuePtr value);
+  // Point this use to value, moving it from the use list of the old value to
+  // the use list of the new one. value may be null.
+  void set(ValuePtr value);
+};
 
 }  // namespace SiiIR
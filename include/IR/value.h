@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "IR/ID_allocator.h"
+#include "IR/casting.h"
 #include "IR/type.h"
 #include "utils/list.h"
 
@@ -23,14 +24,15 @@ enum class ValueKind : uint32_t {
 struct Use;
 struct SiiIRCode;
 struct Value;
-struct ConstantValue;
+struct ConstantInt;
 struct FunctionValue;
 struct UndefValue;
 struct Label;
 struct LabelFuture;
+struct Function;
 using SiiIRCodePtr = std::shared_ptr<SiiIRCode>;
 typedef std::shared_ptr<Value>         ValuePtr;
-typedef std::shared_ptr<ConstantValue> ConstantValuePtr;
+typedef std::shared_ptr<ConstantInt>   ConstantIntPtr;
 typedef std::shared_ptr<FunctionValue> FunctionValuePtr;
 typedef std::shared_ptr<UndefValue>    UndefValuePtr;
 typedef std::shared_ptr<Label>         LabelPtr;
@@ -40,13 +42,19 @@ struct Value {
   explicit Value(ValueKind kind, TypePtr type)
       : kind_(kind)
       , type_(type) {}
+  static constexpr uint32_t kNoSlot = UINT32_MAX;
+
   ValueKind kind_;
   TypePtr   type_;
-  List<Use> users_;
+  // Dense index of this value inside its function, assigned by
+  // Function::renumber(). Passes key side tables on it.
+  uint32_t  slot_ = kNoSlot;
+  // Uses are owned by the instructions that hold them.
+  List<Use, ListOwnership::kRaw> users_;
 
   virtual std::string     to_string(IDAllocator& id_allocator) const = 0;
-  static ConstantValuePtr constant(const std::string& literal, TypePtr type);
-  static UndefValuePtr    undef(TypePtr type);
+  // Point every use of this value at value instead.
+  void                    replace_all_uses_with(const ValuePtr& value);
   static FunctionValuePtr
   Function(std::shared_ptr<std::vector<SiiIRCodePtr>> codes,
            FunctionContextPtr                         ctx,
@@ -58,23 +66,33 @@ struct ParameterValue : public Value {
   explicit ParameterValue(TypePtr type)
       : Value(ValueKind::PARAMETER, std::move(type)) {}
 
+  static bool classof(const Value* value) {
+    return value->kind_ == ValueKind::PARAMETER;
+  }
   std::string to_string(IDAllocator& id_allocator) const override;
 };
 
-struct ConstantValue : public Value {
-  explicit ConstantValue(const std::string& literal, TypePtr type)
-      : Value(ValueKind::CONSTANT, std::move(type))
-      , literal_(literal) {
-    kind_ = ValueKind::CONSTANT;
-  }
+// Integer constant. Use FunctionContext::constant() to get the uniqued
+// instance of a function instead of creating one directly.
+struct ConstantInt : public Value {
+  explicit ConstantInt(int64_t value, TypePtr type)
+      : Value(ValueKind::CONSTANT, type)
+      , value_(value) {}
 
+  static bool classof(const Value* value) {
+    return value->kind_ == ValueKind::CONSTANT;
+  }
   std::string to_string(IDAllocator& id_allocator) const override;
-  std::string literal_;
+  int64_t     value_;
 };
 
 struct UndefValue : public Value {
   explicit UndefValue(TypePtr type)
       : Value(ValueKind::UNDEF, std::move(type)) {}
+
+  static bool classof(const Value* value) {
+    return value->kind_ == ValueKind::UNDEF;
+  }
   std::string to_string(IDAllocator& id_allocator) const override;
 };
 
@@ -88,10 +106,16 @@ struct FunctionValue : public Value {
       , ctx_(std::move(ctx))
       , name_(std::move(name)) {}
 
+  static bool classof(const Value* value) {
+    return value->kind_ == ValueKind::FUNCTION;
+  }
   std::string to_string(IDAllocator& id_allocator) const override;
   std::shared_ptr<std::vector<SiiIRCodePtr>> codes_;
   FunctionContextPtr                         ctx_;
   std::string                                name_;
+  // Set instead of codes_ when the body was built straight into basic
+  // groups.
+  std::shared_ptr<SiiIR::Function>           body_;
 };
 
 struct Label : public Value {
@@ -100,6 +124,9 @@ struct Label : public Value {
       : Value(ValueKind::LABEL, nullptr)
       , dest_code_(dest) {}
 
+  static bool classof(const Value* value) {
+    return value->kind_ == ValueKind::LABEL;
+  }
   std::string to_string(IDAllocator& id_allocator) const override;
 };
 
@@ -9,5 +9,8 @@ public:
   virtual std::shared_ptr<std::vector<SiiIR::SiiIRCodePtr>> work() = 0;
 };
 
-std::unique_ptr<IRGenerator> CreateIRGenerator(ASTNodePtr abstract_syntax_tree);
+// With build_functions, function bodies are built straight into basic groups
+// and handed out in FunctionValue::body_ instead of FunctionValue::codes_.
+std::unique_ptr<IRGenerator> CreateIRGenerator(ASTNodePtr abstract_syntax_tree,
+                                               bool build_functions = false);
 }  // namespace front
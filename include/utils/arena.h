@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace SiiIR {
+
+// Bump allocator backing the IR of one function. Memory is only returned to
+// the system when the arena itself dies, so individual deallocations are
+// free and the whole IR of a function is released in bulk.
+class Arena {
+public:
+  static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+  explicit Arena(size_t block_size = kDefaultBlockSize)
+      : block_size_(block_size)
+      , current_(nullptr)
+      , end_(nullptr)
+      , allocated_bytes_(0) {}
+
+  Arena(const Arena&)            = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* allocate(size_t bytes, size_t alignment) {
+    uintptr_t current = reinterpret_cast<uintptr_t>(current_);
+    uintptr_t aligned = (current + alignment - 1) & ~(alignment - 1);
+    if(current_ == nullptr
+       || aligned + bytes > reinterpret_cast<uintptr_t>(end_)) {
+      // Oversized requests get a block of their own so that they do not
+      // waste the tail of the current block.
+      if(bytes + alignment > block_size_ / 4) {
+        blocks_.emplace_back(new char[bytes + alignment]);
+        uintptr_t start = reinterpret_cast<uintptr_t>(blocks_.back().get());
+        allocated_bytes_ += bytes;
+        return reinterpret_cast<void*>((start + alignment - 1)
+                                       & ~(alignment - 1));
+      }
+      new_block();
+      current = reinterpret_cast<uintptr_t>(current_);
+      aligned = (current + alignment - 1) & ~(alignment - 1);
+    }
+    current_ = reinterpret_cast<char*>(aligned + bytes);
+    allocated_bytes_ += bytes;
+    return reinterpret_cast<void*>(aligned);
+  }
+
+  size_t allocated_bytes() const { return allocated_bytes_; }
+  size_t block_count() const { return blocks_.size(); }
+
+private:
+  void new_block() {
+    blocks_.emplace_back(new char[block_size_]);
+    current_ = blocks_.back().get();
+    end_     = current_ + block_size_;
+  }
+
+  size_t                               block_size_;
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char*                                current_;
+  char*                                end_;
+  size_t                               allocated_bytes_;
+};
+
+using ArenaPtr = std::shared_ptr<Arena>;
+
+// Standard allocator drawing from an Arena. Every copy keeps the arena
+// alive, so objects created through std::allocate_shared may safely outlive
+// the function that created the arena.
+template<typename T>
+class ArenaAllocator {
+public:
+  using value_type = T;
+
+  explicit ArenaAllocator(ArenaPtr arena)
+      : arena_(std::move(arena)) {}
+
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other)
+      : arena_(other.arena()) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T*, size_t) {}
+
+  const ArenaPtr& arena() const { return arena_; }
+
+  template<typename U>
+  bool operator==(const ArenaAllocator<U>& other) const {
+    return arena_ == other.arena();
+  }
+
+  template<typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const {
+    return arena_ != other.arena();
+  }
+
+private:
+  ArenaPtr arena_;
+};
+
+// Create a shared object in arena, or on the heap when arena is null.
+template<typename T, typename... Args>
+std::shared_ptr<T> ArenaNew(const ArenaPtr& arena, Args&&... args) {
+  if(arena == nullptr) {
+    return std::make_shared<T>(std::forward<Args>(args)...);
+  }
+  return std::allocate_shared<T>(ArenaAllocator<T>(arena),
+                                 std::forward<Args>(args)...);
+}
+
+inline ArenaPtr CreateArena() { return std::make_shared<Arena>(); }
+
+}  // namespace SiiIR
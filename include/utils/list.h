@@ -1,23 +1,55 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
+#include <type_traits>
 
 namespace SiiIR {
-template<typename ValueType, typename ParentType, bool IsConst>
+
+// kShared: the list keeps its nodes alive, nodes are handed in and out as
+//          std::shared_ptr.
+// kRaw:    the list only links nodes owned elsewhere, a node unlinks itself
+//          when it is destroyed.
+enum class ListOwnership {
+  kShared = 0,
+  kRaw    = 1,
+};
+
+template<typename ValueType, ListOwnership Ownership, bool IsConst>
 class ListIterator;
-template<typename ValueType>
+template<typename ValueType, ListOwnership Ownership = ListOwnership::kShared>
 class List;
+template<typename ValueType, ListOwnership Ownership = ListOwnership::kShared>
+class ListNode;
 
+// Hooks a list calls on the values linked into it. Specialize to keep state
+// of the values in sync with their position.
 template<typename ValueType>
-class ListNode : public std::enable_shared_from_this<ListNode<ValueType>> {
+struct ListTraits {
+  template<typename ListType, typename IterType>
+  static void added_to_list(ListType&, const IterType&) {}
+};
+
+template<typename NodeType, ListOwnership Ownership>
+struct ListNodeOwner {
+  // The reference held by the list this node is linked into.
+  std::shared_ptr<NodeType> owner_;
+};
+
+template<typename NodeType>
+struct ListNodeOwner<NodeType, ListOwnership::kRaw> {};
+
+template<typename ValueType, ListOwnership Ownership>
+class ListNode
+    : public ListNodeOwner<ListNode<ValueType, Ownership>, Ownership> {
 private:
-  using ParentType = List<ValueType>;
-  friend class List<ValueType>;
-  friend class ListIterator<ValueType, ParentType, true>;
-  friend class ListIterator<ValueType, ParentType, false>;
-  ParentType*               parent_;
-  std::shared_ptr<ListNode> next_;
-  std::shared_ptr<ListNode> prev_;
+  using ParentType = List<ValueType, Ownership>;
+  friend class List<ValueType, Ownership>;
+  friend class ListIterator<ValueType, Ownership, true>;
+  friend class ListIterator<ValueType, Ownership, false>;
+  ParentType* parent_;
+  ListNode*   next_;
+  ListNode*   prev_;
 
 public:
   ListNode(ParentType* parent)
@@ -29,17 +61,26 @@ public:
       , next_(nullptr)
       , prev_(nullptr) {}
 
-  virtual ~ListNode() = default;
+  ListNode(const ListNode&)            = delete;
+  ListNode& operator=(const ListNode&) = delete;
+
+  virtual ~ListNode() {
+    if constexpr(Ownership == ListOwnership::kRaw) {
+      remove_from_parent();
+    }
+  }
 
-  ListIterator<ValueType, ParentType, false> get_iterator() {
-    return ListIterator<ValueType, ParentType, false>(this);
+  ListIterator<ValueType, Ownership, false> get_iterator() {
+    return ListIterator<ValueType, Ownership, false>(this);
   }
 
-  ListIterator<ValueType, ParentType, true> get_iterator() const {
-    return ListIterator<ValueType, ParentType, true>(this);
+  ListIterator<ValueType, Ownership, true> get_iterator() const {
+    return ListIterator<ValueType, Ownership, true>(
+        const_cast<ListNode*>(this));
   }
 
-  ParentType* get_parent() { return parent_; }
+  ParentType*       get_parent() { return parent_; }
+  const ParentType* get_parent() const { return parent_; }
   void        set_parent(ParentType* parent) { parent_ = parent; }
 
   void remove_from_parent() {
@@ -49,47 +90,52 @@ public:
   }
 };
 
-template<typename ValueType, typename ParentType, bool IsConst>
+// Every node but the sentinel is a ValueType, so dereferencing an iterator is
+// a plain static downcast.
+template<typename ValueType, ListOwnership Ownership, bool IsConst>
 class ListIterator {
 private:
-  ListNode<ValueType>* node_;
-  ListNode<ValueType>* next_;
-  ListNode<ValueType>* prev_;
+  using NodeType = ListNode<ValueType, Ownership>;
+  NodeType* node_;
+  NodeType* next_;
+  NodeType* prev_;
 
-  void update_node(ListNode<ValueType>* new_node) {
+  void update_node(NodeType* new_node) {
     node_ = new_node;
-    next_ = node_->next_.get();
-    prev_ = node_->prev_.get();
+    next_ = node_->next_;
+    prev_ = node_->prev_;
   }
 
-  friend struct ListNode<ValueType>;
-  friend class List<ValueType>;
-  ListIterator(ListNode<ValueType>* node)
+  friend class ListNode<ValueType, Ownership>;
+  friend class List<ValueType, Ownership>;
+  ListIterator(NodeType* node)
       : node_(node)
-      , next_(node->next_.get())
-      , prev_(node->prev_.get()) {}
+      , next_(node->next_)
+      , prev_(node->prev_) {}
 
 public:
   typename std::conditional<IsConst,
                             std::shared_ptr<const ValueType>,
                             std::shared_ptr<ValueType>>::type
   shared() const {
-    return std::dynamic_pointer_cast<ValueType>(node_->shared_from_this());
+    static_assert(Ownership == ListOwnership::kShared,
+                  "Only shared lists own their nodes");
+    return std::static_pointer_cast<ValueType>(node_->owner_);
   }
 
-  ListIterator<ValueType, ParentType, IsConst>& operator++() {
+  ListIterator& operator++() {
     update_node(next_);
     return *this;
   }
 
-  ListIterator<ValueType, ParentType, IsConst>& operator--() {
+  ListIterator& operator--() {
     update_node(prev_);
     return *this;
   }
 
   typename std::conditional<IsConst, const ValueType*, ValueType*>::type
   operator->() const {
-    return dynamic_cast<ValueType*>(node_);
+    return static_cast<ValueType*>(node_);
   }
 
   typename std::conditional<IsConst, const ValueType&, ValueType&>::type
@@ -98,55 +144,78 @@ public:
   }
 
   bool
-  operator==(const ListIterator<ValueType, ParentType, true>& other) const {
+  operator==(const ListIterator<ValueType, Ownership, true>& other) const {
     return node_ == other.node_;
   }
 
   bool
-  operator==(const ListIterator<ValueType, ParentType, false>& other) const {
+  operator==(const ListIterator<ValueType, Ownership, false>& other) const {
     return node_ == other.node_;
   }
 
   bool
-  operator!=(const ListIterator<ValueType, ParentType, true>& other) const {
+  operator!=(const ListIterator<ValueType, Ownership, true>& other) const {
     return node_ != other.node_;
   }
 
   bool
-  operator!=(const ListIterator<ValueType, ParentType, false>& other) const {
+  operator!=(const ListIterator<ValueType, Ownership, false>& other) const {
     return node_ != other.node_;
   }
+
+  template<typename, ListOwnership, bool>
+  friend class ListIterator;
 };
 
-template<typename ValueType>
+// Intrusive doubly linked list. Nodes are linked through raw pointers around
+// a sentinel embedded in the list, so linking and unlinking never touch a
+// reference count or the allocator.
+template<typename ValueType, ListOwnership Ownership>
 class List {
 public:
-  using ConstIterType = ListIterator<ValueType, List<ValueType>, true>;
-  using IterType      = ListIterator<ValueType, List<ValueType>, false>;
-  using NodeType      = ListNode<ValueType>;
+  using ConstIterType = ListIterator<ValueType, Ownership, true>;
+  using IterType      = ListIterator<ValueType, Ownership, false>;
+  using NodeType      = ListNode<ValueType, Ownership>;
+  using NodeHandle    = typename std::conditional<Ownership
+                                                   == ListOwnership::kShared,
+                                                   std::shared_ptr<NodeType>,
+                                                   NodeType*>::type;
 
   List()
       : size_(0) {
-    construct_dummy_head_and_tail();
+    sentinel_.next_ = &sentinel_;
+    sentinel_.prev_ = &sentinel_;
   }
 
+  List(const List&)            = delete;
+  List& operator=(const List&) = delete;
+
   List& operator=(List&& other) {
     break_down();
-    dummy_head_ = std::move(other.dummy_head_);
-    dummy_tail_ = std::move(other.dummy_tail_);
-    size_       = other.size_;
-    other.size_ = 0;
-    other.construct_dummy_head_and_tail();
+    if(other.size_ != 0) {
+      sentinel_.next_        = other.sentinel_.next_;
+      sentinel_.prev_        = other.sentinel_.prev_;
+      sentinel_.next_->prev_ = &sentinel_;
+      sentinel_.prev_->next_ = &sentinel_;
+      for(NodeType* node = sentinel_.next_; node != &sentinel_;
+          node           = node->next_) {
+        node->parent_ = this;
+      }
+    }
+    size_                 = other.size_;
+    other.size_           = 0;
+    version_++;
+    other.version_++;
+    other.sentinel_.next_ = &other.sentinel_;
+    other.sentinel_.prev_ = &other.sentinel_;
     return *this;
   }
 
   ~List() { break_down(); }
 
-  IterType begin() { return IterType(dummy_head_->next_.get()); }
+  IterType begin() { return IterType(sentinel_.next_); }
 
-  ConstIterType begin() const {
-    return ConstIterType(dummy_head_->next_.get());
-  }
+  ConstIterType begin() const { return ConstIterType(sentinel_.next_); }
 
   const ValueType& operator[](size_t index) const {
     auto iter = begin();
@@ -164,73 +233,88 @@ public:
     return *iter;
   }
 
-  IterType end() { return IterType(dummy_tail_.get()); }
-
-  ConstIterType end() const { return ConstIterType(dummy_tail_.get()); }
+  IterType end() { return IterType(&sentinel_); }
 
-  void push_back(std::shared_ptr<NodeType> node) {
-    insert_before(end(), std::move(node));
+  ConstIterType end() const {
+    return ConstIterType(const_cast<NodeType*>(&sentinel_));
   }
 
-  void push_front(std::shared_ptr<NodeType> node) {
-    insert_before(begin(), std::move(node));
-  }
+  void push_back(NodeHandle node) { insert_before(end(), std::move(node)); }
 
-  void insert_after(const IterType& iter, std::shared_ptr<NodeType> node) {
-    size_++;
-    NodeType& iter_node    = *iter.node_;
-    node->next_            = iter_node.next_;
-    node->prev_            = iter_node.next_->prev_;
-    iter_node.next_->prev_ = node;
-    iter_node.next_        = node;
-    node->set_parent(this);
+  void push_front(NodeHandle node) { insert_before(begin(), std::move(node)); }
+
+  void insert_after(const IterType& iter, NodeHandle node) {
+    NodeType* iter_node = iter.node_;
+    link(iter_node, iter_node->next_, std::move(node));
   }
 
-  void insert_before(const IterType& iter, std::shared_ptr<NodeType> node) {
-    size_++;
-    NodeType& iter_node    = *iter.node_;
-    node->next_            = iter_node.prev_->next_;
-    node->prev_            = iter_node.prev_;
-    iter_node.prev_->next_ = node;
-    iter_node.prev_        = node;
-    node->set_parent(this);
+  void insert_before(const IterType& iter, NodeHandle node) {
+    NodeType* iter_node = iter.node_;
+    link(iter_node->prev_, iter_node, std::move(node));
   }
 
-  std::shared_ptr<ListNode<ValueType>> erase(const IterType& iter) {
+  NodeHandle erase(const IterType& iter) {
     size_--;
-    NodeType&                            iter_node = *iter.node_;
-    std::shared_ptr<ListNode<ValueType>> result    = iter_node.next_->prev_;
-    iter_node.prev_->next_                         = iter_node.next_;
-    iter_node.next_->prev_                         = iter_node.prev_;
-    iter_node.next_.reset();
-    iter_node.prev_.reset();
-    iter_node.set_parent(nullptr);
-    return result;
+    version_++;
+    NodeType* iter_node     = iter.node_;
+    iter_node->prev_->next_ = iter_node->next_;
+    iter_node->next_->prev_ = iter_node->prev_;
+    iter_node->next_        = nullptr;
+    iter_node->prev_        = nullptr;
+    iter_node->set_parent(nullptr);
+    if constexpr(Ownership == ListOwnership::kShared) {
+      return std::move(iter_node->owner_);
+    } else {
+      return iter_node;
+    }
   }
 
   size_t size() const { return size_; }
 
+  bool empty() const { return size_ == 0; }
+
+  // Bumped whenever a node is linked or unlinked, so derived data such as
+  // an index of the nodes can tell when it is stale.
+  uint64_t version() const { return version_; }
+
 private:
-  void break_down() {
-    NodeType* current = dummy_head_.get();
-    while(current) {
-      NodeType* next = current->next_.get();
-      current->next_.reset();
-      current->prev_.reset();
-      current = next;
+  void link(NodeType* prev, NodeType* next, NodeHandle node) {
+    size_++;
+    version_++;
+    NodeType* raw_node = &*node;
+    raw_node->next_    = next;
+    raw_node->prev_    = prev;
+    prev->next_        = raw_node;
+    next->prev_        = raw_node;
+    raw_node->set_parent(this);
+    if constexpr(Ownership == ListOwnership::kShared) {
+      raw_node->owner_ = std::move(node);
     }
+    ListTraits<ValueType>::added_to_list(*this, IterType(raw_node));
   }
 
-  void construct_dummy_head_and_tail() {
-    dummy_head_        = std::make_shared<NodeType>(this);
-    dummy_tail_        = std::make_shared<NodeType>(this);
-    dummy_head_->next_ = dummy_tail_;
-    dummy_tail_->prev_ = dummy_head_;
+  // Detach every node at once. Owned nodes are released after they have
+  // been unlinked, so their destructors never observe a half-torn list.
+  void break_down() {
+    NodeType* current = sentinel_.next_;
+    sentinel_.next_   = &sentinel_;
+    sentinel_.prev_   = &sentinel_;
+    size_             = 0;
+    while(current != &sentinel_) {
+      NodeType* next   = current->next_;
+      current->next_   = nullptr;
+      current->prev_   = nullptr;
+      current->parent_ = nullptr;
+      if constexpr(Ownership == ListOwnership::kShared) {
+        current->owner_.reset();
+      }
+      current = next;
+    }
   }
 
-  std::shared_ptr<NodeType> dummy_head_;
-  std::shared_ptr<NodeType> dummy_tail_;
-  size_t                    size_;
+  NodeType sentinel_;
+  size_t   size_;
+  uint64_t version_ = 0;
 };
 
 }  // namespace SiiIR
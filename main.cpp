@@ -1,5 +1,6 @@
 #include "include/IR/Pass/memory_to_register.h"
 #include "include/IR/Pass/quit_SSA.h"
+#include "include/IR/Pass/simplify_CFG.h"
 #include "include/IR/function.h"
 #include "include/front/ASTPrinter.h"
 #include "include/front/IR_generator.h"
@@ -22,16 +23,14 @@ int main(int argc, char* argv[]) {
     }
     auto parser       = front::CreateParser(file_name, input);
     auto AST          = parser->work();
-    auto IR_generator = front::CreateIRGenerator(AST);
+    auto IR_generator = front::CreateIRGenerator(AST, true);
     auto IR_list      = IR_generator->work();
     for(auto& IR: *IR_list) {
       if(IR->kind_ == SiiIR::SiiIRCodeKind::FUNCTION_DEFINITION) {
         SiiIR::SiiIRFunctionDefinition* function_definition
             = static_cast<SiiIR::SiiIRFunctionDefinition*>(IR.get());
-        SiiIR::FunctionPtr func = SiiIR::BuildFunction(
-            std::move(*function_definition->function_->codes_),
-            std::move(function_definition->function_->ctx_),
-            std::move(function_definition->function_->name_));
+        SiiIR::FunctionPtr func = function_definition->function_->body_;
+        SiiIR::SimplifyCFGPass().run(func);
         SiiIR::MemoryToRegisterPass().run(func);
         SiiIR::QuitSSAPass().run(func);
         std::cout << func->to_string() << std::endl;
@@ -0,0 +1,168 @@
+#include "IR/CFG_utils.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace SiiIR {
+
+static bool HasPhis(const BasicGroup& group) {
+  return !group.codes_.empty()
+         && group.codes_.begin()->kind_ == SiiIRCodeKind::PHI;
+}
+
+void SetPredecessors(Function&                  func,
+                     BasicGroup&                group,
+                     std::vector<BasicGroup*>   precedes,
+                     const std::vector<size_t>& source_of) {
+  auto& codes = group.codes_;
+  for(auto iter = codes.begin();
+      iter != codes.end() && iter->kind_ == SiiIRCodeKind::PHI;
+      ++iter) {
+    SiiIRPhi& phi     = cast<SiiIRPhi>(*iter);
+    auto      rebuilt = ArenaNew<SiiIRPhi>(
+        func.arena(), func.arena(), phi.type_, precedes.size());
+    for(size_t i = 0; i < source_of.size(); i++) {
+      rebuilt->set_operand(i, phi.src(source_of[i]).value_);
+    }
+    rebuilt->group_ = &group;
+    rebuilt->slot_  = phi.slot_;
+    codes.insert_before(iter, rebuilt);
+    phi.replace_all_uses_with(rebuilt);
+    phi.drop_all_references();
+    codes.erase(iter);
+  }
+  group.precedes_ = std::move(precedes);
+  func.cfg_changed();
+}
+
+void RemovePredecessor(Function&         func,
+                       BasicGroup&       group,
+                       const BasicGroup* precede) {
+  std::vector<BasicGroup*> precedes;
+  std::vector<size_t>      source_of;
+  for(size_t i = 0; i < group.precedes_.size(); i++) {
+    if(group.precedes_[i] != precede) {
+      precedes.push_back(group.precedes_[i]);
+      source_of.push_back(i);
+    }
+  }
+  SetPredecessors(func, group, std::move(precedes), source_of);
+}
+
+size_t RemoveUnreachableGroups(Function& func) {
+  std::unordered_set<const BasicGroup*> reached       = { func.entry_ };
+  std::vector<BasicGroup*>              working_stack = { func.entry_ };
+  while(!working_stack.empty()) {
+    BasicGroup* group = working_stack.back();
+    working_stack.pop_back();
+    for(BasicGroup* follow: group->follows_) {
+      if(reached.insert(follow).second) {
+        working_stack.push_back(follow);
+      }
+    }
+  }
+  size_t removed_count = func.basic_groups_.size() - reached.size();
+  if(removed_count == 0) {
+    return 0;
+  }
+  // Phi sources of reachable groups may refer to codes of the removed ones,
+  // so they go first.
+  for(const BasicGroupPtr& group: func.basic_groups_) {
+    if(reached.count(group.get()) == 0) {
+      continue;
+    }
+    std::vector<BasicGroup*> precedes;
+    std::vector<size_t>      source_of;
+    for(size_t i = 0; i < group->precedes_.size(); i++) {
+      if(reached.count(group->precedes_[i]) != 0) {
+        precedes.push_back(group->precedes_[i]);
+        source_of.push_back(i);
+      }
+    }
+    if(precedes.size() != group->precedes_.size()) {
+      SetPredecessors(func, *group, std::move(precedes), source_of);
+    }
+  }
+  auto& groups = func.basic_groups_;
+  for(const BasicGroupPtr& group: groups) {
+    if(reached.count(group.get()) == 0) {
+      for(SiiIRCode& code: group->codes_) {
+        code.drop_all_references();
+      }
+      group->precedes_.clear();
+      group->follows_.clear();
+    }
+  }
+  groups.erase(std::remove_if(groups.begin(),
+                              groups.end(),
+                              [&](const BasicGroupPtr& group) {
+                                return reached.count(group.get()) == 0;
+                              }),
+               groups.end());
+  func.cfg_changed();
+  return removed_count;
+}
+
+bool IsCriticalEdge(const BasicGroup& group, size_t follow_index) {
+  return group.follows_.size() > 1
+         && group.follows_[follow_index]->precedes_.size() > 1;
+}
+
+BasicGroup* SplitEdge(Function& func, BasicGroup& group, size_t follow_index) {
+  BasicGroup* follow = group.follows_[follow_index];
+  // The k-th edge from group to follow is the k-th time group shows up among
+  // the predecessors of follow, and the k-th label operand of its branch.
+  size_t occurrence = std::count(group.follows_.begin(),
+                                 group.follows_.begin() + follow_index,
+                                 follow);
+  auto   precede    = follow->precedes_.begin();
+  for(size_t seen = 0;; ++precede) {
+    if(*precede == &group && seen++ == occurrence) {
+      break;
+    }
+  }
+
+  auto split    = std::make_shared<BasicGroup>();
+  split->label_ = std::make_shared<Label>();
+  func.assign_slot(*split->label_);
+  auto jump                 = ArenaNew<SiiIRGoto>(func.arena(), follow->label_);
+  jump->group_              = split.get();
+  split->label_->dest_code_ = jump.get();
+  split->codes_.push_back(jump);
+  split->precedes_.push_back(&group);
+  split->follows_.push_back(follow);
+  *precede                     = split.get();
+  group.follows_[follow_index] = split.get();
+
+  SiiIRCode& terminator  = *--group.codes_.end();
+  size_t     label_index = 0;
+  for(Use* use = terminator.op_begin(); use != terminator.op_end(); ++use) {
+    if(use->value_ != nullptr && isa<Label>(use->value_)
+       && label_index++ == follow_index) {
+      use->set(split->label_);
+      break;
+    }
+  }
+  func.basic_groups_.push_back(split);
+  func.cfg_changed();
+  return split.get();
+}
+
+size_t SplitCriticalEdges(Function& func, bool only_phi_edges) {
+  size_t split_count = 0;
+  // Groups made by splitting have a single follower, they are not visited.
+  size_t group_count = func.basic_groups_.size();
+  for(size_t i = 0; i < group_count; i++) {
+    BasicGroup& group = *func.basic_groups_[i];
+    for(size_t k = 0; k < group.follows_.size(); k++) {
+      if(!IsCriticalEdge(group, k)
+         || (only_phi_edges && !HasPhis(*group.follows_[k]))) {
+        continue;
+      }
+      SplitEdge(func, group, k);
+      split_count++;
+    }
+  }
+  return split_count;
+}
+
+}  // namespace SiiIR
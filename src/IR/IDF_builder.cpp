@@ -1,102 +1,164 @@
 #include "IR/IDF_builder.h"
 #include "IR/dominator_tree.h"
-#include <map>
-#include <queue>
-#include <set>
+#include <algorithm>
+#include <stdexcept>
 
 namespace SiiIR {
 
+// Sreedhar and Gao's algorithm on the DJ graph: the dominator tree (D
+// edges) plus the CFG edges that are not tree edges (J edges). y is in the
+// dominance frontier of x when a J edge leads to y from the subtree of x
+// and y is no deeper in the tree than x. Groups are taken deepest first, so
+// each subtree is walked once for the whole IDF.
 struct IDFBuilderImpl : public IDFBuilder {
-  std::map<const DominatorTreeNode*, std::set<DominatorTreeNode*>>
-      dominance_frontiers_;
-  std::map<const BasicGroup*, DominatorTreeNode*>
-                   bg_to_dominator_tree_node_map_;
   DominatorTreePtr dominator_tree_;
+  // Groups waiting to be visited, bucketed by level in the tree.
+  std::vector<std::vector<uint32_t>> buckets_;
+  // Stamped with epoch_ when a group is walked, added to the IDF or given as
+  // a defining group, so nothing is cleared between IDFs.
+  std::vector<uint32_t>              visited_;
+  std::vector<uint32_t>              in_IDF_;
+  std::vector<uint32_t>              defining_;
+  uint32_t                           epoch_ = 0;
+  std::vector<uint32_t>              worklist_;
 
-  IDFBuilderImpl(FunctionPtr func)
+  IDFBuilderImpl(FrozenFunctionPtr func)
       : IDFBuilder(std::move(func)) {
     initial();
   }
   void initial();
-  void build_dominance_frontiers_of_node(const DominatorTreeNode* node);
+  // Index of group, throws when group is unreachable or foreign.
+  uint32_t index_of(const BasicGroup* group) const;
+  // IDF of def_groups appended to result, unsorted.
+  void     compute(const std::vector<uint32_t>& def_groups,
+                   std::vector<uint32_t>&       result);
+
   DominatorTreePtr      get_dom() override { return dominator_tree_; }
   std::set<BasicGroup*> get_DF(const BasicGroup*) override;
   std::set<BasicGroup*> get_IDF(const std::vector<BasicGroup*>&) override;
+  std::vector<std::vector<uint32_t>>
+  get_IDFs(const std::vector<std::vector<uint32_t>>& def_groups) override;
 };
 
-static bool IsDominatorOf(const DominatorTreeNode* dom,
-                          const DominatorTreeNode* node) {
-  if (dom == node) { return false; }
-  while(node->level > dom->level) {
-    node = node->parent_;
-  }
-  return node == dom;
-}
-
 std::set<BasicGroup*> IDFBuilderImpl::get_DF(const BasicGroup* group) {
-  const DominatorTreeNode* node = bg_to_dominator_tree_node_map_.at(group);
-  std::set<BasicGroup*>    result;
-  for(const DominatorTreeNode* df_node: dominance_frontiers_.at(node)) {
-    result.insert(df_node->basic_group_);
+  // J edges out of the subtree of group to groups it does not strictly
+  // dominate. The subtree is a run of the preorder.
+  const DominatorTree&  tree  = *dominator_tree_;
+  uint32_t              index = index_of(group);
+  std::set<BasicGroup*> result;
+  for(uint32_t i = tree.preorder_number_[index];
+      i < tree.size() && tree.dominates(index, tree.preorder_[i]);
+      i++) {
+    for(uint32_t succ: func_->successors(tree.preorder_[i])) {
+      if(!tree.strictly_dominates(index, succ)) {
+        result.insert(func_->groups_[succ]);
+      }
+    }
   }
   return result;
 }
 
 std::set<BasicGroup*>
 IDFBuilderImpl::get_IDF(const std::vector<BasicGroup*>& groups) {
-  std::queue<DominatorTreeNode*> working_list;
-  std::set<DominatorTreeNode*>   IDF_set;
+  std::vector<uint32_t> def_groups;
   for(const BasicGroup* group: groups) {
-    working_list.push(bg_to_dominator_tree_node_map_.at(group));
-  }
-  while(!working_list.empty()) {
-    DominatorTreeNode* node = working_list.front();
-    working_list.pop();
-    for(DominatorTreeNode* df: dominance_frontiers_[node]) {
-      if(IDF_set.insert(df).second) {
-        working_list.push(df);
-      }
-    }
+    def_groups.push_back(index_of(group));
   }
+  std::vector<uint32_t> IDF;
+  compute(def_groups, IDF);
   std::set<BasicGroup*> result;
-  for(DominatorTreeNode* node: IDF_set) {
-    result.insert(node->basic_group_);
+  for(uint32_t group: IDF) {
+    result.insert(func_->groups_[group]);
   }
   return result;
 }
 
-void IDFBuilderImpl::initial() {
-  dominator_tree_ = BuildDominatorTree(func_);
-  // Init bg_to_dominator_tree_node_map_
-  for(const DominatorTreeNodePtr& node: dominator_tree_->nodes_) {
-    bg_to_dominator_tree_node_map_[node->basic_group_] = node.get();
+std::vector<std::vector<uint32_t>> IDFBuilderImpl::get_IDFs(
+    const std::vector<std::vector<uint32_t>>& def_groups) {
+  std::vector<std::vector<uint32_t>> result(def_groups.size());
+  for(size_t i = 0; i < def_groups.size(); i++) {
+    compute(def_groups[i], result[i]);
+    std::sort(result[i].begin(), result[i].end());
   }
-  build_dominance_frontiers_of_node(dominator_tree_->root_);
+  return result;
 }
 
-void IDFBuilderImpl::build_dominance_frontiers_of_node(
-    const DominatorTreeNode* node) {
-
-  BasicGroup* basic_group    = node->basic_group_;
-  dominance_frontiers_[node] = {};
-  for(BasicGroup* succ: basic_group->follows_) {
-    DominatorTreeNode* succ_node = bg_to_dominator_tree_node_map_.at(succ);
-    if(!IsDominatorOf(node, succ_node)) {
-      dominance_frontiers_[node].insert(succ_node);
+void IDFBuilderImpl::compute(const std::vector<uint32_t>& def_groups,
+                             std::vector<uint32_t>&       result) {
+  const DominatorTree& tree = *dominator_tree_;
+  epoch_++;
+  size_t level = 0;
+  for(uint32_t group: def_groups) {
+    if(!tree.contains(group)) {
+      throw std::out_of_range("Basic group is not in the dominator tree");
+    }
+    if(defining_[group] != epoch_) {
+      defining_[group] = epoch_;
+      buckets_[tree.level_[group]].push_back(group);
+      level = std::max<size_t>(level, tree.level_[group]);
     }
   }
-  for(DominatorTreeNode* child: node->children_) {
-    build_dominance_frontiers_of_node(child);
-    for(DominatorTreeNode* child_frontier: dominance_frontiers_.at(child)) {
-      if(!IsDominatorOf(node, child_frontier)) {
-        dominance_frontiers_[node].insert(child_frontier);
+  // Groups only get queued at the level being drained or above it, so the
+  // deepest non empty bucket never moves down.
+  for(size_t current = level + 1; current-- > 0;) {
+    std::vector<uint32_t>& bucket = buckets_[current];
+    while(!bucket.empty()) {
+      uint32_t root = bucket.back();
+      bucket.pop_back();
+      visited_[root] = epoch_;
+      worklist_.push_back(root);
+      while(!worklist_.empty()) {
+        uint32_t group = worklist_.back();
+        worklist_.pop_back();
+        for(uint32_t succ: func_->successors(group)) {
+          if(tree.immediate_dominator_[succ] == group
+             || tree.level_[succ] > current || in_IDF_[succ] == epoch_) {
+            continue;
+          }
+          in_IDF_[succ] = epoch_;
+          result.push_back(succ);
+          if(defining_[succ] != epoch_) {
+            buckets_[tree.level_[succ]].push_back(succ);
+          }
+        }
+        for(uint32_t child: tree.children(group)) {
+          if(visited_[child] != epoch_) {
+            visited_[child] = epoch_;
+            worklist_.push_back(child);
+          }
+        }
       }
     }
   }
 }
 
-std::unique_ptr<IDFBuilder> CreateIDFBuilder(FunctionPtr func) {
+uint32_t IDFBuilderImpl::index_of(const BasicGroup* group) const {
+  uint32_t index = func_->group_index(group);
+  if(index == FrozenFunction::kNoIndex || !dominator_tree_->contains(index)) {
+    throw std::out_of_range("Basic group is not in the dominator tree");
+  }
+  return index;
+}
+
+void IDFBuilderImpl::initial() {
+  dominator_tree_      = BuildDominatorTree(*func_);
+  size_t   group_count = func_->group_count();
+  uint32_t depth       = 0;
+  for(uint32_t group: dominator_tree_->preorder_) {
+    depth = std::max(depth, dominator_tree_->level_[group]);
+  }
+  buckets_.resize(dominator_tree_->size() == 0 ? 0 : depth + 1);
+  visited_.assign(group_count, 0);
+  in_IDF_.assign(group_count, 0);
+  defining_.assign(group_count, 0);
+}
+
+std::unique_ptr<IDFBuilder> CreateIDFBuilder(FrozenFunctionPtr func) {
   return std::make_unique<IDFBuilderImpl>(std::move(func));
 }
 
+std::unique_ptr<IDFBuilder> CreateIDFBuilder(FunctionPtr func) {
+  return CreateIDFBuilder(Freeze(*func));
+}
+
 }  // namespace SiiIR
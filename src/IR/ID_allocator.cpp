@@ -3,9 +3,20 @@
 
 namespace SiiIR {
 
+int64_t IDAllocator::alloc_id(const Value* v) {
+  if(use_slots_ && v->slot_ != Value::kNoSlot) {
+    return v->slot_;
+  }
+  auto [iter, inserted] = allocated_ids_.insert({ v, next_id_ });
+  if(inserted) {
+    next_id_++;
+  }
+  return iter->second;
+}
+
 std::string IDAllocator::alloc(const Value* v) {
   if(v->kind_ == ValueKind::CONSTANT) {
-    return static_cast<const ConstantValue*>(v)->literal_;
+    return std::to_string(cast<ConstantInt>(v)->value_);
   } else if(v->kind_ == ValueKind::UNDEF) {
     return "undef";
   } else if(v->kind_ == ValueKind::LABEL) {
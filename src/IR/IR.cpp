@@ -1,8 +1,50 @@
 #include "IR/IR.h"
 #include <map>
 #include <sstream>
+#include <stdexcept>
 
 namespace SiiIR {
+void ListTraits<SiiIRCode>::added_to_list(
+    List<SiiIRCode>& list, const List<SiiIRCode>::IterType& iter) {
+  // Exclusive bounds of the new index, kNoOrder stands for the list begin.
+  uint64_t lower = SiiIRCode::kNoOrder;
+  if(iter != list.begin()) {
+    auto prev = iter;
+    lower     = (--prev)->order_;
+    if(lower == SiiIRCode::kNoOrder) {
+      iter->order_ = SiiIRCode::kNoOrder;
+      return;
+    }
+  }
+  auto next = iter;
+  if(++next == list.end()) {
+    iter->order_ = lower + SiiIRCode::kOrderStride;
+    return;
+  }
+  uint64_t upper = next->order_;
+  iter->order_   = upper > lower + 1 ? lower + (upper - lower) / 2
+                                     : SiiIRCode::kNoOrder;
+}
+
+void SiiIRCode::renumber_order(const List<SiiIRCode>& list) {
+  uint64_t order = 0;
+  for(const SiiIRCode& code: list) {
+    order += kOrderStride;
+    code.order_ = order;
+  }
+}
+
+bool SiiIRCode::comes_before(const SiiIRCode& other) const {
+  const List<SiiIRCode>* list = get_parent();
+  if(list == nullptr || list != other.get_parent()) {
+    throw std::runtime_error("Ordering codes that are not in one list");
+  }
+  if(order_ == kNoOrder || other.order_ == kNoOrder) {
+    renumber_order(*list);
+  }
+  return order_ < other.order_;
+}
+
 std::string SiiIRCode::to_string(IDAllocator& id_allocator) const {
   std::stringstream result_str;
   if(label_ != nullptr) {
@@ -31,10 +73,12 @@ std::string SiiIRBinaryOperation::to_string(IDAllocator& id_allocator) const {
     error_str << "Unknown SiiIRCodeKind: " << static_cast<uint32_t>(kind_);
     throw std::runtime_error(error_str.str());
   }
-  auto operator_str = operator_str_iter->second;
-  return prefix + "  " + id_allocator.alloc(this) + " = "
-         + id_allocator.alloc(lhs_->value_.get()) + operator_str
-         + id_allocator.alloc(rhs_->value_.get()) + ";";
+  // Ids are handed out while printing, so operands are numbered in order.
+  std::string result = prefix + "  " + id_allocator.alloc(this) + " = ";
+  result += id_allocator.alloc(lhs().value_.get());
+  result += operator_str_iter->second;
+  result += id_allocator.alloc(rhs().value_.get()) + ";";
+  return result;
 }
 
 std::string SiiIRUnaryOperation::to_string(IDAllocator& id_allocator) const {
@@ -50,22 +94,23 @@ std::string SiiIRUnaryOperation::to_string(IDAllocator& id_allocator) const {
     error_str << "Unknown SiiIRCodeKind: " << static_cast<uint32_t>(kind_);
     throw std::runtime_error(error_str.str());
   }
-  auto operator_str = operator_str_iter->second;
-
-  return prefix + "  " + id_allocator.alloc(this) + " = " + operator_str
-         + id_allocator.alloc(operand_->value_.get()) + ";";
+  std::string result = prefix + "  " + id_allocator.alloc(this) + " = ";
+  result += operator_str_iter->second;
+  result += id_allocator.alloc(child().value_.get()) + ";";
+  return result;
 }
 
 std::string SiiIRConditionBranch::to_string(IDAllocator& id_allocator) const {
-  auto prefix = SiiIRCode::to_string(id_allocator);
-  return prefix + "  if " + id_allocator.alloc(condition_->value_.get())
-         + " goto " + id_allocator.alloc(true_label_->value_.get()) + " else "
-         + id_allocator.alloc(false_label_->value_.get()) + ";";
+  std::string result = SiiIRCode::to_string(id_allocator) + "  if ";
+  result += id_allocator.alloc(condition().value_.get()) + " goto ";
+  result += id_allocator.alloc(true_label().value_.get()) + " else ";
+  result += id_allocator.alloc(false_label().value_.get()) + ";";
+  return result;
 }
 
 std::string SiiIRGoto::to_string(IDAllocator& id_allocator) const {
   auto prefix = SiiIRCode::to_string(id_allocator);
-  return prefix + "  goto " + id_allocator.alloc(dest_label_->value_.get())
+  return prefix + "  goto " + id_allocator.alloc(dest_label().value_.get())
          + ";";
 }
 
@@ -80,27 +125,32 @@ SiiIRFunctionDefinition::to_string(IDAllocator& id_allocator) const {
 }
 
 std::string SiiIRAlloca::to_string(IDAllocator& id_allocator) const {
-  return SiiIRCode::to_string(id_allocator) + "  " + id_allocator.alloc(this)
-         + " = alloca size " + std::to_string(size_) + ";";
+  std::string result = SiiIRCode::to_string(id_allocator) + "  ";
+  result += id_allocator.alloc(this) + " = alloca size ";
+  result += std::to_string(size_) + ";";
+  return result;
 }
 
 std::string SiiIRLoad::to_string(IDAllocator& id_allocator) const {
-  return SiiIRCode::to_string(id_allocator) + "  " + id_allocator.alloc(this)
-         + " = load " + id_allocator.alloc(src_->value_.get()) + ";";
+  std::string result = SiiIRCode::to_string(id_allocator) + "  ";
+  result += id_allocator.alloc(this) + " = load ";
+  result += id_allocator.alloc(src().value_.get()) + ";";
+  return result;
 }
 
 std::string SiiIRStore::to_string(IDAllocator& id_allocator) const {
-  return SiiIRCode::to_string(id_allocator) + "  store "
-         + id_allocator.alloc(src_->value_.get()) + " to "
-         + id_allocator.alloc(dest_->value_.get()) + ";";
+  std::string result = SiiIRCode::to_string(id_allocator) + "  store ";
+  result += id_allocator.alloc(src().value_.get()) + " to ";
+  result += id_allocator.alloc(dest().value_.get()) + ";";
+  return result;
 }
 
 std::string SiiIRPhi::to_string(IDAllocator& id_allocator) const {
-  std::string result = SiiIRCode::to_string(id_allocator) + "  "
-                       + id_allocator.alloc(this) + " = phi( ";
-  for(size_t i = 0; i < src_list_.size(); ++i) {
-    result += id_allocator.alloc(src_list_[i]->value_.get());
-    if(i != src_list_.size() - 1) {
+  std::string result = SiiIRCode::to_string(id_allocator) + "  ";
+  result += id_allocator.alloc(this) + " = phi( ";
+  for(size_t i = 0; i < src_size(); ++i) {
+    result += id_allocator.alloc(src(i).value_.get());
+    if(i != src_size() - 1) {
       result += ", ";
     }
   }
@@ -110,13 +160,14 @@ std::string SiiIRPhi::to_string(IDAllocator& id_allocator) const {
 
 std::string SiiIRReturn::to_string(IDAllocator& id_allocator) const {
   return SiiIRCode::to_string(id_allocator) + "  return "
-         + id_allocator.alloc(result_->value_.get()) + ";";
+         + id_allocator.alloc(result().value_.get()) + ";";
 }
 
 std::string SiiIRAssign::to_string(IDAllocator& id_allocator) const {
-  return SiiIRCode::to_string(id_allocator) + "  "
-         + id_allocator.alloc(dest_->value_.get()) + " = "
-         + id_allocator.alloc(src_->value_.get()) + ";";
+  std::string result = SiiIRCode::to_string(id_allocator) + "  ";
+  result += id_allocator.alloc(dest().value_.get()) + " = ";
+  result += id_allocator.alloc(src().value_.get()) + ";";
+  return result;
 }
 
 }  // namespace SiiIR
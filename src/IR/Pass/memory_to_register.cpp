@@ -1,160 +1,203 @@
 #include "IR/Pass/memory_to_register.h"
+#include "IR/CFG_utils.h"
+#include "IR/alloca_points_to.h"
 #include "IR/IDF_builder.h"
 #include "IR/dominator_tree.h"
-#include <map>
-#include <set>
-#include <stack>
+#include <algorithm>
 #include <stdexcept>
 
 namespace SiiIR {
 
+// Whether address is only loaded from and stored to. Once it is stored
+// somewhere or used by any other code, accesses to the variable may go
+// through values that are not address itself.
 static bool CanVariableToRegister(const SiiIR::Value& address) {
   for(const auto& use: address.users_) {
-    if(use.user_->kind_ == SiiIRCodeKind::STORE) {
-      SiiIRStore* store = static_cast<SiiIRStore*>(use.user_);
-      if(store->src_->value_.get() == &address) {
+    if(SiiIRStore* store = dyn_cast<SiiIRStore>(use.user_)) {
+      if(store->src().value_.get() == &address) {
         return false;
       }
+    } else if(!isa<SiiIRLoad>(use.user_)) {
+      return false;
     }
   }
   return true;
 }
 
-// Insert phi for variable
-static void
-VariableMemoryToRegister(FunctionPtr&                func,
-                         ValuePtr                    variable_address,
-                         IDFBuilder*                 idf_builder,
-                         std::map<Value*, ValuePtr>& original_variable_map) {
-  std::vector<BasicGroup*> def_groups;
-  for(const auto& use: variable_address->users_) {
-    if(use.user_->kind_ == SiiIRCodeKind::STORE) {
-      SiiIRStore* store = static_cast<SiiIRStore*>(use.user_);
-      if(store->dest_->value_ == variable_address) {
-        def_groups.push_back(use.user_->group_);
-      }
+// Definition stacks of the promoted allocas, indexed by slot. The stack of
+// an alloca that is not promoted stays empty.
+using VariableRenameMap = std::vector<std::vector<ValuePtr>>;
+// Slot-indexed side table, null where there is no entry.
+using SlotValueMap = std::vector<ValuePtr>;
+
+static bool IsPromoted(const VariableRenameMap& variable_rename_map,
+                       const Value*             address) {
+  return address != nullptr && address->slot_ < variable_rename_map.size()
+         && !variable_rename_map[address->slot_].empty();
+}
+
+static const ValuePtr& Lookup(const SlotValueMap& map, const Value* value) {
+  static const ValuePtr kNotFound = nullptr;
+  if(value == nullptr || value->slot_ >= map.size()) {
+    return kNotFound;
+  }
+  return map[value->slot_];
+}
+
+// Indices of the groups storing to variable, in func.
+static std::vector<uint32_t> DefiningGroups(const Value&          variable,
+                                            const FrozenFunction& func) {
+  std::vector<uint32_t> def_groups;
+  for(const auto& use: variable.users_) {
+    SiiIRStore* store = dyn_cast<SiiIRStore>(use.user_);
+    if(store != nullptr && store->dest().value_.get() == &variable) {
+      def_groups.push_back(func.group_index(store->group_));
     }
   }
+  return def_groups;
+}
 
-  const std::set<BasicGroup*>& bg_to_insert_phis
-      = idf_builder->get_IDF(def_groups);
-  for(auto& bg: bg_to_insert_phis) {
-    auto phi
-        = std::make_shared<SiiIRPhi>(variable_address, bg->precedes_.size());
-    original_variable_map[phi.get()] = variable_address;
-    bg->codes_.push_front(phi);
+// Groups a variable is live into: the groups reading it before any store,
+// and the groups from which a path without stores leads to such a read.
+// Marks are epoch stamped, so nothing is cleared between variables.
+class LiveInGroups {
+public:
+  explicit LiveInGroups(const FrozenFunction& func)
+      : func_(func)
+      , defining_(func.group_count(), 0)
+      , live_in_(func.group_count(), 0)
+      , first_store_(func.group_count(), nullptr) {}
+
+  // Returns whether variable is read before being stored anywhere, in which
+  // case contains() holds for the groups it is live into.
+  bool compute(const Value&                 variable,
+               const std::vector<uint32_t>& def_groups);
+  bool contains(uint32_t group) const { return live_in_[group] == epoch_; }
+
+private:
+  const FrozenFunction&         func_;
+  std::vector<uint32_t>         defining_;
+  std::vector<uint32_t>         live_in_;
+  // First store to the variable in each defining group.
+  std::vector<const SiiIRCode*> first_store_;
+  uint32_t                      epoch_ = 0;
+  std::vector<uint32_t>         worklist_;
+};
+
+bool LiveInGroups::compute(const Value&                 variable,
+                           const std::vector<uint32_t>& def_groups) {
+  epoch_++;
+  for(uint32_t group: def_groups) {
+    defining_[group]    = epoch_;
+    first_store_[group] = nullptr;
   }
+  for(const auto& use: variable.users_) {
+    const SiiIRStore* store = dyn_cast<SiiIRStore>(use.user_);
+    if(store == nullptr || store->dest().value_.get() != &variable) {
+      continue;
+    }
+    const SiiIRCode*& first = first_store_[func_.group_index(store->group_)];
+    if(first == nullptr || store->comes_before(*first)) {
+      first = store;
+    }
+  }
+  for(const auto& use: variable.users_) {
+    const SiiIRLoad* load = dyn_cast<SiiIRLoad>(use.user_);
+    if(load == nullptr || load->src().value_.get() != &variable) {
+      continue;
+    }
+    uint32_t group = func_.group_index(load->group_);
+    if(live_in_[group] == epoch_
+       || (defining_[group] == epoch_
+           && first_store_[group]->comes_before(*load))) {
+      continue;
+    }
+    live_in_[group] = epoch_;
+    worklist_.push_back(group);
+  }
+  bool read_first = !worklist_.empty();
+  while(!worklist_.empty()) {
+    uint32_t group = worklist_.back();
+    worklist_.pop_back();
+    for(uint32_t predecessor: func_.predecessors(group)) {
+      if(live_in_[predecessor] != epoch_ && defining_[predecessor] != epoch_) {
+        live_in_[predecessor] = epoch_;
+        worklist_.push_back(predecessor);
+      }
+    }
+  }
+  return read_first;
 }
 
-static void ReplaceTemporary(UsePtr*                     use,
-                             std::map<Value*, ValuePtr>& temporary_rename_map) {
-  const ValuePtr& value_ptr = (*use)->value_;
-  if(temporary_rename_map.find(value_ptr.get()) != temporary_rename_map.end()) {
-    UsePtr old_use = *use;
-    old_use->remove_from_parent();
-    *use = NewUse(old_use->user_, temporary_rename_map[value_ptr.get()]);
-    (*use)->value_->users_.push_back(*use);
+// Insert phi for variable
+static void InsertPhis(FunctionPtr&                 func,
+                       ValuePtr                     variable_address,
+                       const std::vector<uint32_t>& phi_groups,
+                       const FrozenFunction&        frozen,
+                       SlotValueMap&                original_variable_map) {
+  for(uint32_t group: phi_groups) {
+    BasicGroup* bg  = frozen.groups_[group];
+    auto        phi = ArenaNew<SiiIRPhi>(func->arena(),
+                                         func->arena(),
+                                         variable_address,
+                                         bg->precedes_.size());
+    original_variable_map.resize(func->assign_slot(*phi) + 1);
+    original_variable_map[phi->slot_] = variable_address;
+    bg->codes_.push_front(phi);
   }
-  return;
 }
 
-// Rename variable to temporary
-static void
-RenamePass(DominatorTreeNode*                      current_node,
-           std::map<Value*, std::stack<ValuePtr>>& variable_rename_map,
-           std::map<Value*, ValuePtr>&             temporary_rename_map,
-           std::map<Value*, ValuePtr>&             original_variable_map,
-           FunctionContext&                        ctx) {
-  std::map<Value*, size_t> rename_count;
-  auto&                    code_list = current_node->basic_group_->codes_;
+// Rename the variables of one group, appending the slots of the variables
+// it defines to renamed_variables, to be popped once its subtree is done.
+// A load of a variable is replaced in place by the value reaching it, so
+// its users never see a temporary.
+static void RenameGroup(BasicGroup*            current_basic_group,
+                        VariableRenameMap&     variable_rename_map,
+                        const SlotValueMap&    original_variable_map,
+                        std::vector<uint32_t>& renamed_variables) {
+  auto& code_list = current_basic_group->codes_;
   for(auto iter = code_list.begin(); iter != code_list.end(); ++iter) {
     auto& code = *iter;
     switch(code.kind_) {
     case SiiIRCodeKind::PHI: {
-      SiiIRPhi& phi = static_cast<SiiIRPhi&>(code);
-      if(original_variable_map.find(&phi) == original_variable_map.end()) {
-        for(auto& src: phi.src_list_) {
-          ReplaceTemporary(&src, temporary_rename_map);
-        }
-        continue;
+      const ValuePtr& variable = Lookup(original_variable_map, &code);
+      if(variable != nullptr) {
+        variable_rename_map[variable->slot_].push_back(iter.shared());
+        renamed_variables.push_back(variable->slot_);
       }
-      ValuePtr variable = original_variable_map[&phi];
-      variable_rename_map[variable.get()].push(iter.shared());
-      rename_count[variable.get()]++;
       continue;
     }
     case SiiIRCodeKind::LOAD: {
-      SiiIRLoad& load   = static_cast<SiiIRLoad&>(code);
-      Value*     source = load.src_->value_.get();
-      if(variable_rename_map.find(source) != variable_rename_map.end()) {
-        temporary_rename_map[&load] = variable_rename_map[source].top();
+      SiiIRLoad& load   = cast<SiiIRLoad>(code);
+      Value*     source = load.src().value_.get();
+      if(IsPromoted(variable_rename_map, source)) {
+        load.replace_all_uses_with(variable_rename_map[source->slot_].back());
         code_list.erase(iter);
-      } else {
-        ReplaceTemporary(&load.src_, temporary_rename_map);
       }
       continue;
     }
     case SiiIRCodeKind::STORE: {
-      SiiIRStore& store         = static_cast<SiiIRStore&>(code);
-      Value*      dest_variable = store.dest_->value_.get();
-      if(variable_rename_map.find(dest_variable) == variable_rename_map.end()) {
-        ReplaceTemporary(&store.src_, temporary_rename_map);
-        continue;
+      SiiIRStore& store         = cast<SiiIRStore>(code);
+      Value*      dest_variable = store.dest().value_.get();
+      if(IsPromoted(variable_rename_map, dest_variable)) {
+        variable_rename_map[dest_variable->slot_].push_back(
+            store.src().value_);
+        renamed_variables.push_back(dest_variable->slot_);
+        code_list.erase(iter);
       }
-      ReplaceTemporary(&store.src_, temporary_rename_map);
-      variable_rename_map[dest_variable].push(store.src_->value_);
-      rename_count[dest_variable]++;
-      code_list.erase(iter);
-      continue;
-    }
-    case SiiIRCodeKind::ADD:
-    case SiiIRCodeKind::SUB:
-    case SiiIRCodeKind::MUL:
-    case SiiIRCodeKind::DIV:
-    case SiiIRCodeKind::EQUAL:
-    case SiiIRCodeKind::NOT_EQUAL:
-    case SiiIRCodeKind::LESS_THAN:
-    case SiiIRCodeKind::LESS_EQUAL: {
-      SiiIRBinaryOperation& binary_operation
-          = static_cast<SiiIRBinaryOperation&>(code);
-      ReplaceTemporary(&binary_operation.lhs_, temporary_rename_map);
-      ReplaceTemporary(&binary_operation.rhs_, temporary_rename_map);
-      continue;
-    }
-    case SiiIRCodeKind::NEG: {
-      SiiIRUnaryOperation& unary_operation
-          = static_cast<SiiIRUnaryOperation&>(code);
-      ReplaceTemporary(&unary_operation.operand_, temporary_rename_map);
-      continue;
-    }
-    case SiiIRCodeKind::CONDITION_BRANCH: {
-      SiiIRConditionBranch& condition_branch
-          = static_cast<SiiIRConditionBranch&>(code);
-      ReplaceTemporary(&condition_branch.condition_, temporary_rename_map);
-      continue;
-    }
-    case SiiIRCodeKind::GOTO:
-    case SiiIRCodeKind::NOPE: {
       continue;
     }
     case SiiIRCodeKind::ALLOCA: {
-      SiiIRAlloca& alloca = static_cast<SiiIRAlloca&>(code);
-      if(variable_rename_map.find(&alloca) != variable_rename_map.end()) {
+      if(IsPromoted(variable_rename_map, &code)) {
         code_list.erase(iter);
       }
       continue;
     }
-    case SiiIRCodeKind::RETURN: {
-      SiiIRReturn& ret = static_cast<SiiIRReturn&>(code);
-      ReplaceTemporary(&ret.result_, temporary_rename_map);
-      continue;
-    }
     default: {
-      throw std::runtime_error("Unsupported code kind");
+      continue;
     }
     }
   }
-  BasicGroup* current_basic_group = current_node->basic_group_;
   for(size_t i = 0; i < current_basic_group->follows_.size(); i++) {
     BasicGroup* follow = current_basic_group->follows_[i];
     auto        iter   = follow->codes_.begin();
@@ -162,28 +205,54 @@ RenamePass(DominatorTreeNode*                      current_node,
       if(iter->kind_ != SiiIRCodeKind::PHI) {
         break;
       }
-      SiiIRPhi& phi      = static_cast<SiiIRPhi&>(*iter);
-      Value*    variable = original_variable_map[&phi].get();
-      if(variable_rename_map.find(variable) != variable_rename_map.end()) {
-        for(size_t k = 0; k < follow->precedes_.size(); k++) {
-          if(follow->precedes_[k] == current_basic_group) {
-            phi.replace_src(k, variable_rename_map[variable].top());
-          }
+      SiiIRPhi& phi = cast<SiiIRPhi>(*iter);
+      // Phis left by an earlier round are not ours to fill.
+      const ValuePtr& variable = Lookup(original_variable_map, &phi);
+      if(variable == nullptr) {
+        continue;
+      }
+      for(size_t k = 0; k < follow->precedes_.size(); k++) {
+        if(follow->precedes_[k] == current_basic_group) {
+          phi.replace_src(k, variable_rename_map[variable->slot_].back());
         }
       }
     }
   }
-  for(auto& child_node: current_node->children_) {
-    RenamePass(child_node,
-               variable_rename_map,
-               temporary_rename_map,
-               original_variable_map,
-               ctx);
-  }
-  for(auto [variable, count]: rename_count) {
-    for(size_t i = 0; i < count; i++) {
-      variable_rename_map[variable].pop();
+}
+
+// Rename the variables, walking the dominator tree in preorder. The walk
+// keeps its own stack as the tree may be as deep as the function is long.
+static void RenamePass(const DominatorTree& tree,
+                       VariableRenameMap&   variable_rename_map,
+                       const SlotValueMap&  original_variable_map) {
+  struct Frame {
+    uint32_t group;
+    // Where the variables renamed by group start in renamed_variables.
+    size_t   renamed_begin;
+    size_t   next_child;
+  };
+  std::vector<Frame>    stack;
+  std::vector<uint32_t> renamed_variables;
+  auto                  enter = [&](uint32_t group) {
+    stack.push_back({ group, renamed_variables.size(), 0 });
+    RenameGroup(tree.groups_[group],
+                variable_rename_map,
+                original_variable_map,
+                renamed_variables);
+  };
+  enter(tree.root_);
+  while(!stack.empty()) {
+    Frame&     top      = stack.back();
+    IndexRange children = tree.children(top.group);
+    if(top.next_child < children.size()) {
+      enter(children[top.next_child++]);
+      continue;
     }
+    while(renamed_variables.size() > top.renamed_begin) {
+      variable_rename_map[renamed_variables.back()].pop_back();
+      renamed_variables.pop_back();
+    }
+    stack.pop_back();
   }
 }
 
@@ -200,43 +269,243 @@ static bool TryRemoveAllocIfStoreOnly(SiiIRAlloca& alloca) {
   return true;
 }
 
-static bool FuncMemoryToRegister(FunctionPtr& func) {
-  std::unique_ptr<IDFBuilder>            idf_builder = CreateIDFBuilder(func);
-  std::map<Value*, std::stack<ValuePtr>> variable_rename_map;
-  std::map<Value*, ValuePtr>             original_variable_map;
-  for(auto& code: func->entry_->codes_) {
-    if(code.kind_ != SiiIRCodeKind::ALLOCA) {
+// Promote alloca when all its loads and stores are in one group, each load
+// taking the value of the store before it, or undef if it is never stored.
+// A load before the first store is left to the general path: the group may
+// be in a loop and read the last store of the previous trip.
+static bool TryPromoteSingleGroup(Function& func, SiiIRAlloca& alloca) {
+  std::vector<SiiIRCode*> accesses;
+  bool                    stored = false;
+  for(auto& use: alloca.users_) {
+    SiiIRCode* user = use.user_;
+    if((user->kind_ != SiiIRCodeKind::LOAD
+        && user->kind_ != SiiIRCodeKind::STORE)
+       || (!accesses.empty() && user->group_ != accesses[0]->group_)) {
+      return false;
+    }
+    stored |= user->kind_ == SiiIRCodeKind::STORE;
+    accesses.push_back(user);
+  }
+  std::sort(accesses.begin(),
+            accesses.end(),
+            [](const SiiIRCode* a, const SiiIRCode* b) {
+              return a->comes_before(*b);
+            });
+  if(accesses.empty()
+     || (stored && accesses[0]->kind_ == SiiIRCodeKind::LOAD)) {
+    return false;
+  }
+  ValuePtr value
+      = stored ? nullptr : func.ctx_->undef(Type::GetAimType(alloca.type_));
+  for(SiiIRCode* access: accesses) {
+    if(access->kind_ == SiiIRCodeKind::STORE) {
+      value = cast<SiiIRStore>(access)->src().value_;
+    } else {
+      access->replace_all_uses_with(value);
+    }
+  }
+  for(SiiIRCode* access: accesses) {
+    access->remove_from_parent();
+  }
+  alloca.remove_from_parent();
+  return true;
+}
+
+// Promote alloca when it is stored once and the store dominates every load,
+// which all take the stored value.
+static bool TryPromoteSingleStore(SiiIRAlloca&          alloca,
+                                  const FrozenFunction& frozen,
+                                  const DominatorTree&  tree) {
+  SiiIRStore*             store = nullptr;
+  std::vector<SiiIRLoad*> loads;
+  for(auto& use: alloca.users_) {
+    if(SiiIRLoad* load = dyn_cast<SiiIRLoad>(use.user_)) {
+      loads.push_back(load);
+    } else if(store == nullptr && isa<SiiIRStore>(use.user_)) {
+      store = cast<SiiIRStore>(use.user_);
+    } else {
+      return false;
+    }
+  }
+  if(store == nullptr) {
+    return false;
+  }
+  uint32_t store_group = frozen.group_index(store->group_);
+  for(const SiiIRLoad* load: loads) {
+    bool dominated = load->group_ == store->group_
+                         ? store->comes_before(*load)
+                         : tree.dominates(store_group,
+                                          frozen.group_index(load->group_));
+    if(!dominated) {
+      return false;
+    }
+  }
+  ValuePtr value = store->src().value_;
+  for(SiiIRLoad* load: loads) {
+    load->replace_all_uses_with(value);
+    load->remove_from_parent();
+  }
+  store->remove_from_parent();
+  alloca.remove_from_parent();
+  return true;
+}
+
+// Append the allocas marked in blocked whose address variable holds.
+static void HeldAddresses(const SiiIRAlloca&         variable,
+                          const std::vector<bool>&   blocked,
+                          std::vector<SiiIRAlloca*>& held) {
+  for(const auto& use: variable.users_) {
+    SiiIRStore* store = dyn_cast<SiiIRStore>(use.user_);
+    if(store == nullptr) {
       continue;
     }
-    SiiIRAlloca& alloca_code = static_cast<SiiIRAlloca&>(code);
+    SiiIRAlloca* address = dyn_cast<SiiIRAlloca>(store->src().value_.get());
+    if(address != nullptr && blocked[address->slot_]) {
+      held.push_back(address);
+    }
+  }
+}
+
+// Promote the allocas of func in a single round. An alloca whose address is
+// stored in another one, as in p = &x, waits until that one is promoted by
+// a fast path: the loads of p are then x itself, and so are the accesses
+// through them. The chains are resolved before any phi is placed, so one
+// IDF computation and one renaming walk cover every promoted variable.
+static void FuncMemoryToRegister(FunctionPtr&                       func,
+                                 IDFBuilder*                        idf_builder,
+                                 MemoryToRegisterPass::PhiPlacement placement,
+                                 MemoryToRegisterPass::Statistics& statistics) {
+  VariableRenameMap                  variable_rename_map(func->renumber());
+  SlotValueMap                       original_variable_map;
+  const FrozenFunction&              frozen = *idf_builder->func_;
+  std::vector<ValuePtr>              promoted;
+  std::vector<std::vector<uint32_t>> def_groups;
+  // Allocas are popped in the order of the entry group.
+  std::vector<SiiIRAlloca*>          worklist;
+  for(auto& code: func->entry_->codes_) {
+    if(SiiIRAlloca* alloca_code = dyn_cast<SiiIRAlloca>(&code)) {
+      worklist.push_back(alloca_code);
+    }
+  }
+  std::reverse(worklist.begin(), worklist.end());
+  // Allocas that failed CanVariableToRegister, by slot.
+  std::vector<bool>         blocked(variable_rename_map.size(), false);
+  std::vector<SiiIRAlloca*> held;
+  while(!worklist.empty()) {
+    SiiIRAlloca& alloca_code = *worklist.back();
+    worklist.pop_back();
     if(!CanVariableToRegister(alloca_code)) {
+      blocked[alloca_code.slot_] = true;
       continue;
     }
+    held.clear();
+    HeldAddresses(alloca_code, blocked, held);
     if(TryRemoveAllocIfStoreOnly(alloca_code)) {
+      statistics.store_only_count++;
+    } else if(TryPromoteSingleGroup(*func, alloca_code)) {
+      // Most locals need neither phis nor renaming.
+      statistics.single_group_count++;
+    } else if(TryPromoteSingleStore(
+                  alloca_code, frozen, *idf_builder->get_dom())) {
+      statistics.single_store_count++;
+    } else {
+      // The loads of a variable promoted here are replaced by phis at
+      // best, which the addresses it holds could not be promoted through.
+      promoted.push_back(alloca_code.get_iterator().shared());
+      def_groups.push_back(DefiningGroups(alloca_code, frozen));
+      variable_rename_map[alloca_code.slot_].push_back(
+          func->ctx_->undef(Type::GetAimType(alloca_code.type_)));
       continue;
     }
-    VariableMemoryToRegister(func,
-                             code.get_iterator().shared(),
-                             idf_builder.get(),
-                             original_variable_map);
-    variable_rename_map[&alloca_code].push(
-        Value::undef(Type::GetAimType(alloca_code.type_)));
+    for(SiiIRAlloca* address: held) {
+      if(blocked[address->slot_]) {
+        blocked[address->slot_] = false;
+        worklist.push_back(address);
+      }
+    }
   }
-  if(variable_rename_map.empty()) {
-    return false;
+  if(promoted.empty()) {
+    return;
   }
 
-  std::map<Value*, ValuePtr> temporary_rename_map;
-  RenamePass(idf_builder->get_dom()->root_,
-             variable_rename_map,
-             temporary_rename_map,
-             original_variable_map,
-             *func->ctx_);
-  return true;
+  // Phis of every variable are placed in one batch, then pruned.
+  std::vector<std::vector<uint32_t>> phi_groups
+      = idf_builder->get_IDFs(def_groups);
+  LiveInGroups live_in(frozen);
+  for(size_t i = 0; i < promoted.size(); i++) {
+    std::vector<uint32_t>& groups   = phi_groups[i];
+    size_t                 IDF_size = groups.size();
+    if(placement != MemoryToRegisterPass::PhiPlacement::MINIMAL
+       && !groups.empty()) {
+      bool read_first = live_in.compute(*promoted[i], def_groups[i]);
+      if(!read_first) {
+        groups.clear();
+      } else if(placement == MemoryToRegisterPass::PhiPlacement::PRUNED) {
+        groups.erase(std::remove_if(groups.begin(),
+                                    groups.end(),
+                                    [&](uint32_t group) {
+                                      return !live_in.contains(group);
+                                    }),
+                     groups.end());
+      }
+    }
+    statistics.phi_count += groups.size();
+    statistics.avoided_phi_count += IDF_size - groups.size();
+    InsertPhis(func, promoted[i], groups, frozen, original_variable_map);
+  }
+  statistics.promoted_count += promoted.size();
+
+  RenamePass(
+      *idf_builder->get_dom(), variable_rename_map, original_variable_map);
+}
+
+// Replace the loads that can only read the address of a promotable alloca
+// by the alloca itself, so that accesses through a pointer variable become
+// accesses to the variable it points to. The pointer variables are left
+// with stores only. Returns the number of loads replaced.
+static size_t ResolveAddressLoads(Function& func) {
+  bool stored_address = false;
+  for(const SiiIRCode& code: func.entry_->codes_) {
+    if(isa<SiiIRAlloca>(code) && !CanVariableToRegister(code)) {
+      stored_address = true;
+      break;
+    }
+  }
+  if(!stored_address) {
+    return 0;
+  }
+  AllocaPointsToPtr points_to = BuildAllocaPointsTo(func);
+  size_t            count     = 0;
+  for(const BasicGroupPtr& group: func.basic_groups_) {
+    auto& code_list = group->codes_;
+    for(auto iter = code_list.begin(); iter != code_list.end(); ++iter) {
+      SiiIRLoad* load = dyn_cast<SiiIRLoad>(&*iter);
+      if(load == nullptr) {
+        continue;
+      }
+      uint32_t address = points_to->must_point_to(*load);
+      if(address == AllocaPointsTo::kNoIndex
+         || !points_to->promotable_[address]) {
+        continue;
+      }
+      load->replace_all_uses_with(
+          points_to->allocas_[address]->get_iterator().shared());
+      load->drop_all_references();
+      code_list.erase(iter);
+      count++;
+    }
+  }
+  return count;
 }
 
 void MemoryToRegisterPass::run(FunctionPtr& func) {
-  do {} while(FuncMemoryToRegister(func)); 
+  // Unreachable groups would only cost time in the dominator tree and in
+  // renaming, they get no phis from the IDF anyway.
+  RemoveUnreachableGroups(*func);
+  statistics_.resolved_load_count += ResolveAddressLoads(*func);
+  std::unique_ptr<IDFBuilder> idf_builder = CreateIDFBuilder(func);
+  FuncMemoryToRegister(func, idf_builder.get(), placement_, statistics_);
+  func->renumber();
 }
 
 }  // namespace SiiIR
@@ -1,8 +1,12 @@
 #include "IR/Pass/quit_SSA.h"
+#include "IR/CFG_utils.h"
 
 namespace SiiIR {
 
 void QuitSSAPass::run(FunctionPtr& func) {
+  // Copies placed at the end of a predecessor with several followers would
+  // also run on the paths that do not reach the phi.
+  SplitCriticalEdges(*func, true);
   for (auto& bg : func->basic_groups_) {
     auto& code_list = bg->codes_;
     for (auto iter = code_list.begin(); iter != code_list.end(); ++iter) {
@@ -10,13 +14,13 @@ void QuitSSAPass::run(FunctionPtr& func) {
       if (code.kind_ != SiiIRCodeKind::PHI) {
         continue;
       }
-      auto& phi_code = static_cast<SiiIRPhi&>(code);
-      for(size_t i = 0; i < phi_code.src_list_.size(); i++) {
-        ValuePtr    src_value = phi_code.src_list_[i]->value_;
+      auto& phi_code = cast<SiiIRPhi>(code);
+      for(size_t i = 0; i < phi_code.src_size(); i++) {
+        ValuePtr    src_value = phi_code.src(i).value_;
         BasicGroup* pred_bg   = bg->precedes_[i];
         // Insert a assign instruction at the end of pred_bg
         std::shared_ptr<SiiIRAssign> assign
-            = std::make_shared<SiiIRAssign>(iter.shared(), src_value);
+            = ArenaNew<SiiIRAssign>(func->arena(), iter.shared(), src_value);
         auto& pred_code_list = pred_bg->codes_;
         pred_code_list.insert_before(--pred_code_list.end(), assign);
       }
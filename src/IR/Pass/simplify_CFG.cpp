@@ -0,0 +1,192 @@
+#include "IR/Pass/simplify_CFG.h"
+#include "IR/CFG_utils.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace SiiIR {
+
+static bool HasPhis(const BasicGroup& group) {
+  return !group.codes_.empty()
+         && group.codes_.begin()->kind_ == SiiIRCodeKind::PHI;
+}
+
+static void EraseCode(List<SiiIRCode>::IterType iter) {
+  iter->drop_all_references();
+  iter->get_parent()->erase(iter);
+}
+
+// Point the edges from group to old_follow at new_follow instead.
+static void Retarget(BasicGroup& group,
+                     BasicGroup* old_follow,
+                     BasicGroup* new_follow) {
+  SiiIRCode& terminator = *--group.codes_.end();
+  for(Use* use = terminator.op_begin(); use != terminator.op_end(); ++use) {
+    if(use->value_ == old_follow->label_) {
+      use->set(new_follow->label_);
+    }
+  }
+  std::replace(
+      group.follows_.begin(), group.follows_.end(), old_follow, new_follow);
+}
+
+class CFGSimplifier {
+public:
+  explicit CFGSimplifier(Function& func)
+      : func_(func) {}
+
+  void run();
+
+private:
+  bool fold_branch(BasicGroup& group);
+  bool forward_jumps(BasicGroup& group);
+  bool merge_follower(BasicGroup& group);
+
+  // Mark group as removed once nothing branches to it any more.
+  void discard(BasicGroup& group);
+
+  Function&                             func_;
+  std::unordered_set<const BasicGroup*> removed_;
+};
+
+void CFGSimplifier::discard(BasicGroup& group) {
+  for(auto& code: group.codes_) {
+    code.drop_all_references();
+  }
+  group.precedes_.clear();
+  group.follows_.clear();
+  removed_.insert(&group);
+}
+
+bool CFGSimplifier::fold_branch(BasicGroup& group) {
+  if(group.follows_.size() != 2 || group.follows_[0] != group.follows_[1]) {
+    return false;
+  }
+  BasicGroup* follow = group.follows_[0];
+  auto&       from   = follow->precedes_;
+  auto        first  = std::find(from.begin(), from.end(), &group);
+  size_t      second = std::find(first + 1, from.end(), &group) - from.begin();
+  std::vector<BasicGroup*> precedes;
+  std::vector<size_t>      source_of;
+  for(size_t i = 0; i < from.size(); i++) {
+    if(i != second) {
+      precedes.push_back(from[i]);
+      source_of.push_back(i);
+    }
+  }
+  for(auto iter = follow->codes_.begin();
+      iter != follow->codes_.end() && iter->kind_ == SiiIRCodeKind::PHI;
+      ++iter) {
+    SiiIRPhi& phi = cast<SiiIRPhi>(*iter);
+    if(phi.src(first - from.begin()).value_ != phi.src(second).value_) {
+      return false;
+    }
+  }
+  SetPredecessors(func_, *follow, std::move(precedes), source_of);
+
+  auto terminator = --group.codes_.end();
+  auto jump       = ArenaNew<SiiIRGoto>(func_.arena(), follow->label_);
+  jump->group_    = &group;
+  group.codes_.insert_before(terminator, jump);
+  EraseCode(terminator);
+  group.follows_.pop_back();
+  return true;
+}
+
+bool CFGSimplifier::forward_jumps(BasicGroup& group) {
+  if(&group == func_.entry_ || group.codes_.size() != 1
+     || group.codes_.begin()->kind_ != SiiIRCodeKind::GOTO
+     || group.precedes_.empty()) {
+    return false;
+  }
+  BasicGroup* follow = group.follows_[0];
+  if(follow == &group || follow == func_.entry_) {
+    return false;
+  }
+  auto& from = follow->precedes_;
+  if(HasPhis(*follow)) {
+    // A predecessor reaching follow both directly and through group may
+    // need two different sources in the same phi.
+    for(BasicGroup* precede: group.precedes_) {
+      if(std::find(from.begin(), from.end(), precede) != from.end()) {
+        return false;
+      }
+    }
+  }
+  size_t index = std::find(from.begin(), from.end(), &group) - from.begin();
+  std::vector<BasicGroup*> precedes;
+  std::vector<size_t>      source_of;
+  for(size_t i = 0; i < from.size(); i++) {
+    if(i != index) {
+      precedes.push_back(from[i]);
+      source_of.push_back(i);
+    }
+  }
+  for(BasicGroup* precede: group.precedes_) {
+    Retarget(*precede, &group, follow);
+    precedes.push_back(precede);
+    source_of.push_back(index);
+  }
+  SetPredecessors(func_, *follow, std::move(precedes), source_of);
+  discard(group);
+  return true;
+}
+
+bool CFGSimplifier::merge_follower(BasicGroup& group) {
+  if(group.follows_.size() != 1) {
+    return false;
+  }
+  BasicGroup* follow = group.follows_[0];
+  if(follow == &group || follow == func_.entry_
+     || follow->precedes_.size() != 1) {
+    return false;
+  }
+  EraseCode(--group.codes_.end());
+  auto& codes = follow->codes_;
+  for(auto iter = codes.begin();
+      iter != codes.end() && iter->kind_ == SiiIRCodeKind::PHI;
+      ++iter) {
+    iter->replace_all_uses_with(cast<SiiIRPhi>(*iter).src(0).value_);
+    EraseCode(iter);
+  }
+  while(!codes.empty()) {
+    auto node = codes.erase(codes.begin());
+    static_cast<SiiIRCode&>(*node).group_ = &group;
+    group.codes_.push_back(std::move(node));
+  }
+  group.follows_ = std::move(follow->follows_);
+  for(BasicGroup* next: group.follows_) {
+    std::replace(
+        next->precedes_.begin(), next->precedes_.end(), follow, &group);
+  }
+  discard(*follow);
+  return true;
+}
+
+void CFGSimplifier::run() {
+  RemoveUnreachableGroups(func_);
+  bool changed = true;
+  while(changed) {
+    changed = false;
+    for(size_t i = 0; i < func_.basic_groups_.size(); i++) {
+      BasicGroup& group = *func_.basic_groups_[i];
+      if(removed_.count(&group) != 0) {
+        continue;
+      }
+      changed |= fold_branch(group) || forward_jumps(group)
+                 || merge_follower(group);
+    }
+  }
+  auto& groups = func_.basic_groups_;
+  groups.erase(std::remove_if(groups.begin(),
+                              groups.end(),
+                              [&](const BasicGroupPtr& group) {
+                                return removed_.count(group.get()) != 0;
+                              }),
+               groups.end());
+  func_.cfg_changed();
+  func_.renumber();
+}
+
+void SimplifyCFGPass::run(FunctionPtr& func) { CFGSimplifier(*func).run(); }
+
+}  // namespace SiiIR
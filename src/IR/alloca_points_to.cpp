@@ -0,0 +1,193 @@
+#include "IR/alloca_points_to.h"
+#include <algorithm>
+#include <iterator>
+
+namespace SiiIR {
+
+uint32_t AllocaPointsTo::must_point_to(const SiiIRLoad& load) const {
+  if(load.slot_ >= loaded_.size()) {
+    return kNoIndex;
+  }
+  const std::vector<uint32_t>& addresses = loaded_[load.slot_];
+  return addresses.size() == 1 && addresses[0] != unknown() ? addresses[0]
+                                                            : kNoIndex;
+}
+
+namespace {
+
+class PointsToSolver {
+public:
+  PointsToSolver(Function& func, AllocaPointsTo& result)
+      : func_(func)
+      , result_(result) {}
+
+  void run();
+
+private:
+  // Addresses value may be, a reference valid until the next call.
+  const std::vector<uint32_t>& points_to(const Value* value);
+  // Add from to into, returns whether into grew.
+  bool merge(std::vector<uint32_t>& into, const std::vector<uint32_t>& from);
+  bool escape(const std::vector<uint32_t>& addresses);
+  bool visit(SiiIRCode& code);
+  void find_promotable();
+
+  Function&             func_;
+  AllocaPointsTo&       result_;
+  std::vector<uint32_t> single_;
+  std::vector<uint32_t> merged_;
+};
+
+const std::vector<uint32_t>& PointsToSolver::points_to(const Value* value) {
+  static const std::vector<uint32_t> kNothing;
+  if(value->kind_ == ValueKind::UNDEF) {
+    return kNothing;
+  }
+  uint32_t index = result_.index(*value);
+  if(index != AllocaPointsTo::kNoIndex) {
+    single_.assign(1, index);
+    return single_;
+  }
+  if(isa<SiiIRLoad>(value)) {
+    return result_.loaded_[value->slot_];
+  }
+  single_.assign(1, result_.unknown());
+  return single_;
+}
+
+bool PointsToSolver::merge(std::vector<uint32_t>&       into,
+                           const std::vector<uint32_t>& from) {
+  if(std::includes(into.begin(), into.end(), from.begin(), from.end())) {
+    return false;
+  }
+  merged_.clear();
+  std::set_union(into.begin(),
+                 into.end(),
+                 from.begin(),
+                 from.end(),
+                 std::back_inserter(merged_));
+  into.swap(merged_);
+  return true;
+}
+
+bool PointsToSolver::escape(const std::vector<uint32_t>& addresses) {
+  bool changed = false;
+  for(uint32_t address: addresses) {
+    if(address != result_.unknown() && !result_.escaped_[address]) {
+      result_.escaped_[address] = true;
+      changed                   = true;
+    }
+  }
+  return changed;
+}
+
+bool PointsToSolver::visit(SiiIRCode& code) {
+  const uint32_t unknown = result_.unknown();
+  if(SiiIRLoad* load = dyn_cast<SiiIRLoad>(&code)) {
+    std::vector<uint32_t>& loaded  = result_.loaded_[load->slot_];
+    bool                   changed = false;
+    // Copied, merging into loaded may reuse the scratch of points_to().
+    std::vector<uint32_t>  sources = points_to(load->src().value_.get());
+    for(uint32_t source: sources) {
+      changed |= source == unknown ? merge(loaded, { unknown })
+                                   : merge(loaded, result_.contents_[source]);
+    }
+    return changed;
+  }
+  if(SiiIRStore* store = dyn_cast<SiiIRStore>(&code)) {
+    std::vector<uint32_t> destinations = points_to(store->dest().value_.get());
+    const std::vector<uint32_t>& stored = points_to(store->src().value_.get());
+    bool                         changed = false;
+    for(uint32_t destination: destinations) {
+      changed |= destination == unknown
+                     ? escape(stored)
+                     : merge(result_.contents_[destination], stored);
+    }
+    return changed;
+  }
+  bool changed = false;
+  for(Use* use = code.op_begin(); use != code.op_end(); ++use) {
+    if(use->value_ != nullptr) {
+      changed |= escape(points_to(use->value_.get()));
+    }
+  }
+  return changed;
+}
+
+void PointsToSolver::find_promotable() {
+  const uint32_t     unknown = result_.unknown();
+  std::vector<bool>& promotable = result_.promotable_;
+  promotable.resize(result_.alloca_count());
+  std::vector<uint32_t> worklist;
+  for(uint32_t i = 0; i < result_.alloca_count(); i++) {
+    promotable[i] = !result_.escaped_[i];
+  }
+  for(const std::vector<uint32_t>& loaded: result_.loaded_) {
+    if(loaded.size() > 1) {
+      for(uint32_t address: loaded) {
+        if(address != unknown) {
+          promotable[address] = false;
+        }
+      }
+    }
+  }
+  for(uint32_t i = 0; i < result_.alloca_count(); i++) {
+    if(!promotable[i]) {
+      worklist.push_back(i);
+    }
+  }
+  // An address held by an alloca left in memory stays in memory too.
+  while(!worklist.empty()) {
+    uint32_t holder = worklist.back();
+    worklist.pop_back();
+    for(uint32_t address: result_.contents_[holder]) {
+      if(address != unknown && promotable[address]) {
+        promotable[address] = false;
+        worklist.push_back(address);
+      }
+    }
+  }
+}
+
+void PointsToSolver::run() {
+  size_t slot_count = func_.renumber();
+  result_.alloca_index_.assign(slot_count, AllocaPointsTo::kNoIndex);
+  for(SiiIRCode& code: func_.entry_->codes_) {
+    if(SiiIRAlloca* alloca_code = dyn_cast<SiiIRAlloca>(&code)) {
+      result_.alloca_index_[alloca_code->slot_] = result_.allocas_.size();
+      result_.allocas_.push_back(alloca_code);
+    }
+  }
+  const uint32_t unknown = result_.unknown();
+  result_.contents_.resize(result_.alloca_count());
+  result_.loaded_.resize(slot_count);
+  result_.escaped_.assign(result_.alloca_count(), false);
+
+  bool changed = true;
+  while(changed) {
+    changed = false;
+    for(const BasicGroupPtr& group: func_.basic_groups_) {
+      for(SiiIRCode& code: group->codes_) {
+        changed |= visit(code);
+      }
+    }
+    // Code the analysis does not see may read or write an escaped alloca.
+    for(uint32_t i = 0; i < result_.alloca_count(); i++) {
+      if(result_.escaped_[i]) {
+        changed |= merge(result_.contents_[i], { unknown });
+        changed |= escape(result_.contents_[i]);
+      }
+    }
+  }
+  find_promotable();
+}
+
+}  // namespace
+
+AllocaPointsToPtr BuildAllocaPointsTo(Function& func) {
+  auto result = std::make_shared<AllocaPointsTo>();
+  PointsToSolver(func, *result).run();
+  return result;
+}
+
+}  // namespace SiiIR
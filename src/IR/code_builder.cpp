@@ -1,10 +1,14 @@
 #include "IR/code_builder.h"
+#include "IR/CFG_utils.h"
 #include "IR/IR.h"
 #include <stdexcept>
+#include <unordered_map>
 
 namespace SiiIR {
 class CodeBuilderImpl : public CodeBuilder {
 public:
+  explicit CodeBuilderImpl(ArenaPtr arena)
+      : arena_(std::move(arena)) {}
   SiiIRBinaryOperationPtr append_multiply(ValuePtr left,
                                           ValuePtr right) override;
   SiiIRBinaryOperationPtr append_divide(ValuePtr left, ValuePtr right) override;
@@ -31,9 +35,12 @@ public:
   SiiIRReturnPtr append_return(ValuePtr value) override;
   SiiIRStorePtr  append_store(ValuePtr source, ValuePtr dest_address) override;
   std::shared_ptr<std::vector<SiiIRCodePtr>> finish() override;
+  FunctionPtr finish_function(FunctionContextPtr ctx,
+                              std::string        name) override;
 
 protected:
-  void                      append_new_code(SiiIRCodePtr new_code);
+  virtual void              append_new_code(SiiIRCodePtr new_code);
+  ArenaPtr                  arena_;
   std::vector<SiiIRCodePtr> alloca_list_;
   std::vector<SiiIRCodePtr> code_list_;
   uint32_t                  unnamed_label_count_ = 0;
@@ -51,39 +58,55 @@ void CodeBuilderImpl::append_new_code(SiiIRCodePtr new_code) {
 
 SiiIRBinaryOperationPtr CodeBuilderImpl::append_multiply(ValuePtr left,
                                                          ValuePtr right) {
-  SiiIRBinaryOperationPtr new_code = std::make_shared<SiiIRBinaryOperation>(
-      SiiIRCodeKind::MUL, std::move(left), std::move(right), left->type_);
+  SiiIRBinaryOperationPtr new_code
+      = ArenaNew<SiiIRBinaryOperation>(arena_,
+                                       SiiIRCodeKind::MUL,
+                                       std::move(left),
+                                       std::move(right),
+                                       left->type_);
   append_new_code(new_code);
   return new_code;
 }
 
 SiiIRBinaryOperationPtr CodeBuilderImpl::append_divide(ValuePtr left,
                                                        ValuePtr right) {
-  SiiIRBinaryOperationPtr new_code = std::make_shared<SiiIRBinaryOperation>(
-      SiiIRCodeKind::DIV, std::move(left), std::move(right), left->type_);
+  SiiIRBinaryOperationPtr new_code
+      = ArenaNew<SiiIRBinaryOperation>(arena_,
+                                       SiiIRCodeKind::DIV,
+                                       std::move(left),
+                                       std::move(right),
+                                       left->type_);
   append_new_code(new_code);
   return new_code;
 }
 
 SiiIRBinaryOperationPtr CodeBuilderImpl::append_add(ValuePtr left,
                                                     ValuePtr right) {
-  SiiIRBinaryOperationPtr new_code = std::make_shared<SiiIRBinaryOperation>(
-      SiiIRCodeKind::ADD, std::move(left), std::move(right), left->type_);
+  SiiIRBinaryOperationPtr new_code
+      = ArenaNew<SiiIRBinaryOperation>(arena_,
+                                       SiiIRCodeKind::ADD,
+                                       std::move(left),
+                                       std::move(right),
+                                       left->type_);
   append_new_code(new_code);
   return new_code;
 }
 
 SiiIRBinaryOperationPtr CodeBuilderImpl::append_sub(ValuePtr left,
                                                     ValuePtr right) {
-  SiiIRBinaryOperationPtr new_code = std::make_shared<SiiIRBinaryOperation>(
-      SiiIRCodeKind::SUB, std::move(left), std::move(right), left->type_);
+  SiiIRBinaryOperationPtr new_code
+      = ArenaNew<SiiIRBinaryOperation>(arena_,
+                                       SiiIRCodeKind::SUB,
+                                       std::move(left),
+                                       std::move(right),
+                                       left->type_);
   append_new_code(new_code);
   return new_code;
 }
 
 SiiIRUnaryOperationPtr CodeBuilderImpl::append_neg(ValuePtr child) {
-  SiiIRUnaryOperationPtr new_code = std::make_shared<SiiIRUnaryOperation>(
-      SiiIRCodeKind::NEG, std::move(child));
+  SiiIRUnaryOperationPtr new_code = ArenaNew<SiiIRUnaryOperation>(
+      arena_, SiiIRCodeKind::NEG, std::move(child));
   append_new_code(new_code);
   return new_code;
 }
@@ -91,10 +114,11 @@ SiiIRUnaryOperationPtr CodeBuilderImpl::append_neg(ValuePtr child) {
 SiiIRBinaryOperationPtr CodeBuilderImpl::append_equal(ValuePtr left,
                                                       ValuePtr right) {
   SiiIRBinaryOperationPtr new_code
-      = std::make_shared<SiiIRBinaryOperation>(SiiIRCodeKind::EQUAL,
-                                               std::move(left),
-                                               std::move(right),
-                                               Type::Integer(1));
+      = ArenaNew<SiiIRBinaryOperation>(arena_,
+                                       SiiIRCodeKind::EQUAL,
+                                       std::move(left),
+                                       std::move(right),
+                                       Type::Integer(1));
   append_new_code(new_code);
   return new_code;
 }
@@ -105,10 +129,11 @@ SiiIRBinaryOperationPtr CodeBuilderImpl::append_not_equal(ValuePtr left,
     throw std::runtime_error("Not equal must be of same type");
   }
   SiiIRBinaryOperationPtr new_code
-      = std::make_shared<SiiIRBinaryOperation>(SiiIRCodeKind::NOT_EQUAL,
-                                               std::move(left),
-                                               std::move(right),
-                                               Type::Integer(1));
+      = ArenaNew<SiiIRBinaryOperation>(arena_,
+                                       SiiIRCodeKind::NOT_EQUAL,
+                                       std::move(left),
+                                       std::move(right),
+                                       Type::Integer(1));
   append_new_code(new_code);
   return new_code;
 }
@@ -119,10 +144,11 @@ SiiIRBinaryOperationPtr CodeBuilderImpl::append_less_than(ValuePtr left,
     throw std::runtime_error("Less than must be of same type");
   }
   SiiIRBinaryOperationPtr new_code
-      = std::make_shared<SiiIRBinaryOperation>(SiiIRCodeKind::LESS_THAN,
-                                               std::move(left),
-                                               std::move(right),
-                                               Type::Integer(1));
+      = ArenaNew<SiiIRBinaryOperation>(arena_,
+                                       SiiIRCodeKind::LESS_THAN,
+                                       std::move(left),
+                                       std::move(right),
+                                       Type::Integer(1));
   append_new_code(new_code);
   return new_code;
 }
@@ -133,10 +159,11 @@ SiiIRBinaryOperationPtr CodeBuilderImpl::append_less_equal(ValuePtr left,
     throw std::runtime_error("Less equal must be of same type");
   }
   SiiIRBinaryOperationPtr new_code
-      = std::make_shared<SiiIRBinaryOperation>(SiiIRCodeKind::LESS_EQUAL,
-                                               std::move(left),
-                                               std::move(right),
-                                               Type::Integer(1));
+      = ArenaNew<SiiIRBinaryOperation>(arena_,
+                                       SiiIRCodeKind::LESS_EQUAL,
+                                       std::move(left),
+                                       std::move(right),
+                                       Type::Integer(1));
   append_new_code(new_code);
   return new_code;
 }
@@ -147,20 +174,20 @@ SiiIRStorePtr CodeBuilderImpl::append_store(ValuePtr source,
   if(*aim_type != *source->type_) {
     throw std::runtime_error("Store must be of same type");
   }
-  SiiIRStorePtr new_code = std::make_shared<SiiIRStore>(source, dest_address);
+  SiiIRStorePtr new_code = ArenaNew<SiiIRStore>(arena_, source, dest_address);
   append_new_code(new_code);
   return new_code;
 }
 
 SiiIRLoadPtr CodeBuilderImpl::append_load(ValuePtr source_address) {
   SiiIRLoadPtr new_code
-      = std::make_shared<SiiIRLoad>(std::move(source_address));
+      = ArenaNew<SiiIRLoad>(arena_, std::move(source_address));
   append_new_code(new_code);
   return new_code;
 }
 
 SiiIRReturnPtr CodeBuilderImpl::append_return(ValuePtr value) {
-  SiiIRReturnPtr new_code = std::make_shared<SiiIRReturn>(std::move(value));
+  SiiIRReturnPtr new_code = ArenaNew<SiiIRReturn>(arena_, std::move(value));
   append_new_code(new_code);
   return new_code;
 }
@@ -172,14 +199,17 @@ CodeBuilderImpl::append_condition_branch(ValuePtr condition,
   if(*condition->type_ != *Type::Integer(1)) {
     throw std::runtime_error("Condition branch must be of type bool");
   }
-  SiiIRConditionBranchPtr new_code = std::make_shared<SiiIRConditionBranch>(
-      std::move(condition), std::move(true_label), std::move(false_label));
+  SiiIRConditionBranchPtr new_code
+      = ArenaNew<SiiIRConditionBranch>(arena_,
+                                       std::move(condition),
+                                       std::move(true_label),
+                                       std::move(false_label));
   append_new_code(new_code);
   return new_code;
 }
 
 SiiIRGotoPtr CodeBuilderImpl::append_goto(LabelPtr label) {
-  SiiIRGotoPtr then_goto = std::make_shared<SiiIRGoto>(std::move(label));
+  SiiIRGotoPtr then_goto = ArenaNew<SiiIRGoto>(arena_, std::move(label));
   append_new_code(then_goto);
   return then_goto;
 }
@@ -193,7 +223,7 @@ void CodeBuilderImpl::append_label(LabelPtr label) {
 }
 
 SiiIRNopePtr CodeBuilderImpl::append_nope() {
-  SiiIRNopePtr nope = std::make_shared<SiiIRNope>();
+  SiiIRNopePtr nope = ArenaNew<SiiIRNope>(arena_);
   append_new_code(nope);
   return nope;
 }
@@ -212,19 +242,230 @@ std::shared_ptr<std::vector<SiiIRCodePtr>> CodeBuilderImpl::finish() {
 SiiIRFunctionDefinitionPtr
 CodeBuilderImpl::append_function(FunctionValuePtr func) {
   SiiIRFunctionDefinitionPtr function
-      = std::make_shared<SiiIRFunctionDefinition>(std::move(func));
+      = ArenaNew<SiiIRFunctionDefinition>(arena_, std::move(func));
   append_new_code(function);
   return function;
 }
 
 SiiIRAllocaPtr CodeBuilderImpl::append_alloca(uint32_t bytes, TypePtr type) {
-  SiiIRAllocaPtr alloca = std::make_shared<SiiIRAlloca>(bytes, type);
+  SiiIRAllocaPtr alloca = ArenaNew<SiiIRAlloca>(arena_, bytes, type);
   alloca_list_.push_back(alloca);
   return alloca;
 }
 
-CodeBuilderPtr CreateCodeBuilder() {
-  return std::make_shared<CodeBuilderImpl>();
+FunctionPtr CodeBuilderImpl::finish_function(FunctionContextPtr ctx,
+                                             std::string        name) {
+  return BuildFunction(std::move(*finish()), std::move(ctx), std::move(name));
+}
+
+// Groups are opened by labels and closed by terminators. A group that is
+// left without a terminator when the next label arrives falls through to it
+// with a goto, the way BuildFunction() splits codes.
+class FunctionCodeBuilder : public CodeBuilderImpl {
+public:
+  explicit FunctionCodeBuilder(ArenaPtr arena)
+      : CodeBuilderImpl(std::move(arena)) {
+    reset();
+  }
+
+  SiiIRAllocaPtr append_alloca(uint32_t bytes, TypePtr type) override;
+  std::shared_ptr<std::vector<SiiIRCodePtr>> finish() override;
+  FunctionPtr finish_function(FunctionContextPtr ctx,
+                              std::string        name) override;
+
+protected:
+  void append_new_code(SiiIRCodePtr new_code) override;
+
+private:
+  BasicGroup* group_of(const LabelPtr& label);
+  // Wire the edges of the branch ending group, false when a destination is
+  // not known yet.
+  bool        link_branch(BasicGroup* group, SiiIRCode& branch);
+  void        start_group(BasicGroup* group);
+  void        push_code(BasicGroup* group, SiiIRCodePtr code);
+  // Start over with an empty entry group, after the codes are handed out.
+  void        reset();
+
+  static void Link(BasicGroup* from, BasicGroup* to) {
+    from->follows_.push_back(to);
+    to->precedes_.push_back(from);
+  }
+
+  BasicGroupPtr entry_;
+  // Group codes are appended to, null after a terminator.
+  BasicGroup*   current_ = nullptr;
+  // Groups in the order their labels were appended.
+  std::vector<BasicGroupPtr>                placed_groups_;
+  // Groups of labels branched to before being appended.
+  std::unordered_map<Label*, BasicGroupPtr> pending_groups_;
+  std::unordered_map<Label*, BasicGroup*>   label_groups_;
+  // Groups ending in a branch whose destination is set after it is
+  // appended, linked by finish_function().
+  std::vector<BasicGroup*>                  unlinked_groups_;
+};
+
+BasicGroup* FunctionCodeBuilder::group_of(const LabelPtr& label) {
+  auto [iter, inserted] = label_groups_.insert({ label.get(), nullptr });
+  if(inserted) {
+    BasicGroupPtr group          = std::make_shared<BasicGroup>();
+    group->label_                = label;
+    iter->second                 = group.get();
+    pending_groups_[label.get()] = std::move(group);
+  }
+  return iter->second;
+}
+
+void FunctionCodeBuilder::start_group(BasicGroup* group) {
+  auto pending = pending_groups_.find(group->label_.get());
+  if(pending == pending_groups_.end()) {
+    throw std::runtime_error("Label is appended twice");
+  }
+  if(current_ != nullptr) {
+    push_code(current_, ArenaNew<SiiIRGoto>(arena_, group->label_));
+    Link(current_, group);
+  }
+  placed_groups_.push_back(std::move(pending->second));
+  pending_groups_.erase(pending);
+  current_ = group;
+}
+
+void FunctionCodeBuilder::reset() {
+  entry_         = std::make_shared<BasicGroup>();
+  entry_->label_ = std::make_shared<Label>();
+  current_       = nullptr;
+  placed_groups_.clear();
+  pending_groups_.clear();
+  label_groups_.clear();
+  unlinked_groups_.clear();
+}
+
+void FunctionCodeBuilder::push_code(BasicGroup* group, SiiIRCodePtr code) {
+  if(group->codes_.empty()) {
+    group->label_->dest_code_ = code.get();
+  }
+  code->group_ = group;
+  group->codes_.push_back(std::move(code));
+}
+
+void FunctionCodeBuilder::append_new_code(SiiIRCodePtr new_code) {
+  if(appended_label_ != nullptr) {
+    start_group(group_of(appended_label_));
+    appended_label_.reset();
+  } else if(current_ == nullptr) {
+    // Nothing branches to a code following a terminator, its group is
+    // dropped by finish_function().
+    start_group(group_of(std::make_shared<Label>()));
+  }
+  BasicGroup* group = current_;
+  switch(new_code->kind_) {
+  case SiiIRCodeKind::GOTO:
+  case SiiIRCodeKind::CONDITION_BRANCH:
+    if(!link_branch(group, *new_code)) {
+      unlinked_groups_.push_back(group);
+    }
+    current_ = nullptr;
+    break;
+  case SiiIRCodeKind::RETURN: current_ = nullptr; break;
+  default: break;
+  }
+  push_code(group, std::move(new_code));
+}
+
+bool FunctionCodeBuilder::link_branch(BasicGroup* group,
+                                      SiiIRCode&  branch) {
+  std::vector<const Use*> destinations;
+  if(auto* jump = dyn_cast<SiiIRGoto>(&branch)) {
+    destinations = { &jump->dest_label() };
+  } else {
+    auto& condition_branch = cast<SiiIRConditionBranch>(branch);
+    destinations
+        = { &condition_branch.true_label(), &condition_branch.false_label() };
+  }
+  for(const Use* destination: destinations) {
+    if(destination->value_ == nullptr) {
+      return false;
+    }
+  }
+  for(const Use* destination: destinations) {
+    Link(group, group_of(cast<Label>(destination->value_)));
+  }
+  return true;
+}
+
+SiiIRAllocaPtr FunctionCodeBuilder::append_alloca(uint32_t bytes,
+                                                  TypePtr  type) {
+  SiiIRAllocaPtr alloca = ArenaNew<SiiIRAlloca>(arena_, bytes, type);
+  push_code(entry_.get(), alloca);
+  return alloca;
+}
+
+// The codes are taken out of their groups, the first code of each group
+// getting the label of the group back, so BuildFunction() splits them the
+// same way.
+std::shared_ptr<std::vector<SiiIRCodePtr>> FunctionCodeBuilder::finish() {
+  if(appended_label_ != nullptr) {
+    append_nope();
+  }
+  std::shared_ptr<std::vector<SiiIRCodePtr>> result
+      = std::make_shared<std::vector<SiiIRCodePtr>>();
+  auto take_codes = [&](BasicGroup& group) {
+    auto& codes = group.codes_;
+    while(!codes.empty()) {
+      SiiIRCodePtr code = codes.begin().shared();
+      codes.erase(codes.begin());
+      code->group_ = nullptr;
+      result->push_back(std::move(code));
+    }
+  };
+  take_codes(*entry_);
+  for(BasicGroupPtr& group: placed_groups_) {
+    group->codes_.begin()->label_ = group->label_;
+    take_codes(*group);
+  }
+  reset();
+  return result;
+}
+
+FunctionPtr FunctionCodeBuilder::finish_function(FunctionContextPtr ctx,
+                                                 std::string        name) {
+  if(appended_label_ != nullptr) {
+    append_nope();
+  }
+  for(BasicGroup* group: unlinked_groups_) {
+    if(!link_branch(group, *--group->codes_.end())) {
+      throw std::runtime_error("Branch without a destination");
+    }
+  }
+  unlinked_groups_.clear();
+  if(!pending_groups_.empty()) {
+    throw std::runtime_error("Branch to a label that is never appended");
+  }
+  FunctionPtr func = std::make_shared<Function>();
+  func->entry_     = entry_.get();
+  if(!placed_groups_.empty()) {
+    push_code(entry_.get(),
+              ArenaNew<SiiIRGoto>(arena_, placed_groups_.front()->label_));
+    Link(entry_.get(), placed_groups_.front().get());
+  }
+  func->basic_groups_.reserve(placed_groups_.size() + 1);
+  func->basic_groups_.push_back(std::move(entry_));
+  for(BasicGroupPtr& group: placed_groups_) {
+    func->basic_groups_.push_back(std::move(group));
+  }
+  reset();
+  RemoveUnreachableGroups(*func);
+  func->ctx_  = std::move(ctx);
+  func->name_ = std::move(name);
+  func->renumber();
+  return func;
+}
+
+CodeBuilderPtr CreateCodeBuilder(ArenaPtr arena) {
+  return std::make_shared<CodeBuilderImpl>(std::move(arena));
+}
+
+CodeBuilderPtr CreateFunctionCodeBuilder(ArenaPtr arena) {
+  return std::make_shared<FunctionCodeBuilder>(std::move(arena));
 }
 
 }  // namespace SiiIR
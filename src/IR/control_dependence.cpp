@@ -0,0 +1,72 @@
+#include "IR/control_dependence.h"
+
+namespace SiiIR {
+
+// Pack (key, value) pairs into CSR arrays indexed by key.
+static void
+PackByKey(const std::vector<std::pair<uint32_t, uint32_t>>& pairs,
+          size_t                                            size,
+          std::vector<uint32_t>&                            begin,
+          std::vector<uint32_t>&                            packed) {
+  begin.assign(size + 1, 0);
+  for(const auto& [key, value]: pairs) {
+    begin[key + 1]++;
+  }
+  for(size_t i = 0; i < size; i++) {
+    begin[i + 1] += begin[i];
+  }
+  std::vector<uint32_t> next(begin.begin(), begin.end() - 1);
+  packed.resize(pairs.size());
+  for(const auto& [key, value]: pairs) {
+    packed[next[key]++] = value;
+  }
+}
+
+ControlDependenceGraphPtr
+BuildControlDependenceGraph(const FrozenFunction& func) {
+  auto   result                = std::make_shared<ControlDependenceGraph>();
+  result->post_dominator_tree_ = BuildPostDominatorTree(func);
+  const DominatorTree& tree        = *result->post_dominator_tree_;
+  size_t               group_count = func.group_count();
+
+  // Going up the post-dominator tree from a successor of a branch to the
+  // immediate post-dominator of the branch visits exactly the groups that
+  // have the branch in their post-dominance frontier.
+  std::vector<std::pair<uint32_t, uint32_t>> dependences;
+  // Last branch that reached each group, to stop walks meeting an earlier
+  // walk from the same branch.
+  std::vector<uint32_t> reached_by(group_count, FrozenFunction::kNoIndex);
+  for(uint32_t branch = 0; branch < group_count; branch++) {
+    if(!tree.contains(branch)) {
+      continue;
+    }
+    uint32_t stop = tree.immediate_dominator_[branch];
+    for(uint32_t runner: func.successors(branch)) {
+      if(!tree.contains(runner)) {
+        continue;
+      }
+      while(runner != stop && reached_by[runner] != branch) {
+        reached_by[runner] = branch;
+        dependences.push_back({ runner, branch });
+        runner = tree.immediate_dominator_[runner];
+      }
+    }
+  }
+
+  PackByKey(dependences,
+            group_count,
+            result->dependence_begin_,
+            result->dependences_);
+  for(auto& [group, branch]: dependences) {
+    std::swap(group, branch);
+  }
+  PackByKey(
+      dependences, group_count, result->dependent_begin_, result->dependents_);
+  return result;
+}
+
+ControlDependenceGraphPtr BuildControlDependenceGraph(FunctionPtr func) {
+  return BuildControlDependenceGraph(*Freeze(*func));
+}
+
+}  // namespace SiiIR
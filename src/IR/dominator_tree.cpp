@@ -1,9 +1,105 @@
 #include "IR/dominator_tree.h"
-#include <map>
-#include <queue>
+#include <algorithm>
+#include <cstdint>
 
 namespace SiiIR {
 
+DominatorTreePtr
+PackDominatorTree(std::vector<BasicGroup*>     groups,
+                  uint32_t                     root,
+                  std::vector<uint32_t>        immediate_dominator,
+                  const std::vector<uint32_t>& order) {
+  constexpr uint32_t kNoIndex    = DominatorTree::kNoIndex;
+  size_t             group_count = groups.size();
+  auto               tree        = std::make_shared<DominatorTree>();
+  tree->groups_              = std::move(groups);
+  tree->root_                = root;
+  tree->immediate_dominator_ = std::move(immediate_dominator);
+  const std::vector<uint32_t>& parent_of = tree->immediate_dominator_;
+
+  std::vector<uint32_t>& child_begin = tree->child_begin_;
+  child_begin.assign(group_count + 1, 0);
+  for(uint32_t group: order) {
+    if(parent_of[group] != kNoIndex) {
+      child_begin[parent_of[group] + 1]++;
+    }
+  }
+  for(size_t i = 0; i < group_count; i++) {
+    child_begin[i + 1] += child_begin[i];
+  }
+  std::vector<uint32_t> next_child(child_begin.begin(), child_begin.end() - 1);
+  tree->children_.resize(child_begin.back());
+  for(uint32_t group: order) {
+    if(parent_of[group] != kNoIndex) {
+      tree->children_[next_child[parent_of[group]]++] = group;
+    }
+  }
+
+  std::vector<uint32_t>& level = tree->level_;
+  std::vector<uint32_t>& jump  = tree->jump_;
+  level.assign(group_count, 0);
+  jump.assign(group_count, kNoIndex);
+  tree->preorder_number_.assign(group_count, kNoIndex);
+  tree->postorder_number_.assign(group_count, kNoIndex);
+  tree->preorder_.reserve(order.size());
+  // (group, next child) of the groups on the path from the root.
+  std::vector<std::pair<uint32_t, uint32_t>> stack;
+  auto enter = [&](uint32_t group) {
+    tree->preorder_number_[group] = tree->preorder_.size();
+    tree->preorder_.push_back(group);
+    uint32_t parent = parent_of[group];
+    if(parent == kNoIndex) {
+      jump[group] = group;
+    } else {
+      level[group] = level[parent] + 1;
+      // Two jumps of the same length merge into one twice as long.
+      uint32_t up = jump[parent];
+      jump[group] = level[parent] - level[up] == level[up] - level[jump[up]]
+                        ? jump[up]
+                        : parent;
+    }
+    stack.push_back({ group, child_begin[group] });
+  };
+  uint32_t postorder_number = 0;
+  enter(tree->root_);
+  while(!stack.empty()) {
+    auto& [group, next] = stack.back();
+    if(next == child_begin[group + 1]) {
+      tree->postorder_number_[group] = postorder_number++;
+      stack.pop_back();
+      continue;
+    }
+    uint32_t child = tree->children_[next++];
+    enter(child);
+  }
+  return tree;
+}
+
+uint32_t DominatorTree::nearest_common_dominator(uint32_t a, uint32_t b) const {
+  if(!contains(a) || !contains(b)) {
+    return kNoIndex;
+  }
+  // The ancestors of a dominating b are the ones from the root down to the
+  // answer, so climb as long as the landing group does not dominate b.
+  while(!dominates(a, b)) {
+    a = dominates(jump_[a], b) ? immediate_dominator_[a] : jump_[a];
+  }
+  return a;
+}
+
+uint32_t DominatorTree::group_index(const BasicGroup* group) const {
+  uint32_t number = group->number_;
+  return number < groups_.size() && groups_[number] == group ? number
+                                                             : kNoIndex;
+}
+
+bool DominatorTree::dominates(const BasicGroup* a, const BasicGroup* b) const {
+  uint32_t a_index = group_index(a);
+  uint32_t b_index = group_index(b);
+  return a_index != kNoIndex && b_index != kNoIndex
+         && dominates(a_index, b_index);
+}
+
 class UnionFind {
 public:
   UnionFind(std::vector<int64_t>& value, size_t size)
@@ -24,72 +120,91 @@ public:
   void union_two_nodes(int64_t x, int64_t y) { father_[x] = y; }
 
 private:
-  int merge_path(int64_t x) {
-    if(father_[x] == x) return x;
-    int grand = merge_path(father_[x]);
-    if(value_[min_ancestor_[father_[x]]] < value_[min_ancestor_[x]]) {
-      min_ancestor_[x] = min_ancestor_[father_[x]];
+  // Compress the path from x to its root, carrying the minimum along. The
+  // path is walked with a loop since it may be as long as the function.
+  int64_t merge_path(int64_t x) {
+    path_.clear();
+    int64_t root = x;
+    while(father_[root] != root) {
+      path_.push_back(root);
+      root = father_[root];
+    }
+    // Nodes nearer the root come first, as the recursion would unwind.
+    for(auto iter = path_.rbegin(); iter != path_.rend(); ++iter) {
+      int64_t node = *iter;
+      if(value_[min_ancestor_[father_[node]]] < value_[min_ancestor_[node]]) {
+        min_ancestor_[node] = min_ancestor_[father_[node]];
+      }
+      father_[node] = root;
     }
-    return father_[x] = grand;
+    return root;
   }
 
   std::vector<int64_t>& value_;
   std::vector<int64_t>  min_ancestor_;
   std::vector<int64_t>  father_;
+  std::vector<int64_t>  path_;
 };
 
-class DominatorTreeBuilder {
+class LengauerTarjanBuilder {
 public:
-  DominatorTreeBuilder(FunctionPtr func)
-      : func_(std::move(func)) {}
+  LengauerTarjanBuilder(const FrozenFunction& func)
+      : func_(func) {}
   DominatorTreePtr build_dominator_tree();
-  void             assign_index(BasicGroup* basic_group_node, int64_t& index);
+  void             assign_index(uint32_t group, int64_t& index);
   void             build_immediate_dominators();
-  DominatorTreePtr consturct_dominator_tree();
+  DominatorTreePtr construct_dominator_tree();
 
 private:
-  FunctionPtr                       func_;
-  std::map<BasicGroup*, int64_t>    basic_group_to_index_;
-  int64_t                           node_count = 0;
-  std::vector<BasicGroup*>          index_to_basic_group_;
-  std::vector<int64_t>              father_;
-  std::vector<std::vector<int64_t>> previous_ids_;
-  // bucket[i] is the list of nodes whose semi-dominator is i.
-  std::vector<std::vector<int64_t>> bucket_;
+  const FrozenFunction& func_;
+  // DFS number of each group, -1 for groups not reached yet.
+  std::vector<int64_t>  group_to_index_;
+  int64_t               node_count = 0;
+  std::vector<uint32_t> index_to_group_;
+  std::vector<int64_t>  father_;
+  // bucket_head_[i] starts the list of nodes whose semi-dominator is i,
+  // chained through bucket_next_. -1 ends a list.
+  std::vector<int64_t>  bucket_head_;
+  std::vector<int64_t>  bucket_next_;
   // semi-dominator[i] is the semi-dominator of node i.
-  std::vector<int64_t>              semi_dominator_;
+  std::vector<int64_t>  semi_dominator_;
   // idom[i] is the immediate dominator of node i.
-  std::vector<int64_t>              immediate_dominator_;
+  std::vector<int64_t>  immediate_dominator_;
 };
 
-DominatorTreePtr DominatorTreeBuilder::build_dominator_tree() {
-  node_count = 0;
-  father_.clear();
-  father_.resize(func_->basic_groups_.size());
-  previous_ids_.clear();
-  previous_ids_.resize(func_->basic_groups_.size());
-  bucket_.clear();
-  bucket_.resize(func_->basic_groups_.size());
-  semi_dominator_.clear();
-  semi_dominator_.resize(func_->basic_groups_.size());
-  immediate_dominator_.clear();
-  immediate_dominator_.resize(func_->basic_groups_.size());
+DominatorTreePtr LengauerTarjanBuilder::build_dominator_tree() {
+  size_t group_count = func_.group_count();
+  node_count         = 0;
+  group_to_index_.assign(group_count, -1);
+  index_to_group_.clear();
+  index_to_group_.reserve(func_.reverse_postorder_.size());
+  father_.assign(group_count, 0);
+  bucket_head_.assign(group_count, -1);
+  bucket_next_.assign(group_count, -1);
+  semi_dominator_.assign(group_count, 0);
+  immediate_dominator_.assign(group_count, 0);
   build_immediate_dominators();
-  return consturct_dominator_tree();
+  return construct_dominator_tree();
 }
 
-void DominatorTreeBuilder::build_immediate_dominators() {
-  assign_index(func_->entry_, node_count);
+void LengauerTarjanBuilder::build_immediate_dominators() {
+  assign_index(func_.entry_, node_count);
   UnionFind union_find(semi_dominator_, node_count);
   for(int64_t i = node_count - 1; i > 0; --i) {
-    for(auto previous: previous_ids_[i]) {
+    for(uint32_t previous_group: func_.predecessors(index_to_group_[i])) {
+      int64_t previous = group_to_index_[previous_group];
+      if(previous < 0) {
+        continue;
+      }
       semi_dominator_[i]
           = std::min(semi_dominator_[i],
                      semi_dominator_[union_find.get_min_ancestor(previous)]);
     }
-    bucket_[semi_dominator_[i]].push_back(i);
+    bucket_next_[i]                  = bucket_head_[semi_dominator_[i]];
+    bucket_head_[semi_dominator_[i]] = i;
     union_find.union_two_nodes(i, father_[i]);
-    for(auto node: bucket_[father_[i]]) {
+    for(int64_t node = bucket_head_[father_[i]]; node >= 0;
+        node         = bucket_next_[node]) {
       int64_t min_ancestor = union_find.get_min_ancestor(node);
       if(semi_dominator_[min_ancestor] == semi_dominator_[node]) {
         immediate_dominator_[node] = father_[i];
@@ -97,7 +212,7 @@ void DominatorTreeBuilder::build_immediate_dominators() {
         immediate_dominator_[node] = min_ancestor;
       }
     }
-    bucket_[father_[i]].clear();
+    bucket_head_[father_[i]] = -1;
   }
   for(int64_t i = 1; i < node_count; ++i) {
     if(immediate_dominator_[i] != semi_dominator_[i]) {
@@ -106,54 +221,207 @@ void DominatorTreeBuilder::build_immediate_dominators() {
   }
 }
 
-DominatorTreePtr DominatorTreeBuilder::consturct_dominator_tree() {
-  DominatorTreePtr dominator_tree = std::make_shared<DominatorTree>(
-      std::make_shared<DominatorTreeNode>(func_->entry_));
+DominatorTreePtr LengauerTarjanBuilder::construct_dominator_tree() {
+  std::vector<uint32_t> immediate_dominator(func_.group_count(),
+                                            DominatorTree::kNoIndex);
   for(int64_t i = 1; i < node_count; ++i) {
-    DominatorTreeNodePtr new_dominator_tree_node
-        = std::make_shared<DominatorTreeNode>(index_to_basic_group_[i]);
-    const DominatorTreeNodePtr& parent_node
-        = dominator_tree->nodes_[immediate_dominator_[i]];
-    new_dominator_tree_node->parent_ = parent_node.get();
-    parent_node->children_.push_back(new_dominator_tree_node.get());
-    dominator_tree->nodes_.push_back(std::move(new_dominator_tree_node));
-  }
-  // Assign level
-  std::queue<DominatorTreeNode*> working_queue;
-  working_queue.push(dominator_tree->root_);
-  while(!working_queue.empty()) {
-    DominatorTreeNode* current_node = working_queue.front();
-    working_queue.pop();
-    for(auto child: current_node->children_) {
-      child->level = current_node->level + 1;
-      working_queue.push(child);
-    }
-  }
-  return dominator_tree;
+    immediate_dominator[index_to_group_[i]]
+        = index_to_group_[immediate_dominator_[i]];
+  }
+  return PackDominatorTree(func_.groups_,
+                           func_.entry_,
+                           std::move(immediate_dominator),
+                           func_.reverse_postorder_);
 }
 
-void DominatorTreeBuilder::assign_index(BasicGroup* basic_group_node,
-                                        int64_t&    index) {
-  int64_t currnt_index                    = index++;
-  basic_group_to_index_[basic_group_node] = currnt_index;
-  index_to_basic_group_.push_back(basic_group_node);
-  for(auto* follow: basic_group_node->follows_) {
-    int64_t follow_index = 0;
-    if(basic_group_to_index_.find(follow) == basic_group_to_index_.end()) {
-      follow_index = index;
-      assign_index(follow, index);
-      father_[follow_index]         = currnt_index;
+// Number the groups reachable from group in DFS preorder. The DFS keeps
+// its own stack of (node, next successor) so deep CFGs are fine.
+void LengauerTarjanBuilder::assign_index(uint32_t group, int64_t& index) {
+  std::vector<std::pair<int64_t, size_t>> stack;
+  auto visit = [&](uint32_t node) {
+    int64_t node_index    = index++;
+    group_to_index_[node] = node_index;
+    index_to_group_.push_back(node);
+    stack.push_back({ node_index, 0 });
+    return node_index;
+  };
+  visit(group);
+  while(!stack.empty()) {
+    auto& [current_index, next] = stack.back();
+    IndexRange follows = func_.successors(index_to_group_[current_index]);
+    if(next == follows.size()) {
+      stack.pop_back();
+      continue;
+    }
+    int64_t  from   = current_index;
+    uint32_t follow = follows[next++];
+    if(group_to_index_[follow] < 0) {
+      int64_t follow_index          = visit(follow);
+      father_[follow_index]         = from;
       semi_dominator_[follow_index] = follow_index;
-    } else {
-      follow_index = basic_group_to_index_[follow];
     }
-    previous_ids_[follow_index].push_back(currnt_index);
   }
 }
 
-DominatorTreePtr BuildDominatorTree(FunctionPtr func) {
-  DominatorTreeBuilder builder(func);
+// Cooper, Harvey and Kennedy's iterative algorithm: visit the groups in
+// reverse postorder and intersect the dominators of their predecessors
+// until nothing changes. Groups are renumbered by their position in reverse
+// postorder, so an intersection only climbs towards smaller numbers.
+// Returns false, leaving immediate_dominator alone, when the dominators are
+// still changing after pass_limit passes.
+static bool
+IterativeImmediateDominators(const FrozenFunction&  func,
+                             size_t                 pass_limit,
+                             std::vector<uint32_t>& immediate_dominator) {
+  constexpr uint32_t           kNoIndex = DominatorTree::kNoIndex;
+  const std::vector<uint32_t>& order    = func.reverse_postorder_;
+  uint32_t                     size     = order.size();
+  std::vector<uint32_t>        position(func.group_count(), kNoIndex);
+  for(uint32_t i = 0; i < size; i++) {
+    position[order[i]] = i;
+  }
+  // Reachable predecessors by position, CSR encoded.
+  std::vector<uint32_t> predecessor_begin{ 0 };
+  std::vector<uint32_t> predecessors;
+  predecessor_begin.reserve(size + 1);
+  for(uint32_t group: order) {
+    for(uint32_t predecessor: func.predecessors(group)) {
+      if(position[predecessor] != kNoIndex) {
+        predecessors.push_back(position[predecessor]);
+      }
+    }
+    predecessor_begin.push_back(predecessors.size());
+  }
+
+  std::vector<uint32_t> dominator(size, kNoIndex);
+  auto                  intersect = [&](uint32_t a, uint32_t b) {
+    while(a != b) {
+      while(a > b) {
+        a = dominator[a];
+      }
+      while(b > a) {
+        b = dominator[b];
+      }
+    }
+    return a;
+  };
+  dominator[0]  = 0;
+  bool   changed = true;
+  size_t passes  = 0;
+  while(changed) {
+    if(passes++ == pass_limit) {
+      return false;
+    }
+    changed = false;
+    for(uint32_t i = 1; i < size; i++) {
+      uint32_t new_dominator = kNoIndex;
+      for(uint32_t j = predecessor_begin[i]; j < predecessor_begin[i + 1];
+          j++) {
+        uint32_t predecessor = predecessors[j];
+        if(dominator[predecessor] == kNoIndex) {
+          continue;
+        }
+        new_dominator = new_dominator == kNoIndex
+                            ? predecessor
+                            : intersect(predecessor, new_dominator);
+      }
+      if(dominator[i] != new_dominator) {
+        dominator[i] = new_dominator;
+        changed      = true;
+      }
+    }
+  }
+
+  immediate_dominator.assign(func.group_count(), kNoIndex);
+  for(uint32_t i = 1; i < size; i++) {
+    immediate_dominator[order[i]] = order[dominator[i]];
+  }
+  return true;
+}
+
+DominatorTreePtr BuildDominatorTree(const FrozenFunction& func,
+                                    DominatorAlgorithm    algorithm) {
+  size_t pass_limit = SIZE_MAX;
+  if(algorithm == DominatorAlgorithm::AUTO) {
+    algorithm  = DominatorAlgorithm::ITERATIVE;
+    pass_limit = kIterativeDominatorPassLimit;
+  }
+  std::vector<uint32_t> immediate_dominator;
+  if(algorithm == DominatorAlgorithm::ITERATIVE
+     && IterativeImmediateDominators(func, pass_limit, immediate_dominator)) {
+    return PackDominatorTree(func.groups_,
+                             func.entry_,
+                             std::move(immediate_dominator),
+                             func.reverse_postorder_);
+  }
+  LengauerTarjanBuilder builder(func);
   return builder.build_dominator_tree();
 }
 
+DominatorTreePtr BuildDominatorTree(FunctionPtr        func,
+                                    DominatorAlgorithm algorithm) {
+  return BuildDominatorTree(*Freeze(*func), algorithm);
+}
+
+// The CFG of func upside down, entered at a virtual exit of index
+// func.group_count() that leads to every group without successors. Only the
+// groups, the edges and the reverse postorder are filled in.
+static FrozenFunction ReverseCFG(const FrozenFunction& func) {
+  uint32_t       exit = func.group_count();
+  FrozenFunction reversed;
+  reversed.groups_ = func.groups_;
+  reversed.groups_.push_back(nullptr);
+  reversed.entry_ = exit;
+
+  reversed.successor_begin_ = func.predecessor_begin_;
+  reversed.successors_      = func.predecessors_;
+  reversed.predecessor_begin_.reserve(exit + 2);
+  reversed.predecessor_begin_.push_back(0);
+  for(uint32_t group = 0; group < exit; group++) {
+    IndexRange successors = func.successors(group);
+    if(successors.empty()) {
+      reversed.successors_.push_back(group);
+      reversed.predecessors_.push_back(exit);
+    } else {
+      reversed.predecessors_.insert(
+          reversed.predecessors_.end(), successors.begin(), successors.end());
+    }
+    reversed.predecessor_begin_.push_back(reversed.predecessors_.size());
+  }
+  reversed.successor_begin_.push_back(reversed.successors_.size());
+  reversed.predecessor_begin_.push_back(reversed.predecessors_.size());
+
+  // (group, next successor) of the groups on the path from the exit.
+  std::vector<std::pair<uint32_t, uint32_t>> stack{ { exit, 0 } };
+  std::vector<bool>                          visited(exit + 1);
+  visited[exit] = true;
+  while(!stack.empty()) {
+    auto& [group, next] = stack.back();
+    IndexRange successors = reversed.successors(group);
+    if(next == successors.size()) {
+      reversed.reverse_postorder_.push_back(group);
+      stack.pop_back();
+      continue;
+    }
+    uint32_t follow = successors[next++];
+    if(!visited[follow]) {
+      visited[follow] = true;
+      stack.push_back({ follow, 0 });
+    }
+  }
+  std::reverse(reversed.reverse_postorder_.begin(),
+               reversed.reverse_postorder_.end());
+  return reversed;
+}
+
+DominatorTreePtr BuildPostDominatorTree(const FrozenFunction& func,
+                                        DominatorAlgorithm    algorithm) {
+  return BuildDominatorTree(ReverseCFG(func), algorithm);
+}
+
+DominatorTreePtr BuildPostDominatorTree(FunctionPtr        func,
+                                        DominatorAlgorithm algorithm) {
+  return BuildPostDominatorTree(*Freeze(*func), algorithm);
+}
+
 }  // namespace SiiIR
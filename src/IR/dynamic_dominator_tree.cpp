@@ -0,0 +1,406 @@
+#include "IR/dynamic_dominator_tree.h"
+#include <algorithm>
+#include <map>
+#include <queue>
+#include <stdexcept>
+
+namespace SiiIR {
+
+DynamicDominatorTree::DynamicDominatorTree(const FrozenFunction& func)
+    : groups_(func.groups_)
+    , root_(func.entry_) {
+  size_t group_count = func.group_count();
+  successors_.resize(group_count);
+  predecessors_.resize(group_count);
+  children_.resize(group_count);
+  packed_ = BuildDominatorTree(func);
+  for(uint32_t group = 0; group < group_count; group++) {
+    IndexRange successors   = func.successors(group);
+    IndexRange predecessors = func.predecessors(group);
+    IndexRange children     = packed_->children(group);
+    successors_[group].assign(successors.begin(), successors.end());
+    predecessors_[group].assign(predecessors.begin(), predecessors.end());
+    children_[group].assign(children.begin(), children.end());
+  }
+  immediate_dominator_ = packed_->immediate_dominator_;
+  level_               = packed_->level_;
+  mark_.assign(group_count, 0);
+  position_.assign(group_count, kNoIndex);
+}
+
+uint32_t DynamicDominatorTree::add_group(BasicGroup* group) {
+  groups_.push_back(group);
+  successors_.emplace_back();
+  predecessors_.emplace_back();
+  children_.emplace_back();
+  immediate_dominator_.push_back(kNoIndex);
+  level_.push_back(0);
+  mark_.push_back(0);
+  position_.push_back(kNoIndex);
+  packed_ = nullptr;
+  return groups_.size() - 1;
+}
+
+void DynamicDominatorTree::insert_edge(uint32_t from, uint32_t to) {
+  pending_.push_back({ from, to, true });
+}
+
+void DynamicDominatorTree::delete_edge(uint32_t from, uint32_t to) {
+  pending_.push_back({ from, to, false });
+}
+
+void DynamicDominatorTree::apply_updates() {
+  // Net count of each edge, in the order the edges were first updated.
+  std::map<std::pair<uint32_t, uint32_t>, int64_t> net;
+  std::vector<std::pair<uint32_t, uint32_t>>       edges;
+  for(const Update& update: pending_) {
+    auto [iter, inserted] = net.insert({ { update.from, update.to }, 0 });
+    if(inserted) {
+      edges.push_back(iter->first);
+    }
+    iter->second += update.insert ? 1 : -1;
+  }
+  pending_.clear();
+  // Each remaining edge is applied on its own, deletions first, so the tree
+  // never sees more edges than it ends with.
+  for(auto [from, to]: edges) {
+    for(int64_t i = net[{ from, to }]; i < 0; i++) {
+      apply_delete(from, to);
+      packed_ = nullptr;
+    }
+  }
+  for(auto [from, to]: edges) {
+    for(int64_t i = net[{ from, to }]; i > 0; i--) {
+      apply_insert(from, to);
+      packed_ = nullptr;
+    }
+  }
+}
+
+uint32_t DynamicDominatorTree::nearest_common_dominator(uint32_t a,
+                                                        uint32_t b) const {
+  if(!contains(a) || !contains(b)) {
+    return kNoIndex;
+  }
+  while(a != b) {
+    if(level_[a] < level_[b]) {
+      b = immediate_dominator_[b];
+    } else {
+      a = immediate_dominator_[a];
+    }
+  }
+  return a;
+}
+
+bool DynamicDominatorTree::dominates(uint32_t a, uint32_t b) const {
+  if(!contains(a) || !contains(b)) {
+    return false;
+  }
+  while(level_[b] > level_[a]) {
+    b = immediate_dominator_[b];
+  }
+  return a == b;
+}
+
+DominatorTreePtr DynamicDominatorTree::tree() {
+  if(packed_ == nullptr) {
+    std::vector<uint32_t> order;
+    for(uint32_t group = 0; group < groups_.size(); group++) {
+      if(contains(group)) {
+        order.push_back(group);
+      }
+    }
+    packed_ = PackDominatorTree(groups_, root_, immediate_dominator_, order);
+  }
+  return packed_;
+}
+
+void DynamicDominatorTree::apply_insert(uint32_t from, uint32_t to) {
+  successors_[from].push_back(to);
+  predecessors_[to].push_back(from);
+  if(!contains(from)) {
+    return;
+  }
+  if(!contains(to)) {
+    insert_unreachable(from, to);
+    return;
+  }
+  insert_reachable(from, to);
+}
+
+void DynamicDominatorTree::insert_reachable(uint32_t from, uint32_t to) {
+  uint32_t nearest     = nearest_common_dominator(from, to);
+  uint32_t below_level = level_[nearest] + 1;
+  // Already right below nearest, or dominating from.
+  if(level_[to] <= below_level) {
+    return;
+  }
+  // Depth based search of Georgiadis et al. A group is affected when the
+  // new edge leads to it through groups at least as deep as itself and
+  // deeper than below_level. Groups are taken deepest first, and from each
+  // one the walk goes on through deeper groups, which are only passed
+  // through, collecting the groups no deeper than it for later.
+  mark_epoch_++;
+  std::priority_queue<std::pair<uint32_t, uint32_t>> bucket;
+  std::vector<uint32_t>                              affected;
+  std::vector<uint32_t>                              deeper;
+  bucket.push({ level_[to], to });
+  mark_[to] = mark_epoch_;
+  while(!bucket.empty()) {
+    uint32_t group = bucket.top().second;
+    uint32_t depth = bucket.top().first;
+    bucket.pop();
+    affected.push_back(group);
+    while(true) {
+      for(uint32_t follow: successors_[group]) {
+        if(level_[follow] <= below_level || mark_[follow] == mark_epoch_) {
+          continue;
+        }
+        mark_[follow] = mark_epoch_;
+        if(level_[follow] > depth) {
+          deeper.push_back(follow);
+        } else {
+          bucket.push({ level_[follow], follow });
+        }
+      }
+      if(deeper.empty()) {
+        break;
+      }
+      group = deeper.back();
+      deeper.pop_back();
+    }
+  }
+
+  // Every affected group moves right below nearest, taking its subtree
+  // along.
+  for(uint32_t group: affected) {
+    auto& siblings = children_[immediate_dominator_[group]];
+    siblings.erase(std::find(siblings.begin(), siblings.end(), group));
+    set_immediate_dominator(group, nearest);
+  }
+  for(uint32_t group: affected) {
+    std::vector<uint32_t> moved = subtree(group);
+    for(size_t i = 1; i < moved.size(); i++) {
+      level_[moved[i]] = level_[immediate_dominator_[moved[i]]] + 1;
+    }
+  }
+}
+
+void DynamicDominatorTree::apply_delete(uint32_t from, uint32_t to) {
+  auto& successors   = successors_[from];
+  auto& predecessors = predecessors_[to];
+  auto  successor    = std::find(successors.begin(), successors.end(), to);
+  if(successor == successors.end()) {
+    throw std::logic_error("Deleting an edge that is not in the CFG");
+  }
+  successors.erase(successor);
+  predecessors.erase(
+      std::find(predecessors.begin(), predecessors.end(), from));
+  if(!contains(from) || !contains(to)
+     || std::find(successors.begin(), successors.end(), to)
+            != successors.end()) {
+    return;
+  }
+  uint32_t nearest = nearest_common_dominator(from, to);
+  // A back edge to a dominator carries no path the tree depends on.
+  if(nearest == to) {
+    return;
+  }
+  // Nor does one when another predecessor of to dominates from, as every
+  // path through the edge may go through that predecessor instead. Only the
+  // dominators of from up to nearest are looked at, which is no more than
+  // the subtree rebuilt below.
+  mark_epoch_++;
+  for(uint32_t group = from; group != nearest;
+      group          = immediate_dominator_[group]) {
+    mark_[group] = mark_epoch_;
+  }
+  mark_[nearest] = mark_epoch_;
+  for(uint32_t predecessor: predecessors) {
+    if(mark_[predecessor] == mark_epoch_) {
+      return;
+    }
+  }
+  if(immediate_dominator_[to] == from) {
+    bool reachable = false;
+    for(uint32_t predecessor: predecessors) {
+      if(contains(predecessor) && !dominates(to, predecessor)) {
+        reachable = true;
+        break;
+      }
+    }
+    if(!reachable) {
+      delete_unreachable(to);
+      return;
+    }
+  }
+  recompute_subtree(nearest);
+}
+
+void DynamicDominatorTree::insert_unreachable(uint32_t from, uint32_t to) {
+  // The groups newly reached, which only the new edge leads into.
+  mark_epoch_++;
+  std::vector<uint32_t> reached{ to };
+  mark_[to] = mark_epoch_;
+  for(size_t i = 0; i < reached.size(); i++) {
+    for(uint32_t follow: successors_[reached[i]]) {
+      if(!contains(follow) && mark_[follow] != mark_epoch_) {
+        mark_[follow] = mark_epoch_;
+        reached.push_back(follow);
+      }
+    }
+  }
+  // Edges from them into the tree, collected before the marks get reused.
+  std::vector<std::pair<uint32_t, uint32_t>> into_tree;
+  for(uint32_t group: reached) {
+    for(uint32_t follow: successors_[group]) {
+      if(contains(follow)) {
+        into_tree.push_back({ group, follow });
+      }
+    }
+  }
+
+  set_immediate_dominator(to, from);
+  build_subtree(to);
+  // Each of those edges now acts as an insertion between two groups of the
+  // tree.
+  for(auto [group, follow]: into_tree) {
+    insert_reachable(group, follow);
+  }
+}
+
+void DynamicDominatorTree::delete_unreachable(uint32_t group) {
+  uint32_t              parent = immediate_dominator_[group];
+  std::vector<uint32_t> lost   = subtree(group);
+  auto&                 siblings = children_[parent];
+  siblings.erase(std::find(siblings.begin(), siblings.end(), group));
+  for(uint32_t node: lost) {
+    immediate_dominator_[node] = kNoIndex;
+    level_[node]               = 0;
+    children_[node].clear();
+  }
+  // Every path through the lost groups went through parent, so the groups
+  // they lead to lost paths from parent and may have a deeper dominator.
+  uint32_t nearest = kNoIndex;
+  for(uint32_t node: lost) {
+    for(uint32_t follow: successors_[node]) {
+      if(contains(follow)) {
+        nearest = nearest_common_dominator(
+            nearest == kNoIndex ? parent : nearest, follow);
+      }
+    }
+  }
+  if(nearest != kNoIndex) {
+    recompute_subtree(nearest);
+  }
+}
+
+void DynamicDominatorTree::recompute_subtree(uint32_t root) {
+  mark_epoch_++;
+  for(uint32_t node: subtree(root)) {
+    mark_[node] = mark_epoch_;
+    children_[node].clear();
+  }
+  build_subtree(root);
+}
+
+void DynamicDominatorTree::build_subtree(uint32_t root) {
+  // Depth first preorder of the marked groups reachable from root, groups
+  // being referred to by their position in it below.
+  std::vector<uint32_t>                      order{ root };
+  std::vector<uint32_t>                      parent{ 0 };
+  std::vector<std::pair<uint32_t, uint32_t>> stack{ { root, 0 } };
+  position_[root] = 0;
+  while(!stack.empty()) {
+    auto& [group, next] = stack.back();
+    if(next == successors_[group].size()) {
+      stack.pop_back();
+      continue;
+    }
+    uint32_t follow = successors_[group][next++];
+    if(mark_[follow] == mark_epoch_ && position_[follow] == kNoIndex) {
+      position_[follow] = order.size();
+      parent.push_back(position_[group]);
+      order.push_back(follow);
+      stack.push_back({ follow, 0 });
+    }
+  }
+
+  // Semi-NCA: semi-dominators as in Lengauer and Tarjan, from the last
+  // group back, then each immediate dominator as the nearest ancestor of
+  // the parent not below the semi-dominator. A predecessor outside of the
+  // region cannot be reachable, as root dominates the region.
+  uint32_t              size = order.size();
+  std::vector<uint32_t> semi(size);
+  std::vector<uint32_t> label(size);
+  // Link towards the root of the processed forest, compressed by eval.
+  std::vector<uint32_t> link = parent;
+  std::vector<uint32_t> path;
+  for(uint32_t i = 0; i < size; i++) {
+    semi[i]  = i;
+    label[i] = i;
+  }
+  // The group of least semi-dominator on the path to v through the groups
+  // numbered from first on.
+  auto eval = [&](uint32_t v, uint32_t first) {
+    if(link[v] < first) {
+      return label[v];
+    }
+    path.clear();
+    uint32_t top = v;
+    do {
+      path.push_back(top);
+      top = link[top];
+    } while(link[top] >= first);
+    for(auto iter = path.rbegin(); iter != path.rend(); ++iter) {
+      uint32_t node = *iter;
+      if(semi[label[top]] < semi[label[node]]) {
+        label[node] = label[top];
+      }
+      link[node] = link[top];
+      top        = node;
+    }
+    return label[v];
+  };
+  for(uint32_t i = size - 1; i > 0; i--) {
+    semi[i] = parent[i];
+    for(uint32_t predecessor_group: predecessors_[order[i]]) {
+      uint32_t predecessor = position_[predecessor_group];
+      if(predecessor != kNoIndex) {
+        semi[i] = std::min(semi[i], semi[eval(predecessor, i + 1)]);
+      }
+    }
+  }
+  std::vector<uint32_t>& dominator = parent;
+  for(uint32_t i = 1; i < size; i++) {
+    while(dominator[i] > semi[i]) {
+      dominator[i] = dominator[dominator[i]];
+    }
+  }
+
+  // Dominators come before the groups they dominate in preorder.
+  for(uint32_t i = 1; i < size; i++) {
+    set_immediate_dominator(order[i], order[dominator[i]]);
+  }
+  for(uint32_t group: order) {
+    position_[group] = kNoIndex;
+  }
+}
+
+void DynamicDominatorTree::set_immediate_dominator(uint32_t group,
+                                                   uint32_t dominator) {
+  immediate_dominator_[group] = dominator;
+  level_[group]               = level_[dominator] + 1;
+  children_[dominator].push_back(group);
+}
+
+std::vector<uint32_t> DynamicDominatorTree::subtree(uint32_t root) const {
+  std::vector<uint32_t> result{ root };
+  for(size_t i = 0; i < result.size(); i++) {
+    const std::vector<uint32_t>& children = children_[result[i]];
+    result.insert(result.end(), children.begin(), children.end());
+  }
+  return result;
+}
+
+}  // namespace SiiIR
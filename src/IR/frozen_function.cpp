@@ -0,0 +1,81 @@
+#include "IR/frozen_function.h"
+#include <unordered_map>
+
+namespace SiiIR {
+
+uint32_t FrozenFunction::group_index(const BasicGroup* group) const {
+  uint32_t number = group->number_;
+  return number < groups_.size() && groups_[number] == group ? number
+                                                             : kNoIndex;
+}
+
+FrozenFunctionPtr Freeze(Function& func) {
+  auto result                  = std::make_shared<FrozenFunction>();
+  result->function_slot_count_ = func.renumber();
+
+  size_t group_count = func.basic_groups_.size();
+  // Numbers the groups as well.
+  const std::vector<BasicGroup*>& reverse_postorder = func.reverse_postorder();
+  result->groups_.reserve(group_count);
+  for(const BasicGroupPtr& group: func.basic_groups_) {
+    result->groups_.push_back(group.get());
+  }
+  result->entry_ = result->group_index(func.entry_);
+  result->reverse_postorder_.reserve(reverse_postorder.size());
+  for(const BasicGroup* group: reverse_postorder) {
+    result->reverse_postorder_.push_back(group->number_);
+  }
+
+  auto pack_edges = [&](const std::vector<BasicGroup*> BasicGroup::*edges,
+                        std::vector<uint32_t>&           begin,
+                        std::vector<uint32_t>&           packed) {
+    begin.reserve(group_count + 1);
+    begin.push_back(0);
+    for(const BasicGroup* group: result->groups_) {
+      for(const BasicGroup* other: group->*edges) {
+        packed.push_back(result->group_index(other));
+      }
+      begin.push_back(packed.size());
+    }
+  };
+  pack_edges(
+      &BasicGroup::follows_, result->successor_begin_, result->successors_);
+  pack_edges(&BasicGroup::precedes_,
+             result->predecessor_begin_,
+             result->predecessors_);
+
+  std::unordered_map<const Value*, uint32_t> extra_slots;
+  auto slot_of = [&](const Value* value) -> uint32_t {
+    if(value == nullptr) {
+      return FrozenFunction::kNoIndex;
+    }
+    if(value->slot_ != Value::kNoSlot) {
+      return value->slot_;
+    }
+    uint32_t next_slot
+        = result->function_slot_count_ + result->extra_values_.size();
+    auto [iter, inserted] = extra_slots.insert({ value, next_slot });
+    if(inserted) {
+      result->extra_values_.push_back(value);
+    }
+    return iter->second;
+  };
+
+  result->code_begin_.reserve(group_count + 1);
+  result->code_begin_.push_back(0);
+  result->operand_begin_.push_back(0);
+  for(const BasicGroup* group: result->groups_) {
+    for(const SiiIRCode& code: group->codes_) {
+      result->kinds_.push_back(code.kind_);
+      result->code_slots_.push_back(code.slot_);
+      for(const Use* use = code.op_begin(); use != code.op_end(); ++use) {
+        result->operands_.push_back(slot_of(use->value_.get()));
+      }
+      result->operand_begin_.push_back(result->operands_.size());
+    }
+    result->code_begin_.push_back(result->kinds_.size());
+  }
+  return result;
+}
+
+}  // namespace SiiIR
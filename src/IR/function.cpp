@@ -1,7 +1,9 @@
 #include "IR/function.h"
 #include "IR/function_ctx.h"
-#include <set>
+#include <algorithm>
+#include <cassert>
 #include <sstream>
+#include <unordered_map>
 
 #include <map>
 
@@ -11,11 +13,22 @@ class FunctionBuilder {
 private:
   std::vector<SiiIRCodePtr>       source_codes_;
   FunctionContextPtr              ctx_;
+  ArenaPtr                        arena_;
   std::map<SiiIRCode*, size_t>    code_to_index_;
   std::map<Label*, BasicGroupPtr> label_to_node_;
   std::vector<BasicGroupPtr>      basic_groups_;
 
-  BasicGroup* build_basic_group_starting_from(size_t start) {
+  // A group being built, with the code indices its branches lead to.
+  struct PendingGroup {
+    BasicGroupPtr       group;
+    std::vector<size_t> targets;
+    size_t              next_target = 0;
+  };
+
+  // Fill a new group with the codes starting at start and push it on
+  // pending. Returns the existing group if start has been visited before.
+  BasicGroup* open_basic_group(size_t start,
+                               std::vector<PendingGroup>& pending) {
     BasicGroupPtr result = nullptr;
     if(source_codes_[start]->label_ != nullptr) {
       if(label_to_node_.find(source_codes_[start]->label_.get())
@@ -28,46 +41,34 @@ private:
       throw std::runtime_error(
           "Building a basic group with a non-label code at the beginning.");
     }
-    size_t current_line = start;
+    size_t              current_line = start;
+    std::vector<size_t> targets;
 
     List<SiiIRCode>& target_codes = result->codes_;
     while(current_line < source_codes_.size()) {
       auto current = source_codes_[current_line];
       if(current_line != start && current->label_ != nullptr) {
-        target_codes.push_back(std::make_shared<SiiIRGoto>(current->label_));
-        BasicGroup* next_group = build_basic_group_starting_from(current_line);
-        result->follows_.push_back(next_group);
-        next_group->precedes_.push_back(result.get());
+        target_codes.push_back(ArenaNew<SiiIRGoto>(arena_, current->label_));
+        targets.push_back(current_line);
         break;
       }
       target_codes.push_back(current);
       if(current->kind_ == SiiIRCodeKind::GOTO) {
-        const SiiIRGoto* goto_code
-            = static_cast<const SiiIRGoto*>(current.get());
-        const LabelPtr& dest_label
-            = std::static_pointer_cast<Label>(goto_code->dest_label_->value_);
-        BasicGroup* next_group = build_basic_group_starting_from(
-            code_to_index_[dest_label->dest_code_]);
-        result->follows_.push_back(next_group);
-        next_group->precedes_.push_back(result.get());
+        const SiiIRGoto* goto_code = cast<SiiIRGoto>(current.get());
+        const LabelPtr&  dest_label
+            = cast<Label>(goto_code->dest_label().value_);
+        targets.push_back(code_to_index_[dest_label->dest_code_]);
         break;
       }
       if(current->kind_ == SiiIRCodeKind::CONDITION_BRANCH) {
         const SiiIRConditionBranch* condition_branch
-            = static_cast<const SiiIRConditionBranch*>(current.get());
-        const LabelPtr& true_label = std::static_pointer_cast<Label>(
-            condition_branch->true_label_->value_);
-        const LabelPtr& false_label = std::static_pointer_cast<Label>(
-            condition_branch->false_label_->value_);
-        BasicGroup* true_group = build_basic_group_starting_from(
-            code_to_index_[true_label->dest_code_]);
-        result->follows_.push_back(true_group);
-        true_group->precedes_.push_back(result.get());
-
-        BasicGroup* false_group = build_basic_group_starting_from(
-            code_to_index_[false_label->dest_code_]);
-        result->follows_.push_back(false_group);
-        false_group->precedes_.push_back(result.get());
+            = cast<SiiIRConditionBranch>(current.get());
+        const LabelPtr& true_label
+            = cast<Label>(condition_branch->true_label().value_);
+        const LabelPtr& false_label
+            = cast<Label>(condition_branch->false_label().value_);
+        targets.push_back(code_to_index_[true_label->dest_code_]);
+        targets.push_back(code_to_index_[false_label->dest_code_]);
         break;
       }
       if (current->kind_ == SiiIRCodeKind::RETURN) {
@@ -76,15 +77,50 @@ private:
       current_line++;
     }
 
-    basic_groups_.push_back(result);
+    pending.push_back({ result, std::move(targets) });
     return result.get();
   }
 
+  // Build the group starting at start and every group reachable from it,
+  // depth first. An explicit stack stands in for recursion so that long
+  // chains of groups cannot overflow the call stack; groups and edges are
+  // still added in the order the recursive walk would add them.
+  BasicGroup* build_basic_group_starting_from(size_t start) {
+    std::vector<PendingGroup> pending;
+    BasicGroup*               result = open_basic_group(start, pending);
+    while(!pending.empty()) {
+      PendingGroup& top = pending.back();
+      if(top.next_target == top.targets.size()) {
+        BasicGroupPtr done = std::move(top.group);
+        pending.pop_back();
+        basic_groups_.push_back(done);
+        if(!pending.empty()) {
+          PendingGroup& parent = pending.back();
+          parent.group->follows_.push_back(done.get());
+          done->precedes_.push_back(parent.group.get());
+          parent.next_target++;
+        }
+        continue;
+      }
+      size_t      depth = pending.size();
+      BasicGroup* next_group
+          = open_basic_group(top.targets[top.next_target], pending);
+      if(pending.size() == depth) {
+        // Visited before, link it right away.
+        top.group->follows_.push_back(next_group);
+        next_group->precedes_.push_back(top.group.get());
+        top.next_target++;
+      }
+    }
+    return result;
+  }
+
 public:
   FunctionBuilder(std::vector<SiiIRCodePtr> source_codes,
                   FunctionContextPtr        ctx)
       : source_codes_(std::move(source_codes))
-      , ctx_(std::move(ctx)) {}
+      , ctx_(std::move(ctx))
+      , arena_(ctx_ ? ctx_->arena_ : nullptr) {}
 
   FunctionPtr build(std::string name) {
     FunctionPtr                 result_func = std::make_shared<Function>();
@@ -119,7 +155,7 @@ public:
         source_codes_[first_non_alloca]->label_ = first_label;
       }
       result_func->entry_->codes_.push_back(
-          std::make_shared<SiiIRGoto>(first_label));
+          ArenaNew<SiiIRGoto>(arena_, first_label));
       auto follow = build_basic_group_starting_from(first_non_alloca);
       entry->follows_.push_back(follow);
       follow->precedes_.push_back(entry.get());
@@ -151,6 +187,7 @@ public:
     result_func->basic_groups_ = std::move(basic_groups_);
     result_func->ctx_          = std::move(ctx_);
     result_func->name_         = std::move(name);
+    result_func->renumber();
     return result_func;
   }
 };
@@ -162,6 +199,171 @@ FunctionPtr BuildFunction(std::vector<SiiIRCodePtr> codes,
   return builder.build(std::move(name));
 }
 
+// Copies a function group by group. Values of the source are found by their
+// slot, so renumber() must have run on it.
+class FunctionCloner {
+private:
+  Function&                                          source_;
+  FunctionContextPtr                                 ctx_;
+  ArenaPtr                                           arena_;
+  std::vector<ValuePtr>                              slot_map_;
+  std::unordered_map<const BasicGroup*, BasicGroup*> group_map_;
+
+  void map(const Value& from, const ValuePtr& to) {
+    to->slot_ = from.slot_;
+    if(from.slot_ != Value::kNoSlot) {
+      slot_map_[from.slot_] = to;
+    }
+  }
+
+  ValuePtr remap(const ValuePtr& value) const {
+    if(value == nullptr) {
+      return nullptr;
+    }
+    if(value->slot_ < slot_map_.size() && slot_map_[value->slot_] != nullptr) {
+      return slot_map_[value->slot_];
+    }
+    if(ctx_ != nullptr && value->kind_ == ValueKind::CONSTANT) {
+      return ctx_->constant(cast<ConstantInt>(value)->value_, value->type_);
+    }
+    if(ctx_ != nullptr && value->kind_ == ValueKind::UNDEF) {
+      return ctx_->undef(value->type_);
+    }
+    // Values living outside the function, such as functions, are shared.
+    return value;
+  }
+
+  void clone_group(const BasicGroup& group, BasicGroup& copy) {
+    for(const SiiIRCode& code: group.codes_) {
+      SiiIRCodePtr code_copy = code.clone(arena_);
+      code_copy->label_      = code.label_;
+      code_copy->group_      = &copy;
+      map(code, code_copy);
+      copy.codes_.push_back(std::move(code_copy));
+    }
+    for(BasicGroup* follow: group.follows_) {
+      copy.follows_.push_back(group_map_.at(follow));
+    }
+    for(BasicGroup* precede: group.precedes_) {
+      copy.precedes_.push_back(group_map_.at(precede));
+    }
+  }
+
+  // The copies still refer to the values of the source, operands may refer
+  // forward so they are only remapped once every copy exists.
+  void remap_operands(BasicGroup& copy) {
+    for(SiiIRCode& code: copy.codes_) {
+      for(size_t i = 0; i < code.num_operands(); ++i) {
+        code.set_operand(i, remap(code.operand(i).value_));
+      }
+      if(code.label_ != nullptr) {
+        code.label_ = cast<Label>(remap(code.label_));
+      }
+    }
+    if(copy.label_ != nullptr) {
+      copy.label_->dest_code_
+          = copy.codes_.empty() ? nullptr : &*copy.codes_.begin();
+    }
+  }
+
+public:
+  explicit FunctionCloner(Function& source)
+      : source_(source) {}
+
+  FunctionPtr clone() {
+    slot_map_.assign(source_.renumber(), nullptr);
+    FunctionPtr result  = std::make_shared<Function>();
+    result->name_       = source_.name_;
+    result->slot_count_ = source_.slot_count_;
+    if(source_.ctx_ != nullptr) {
+      size_t block_size = std::max(Arena::kDefaultBlockSize,
+                                   source_.arena()->allocated_bytes() * 5 / 4);
+      arena_            = std::make_shared<Arena>(block_size);
+      ctx_              = std::make_shared<FunctionContext>(
+          source_.ctx_->function_type_, arena_);
+      for(const ValuePtr& parameter: source_.ctx_->parameters_) {
+        ValuePtr parameter_copy
+            = ArenaNew<ParameterValue>(arena_, parameter->type_);
+        map(*parameter, parameter_copy);
+        ctx_->parameters_.push_back(std::move(parameter_copy));
+      }
+    }
+    result->ctx_ = ctx_;
+
+    result->basic_groups_.reserve(source_.basic_groups_.size());
+    for(const BasicGroupPtr& group: source_.basic_groups_) {
+      BasicGroupPtr copy = std::make_shared<BasicGroup>();
+      if(group->label_ != nullptr) {
+        copy->label_ = std::make_shared<Label>();
+        map(*group->label_, copy->label_);
+      }
+      group_map_[group.get()] = copy.get();
+      result->basic_groups_.push_back(std::move(copy));
+    }
+    result->entry_ = group_map_.at(source_.entry_);
+    for(size_t i = 0; i < source_.basic_groups_.size(); ++i) {
+      clone_group(*source_.basic_groups_[i], *result->basic_groups_[i]);
+    }
+    for(const BasicGroupPtr& copy: result->basic_groups_) {
+      remap_operands(*copy);
+    }
+    return result;
+  }
+};
+
+FunctionPtr CloneFunction(Function& func) {
+  FunctionCloner cloner(func);
+  return cloner.clone();
+}
+
+Function::~Function() {
+  for(auto& basic_group: basic_groups_) {
+    for(auto& code: basic_group->codes_) {
+      code.drop_all_references();
+    }
+  }
+}
+
+uint32_t Function::renumber() {
+  slot_count_ = 0;
+  if(ctx_ != nullptr) {
+    for(auto& parameter: ctx_->parameters_) {
+      parameter->slot_ = slot_count_++;
+    }
+  }
+  for(auto& basic_group: basic_groups_) {
+    if(basic_group->label_ != nullptr) {
+      basic_group->label_->slot_ = slot_count_++;
+    }
+    for(auto& code: basic_group->codes_) {
+      code.slot_ = code.type_ != nullptr ? slot_count_++ : Value::kNoSlot;
+    }
+  }
+  return slot_count_;
+}
+
+uint32_t Function::assign_slot(Value& value) {
+  value.slot_ = slot_count_++;
+  return value.slot_;
+}
+
+const ArenaPtr& Function::arena() const {
+  static const ArenaPtr kNoArena = nullptr;
+  return ctx_ ? ctx_->arena_ : kNoArena;
+}
+
+SiiIRCode& BasicGroup::code_at(size_t index) {
+  if(positions_version_ != codes_.version()) {
+    positions_.clear();
+    positions_.reserve(codes_.size());
+    for(SiiIRCode& code: codes_) {
+      positions_.push_back(&code);
+    }
+    positions_version_ = codes_.version();
+  }
+  return *positions_.at(index);
+}
+
 std::string BasicGroup::to_string(IDAllocator& id_allocator) const {
   std::stringstream result;
   result << label_->to_string(id_allocator) << ":          ; pred: ";
@@ -180,33 +382,68 @@ std::string BasicGroup::to_string(IDAllocator& id_allocator) const {
   return result.str();
 }
 
-static void TraversePrintFunction(BasicGroup*            current_group,
-                                  std::set<BasicGroup*>& visited,
-                                  std::stringstream&     result,
-                                  IDAllocator&           id_allocator) {
-  if(visited.find(current_group) != visited.end()) {
-    return;
-  }
-  visited.insert(current_group);
-  result << current_group->to_string(id_allocator) << std::endl;
-  for(auto& follow: current_group->follows_) {
-    TraversePrintFunction(follow, visited, result, id_allocator);
-  }
-}
-
 std::string Function::to_string(IDAllocator* id_allocator) const {
-  std::stringstream     result;
-  std::set<BasicGroup*> visited;
-  if (!id_allocator) {
-    IDAllocator local_allocator;
+  std::stringstream result;
+  IDAllocator       local_allocator(slot_count_);
+  if(!id_allocator) {
     id_allocator = &local_allocator;
   }
   result << "Function " << name_ << std::endl;
   for (auto& arg : ctx_->parameters_) {
     result << "; Parameter: " << arg->to_string(*id_allocator) << std::endl;
   }
-  TraversePrintFunction(entry_, visited, result, *id_allocator);
+  for(const BasicGroup* group: reverse_postorder()) {
+    result << group->to_string(*id_allocator) << std::endl;
+  }
   return result.str();
 }
 
+void Function::update_orders() const {
+  if(orders_valid_ && orders_epoch_ == cfg_epoch_) {
+    // Only catches a change of the group count, not a group replaced by
+    // another.
+    assert(orders_group_count_ == basic_groups_.size()
+           && "Groups added or removed without cfg_changed()");
+    return;
+  }
+  for(size_t i = 0; i < basic_groups_.size(); ++i) {
+    basic_groups_[i]->number_ = i;
+  }
+  postorder_.clear();
+  // Each entry is a group and the index of the next follower to visit.
+  std::vector<std::pair<BasicGroup*, size_t>> working_stack;
+  std::vector<bool>                           visited(basic_groups_.size());
+  if(entry_ != nullptr) {
+    visited[entry_->number_] = true;
+    working_stack.push_back({ entry_, 0 });
+  }
+  while(!working_stack.empty()) {
+    auto& [group, next] = working_stack.back();
+    if(next == group->follows_.size()) {
+      postorder_.push_back(group);
+      working_stack.pop_back();
+      continue;
+    }
+    BasicGroup* follow = group->follows_[next++];
+    if(!visited[follow->number_]) {
+      visited[follow->number_] = true;
+      working_stack.push_back({ follow, 0 });
+    }
+  }
+  reverse_postorder_.assign(postorder_.rbegin(), postorder_.rend());
+  orders_epoch_       = cfg_epoch_;
+  orders_group_count_ = basic_groups_.size();
+  orders_valid_       = true;
+}
+
+const std::vector<BasicGroup*>& Function::reverse_postorder() const {
+  update_orders();
+  return reverse_postorder_;
+}
+
+const std::vector<BasicGroup*>& Function::postorder() const {
+  update_orders();
+  return postorder_;
+}
+
 }  // namespace SiiIR
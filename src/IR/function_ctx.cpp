@@ -1,3 +1,21 @@
 #include "IR/function_ctx.h"
 
-namespace SiiIR {}  // namespace SiiIR
+namespace SiiIR {
+
+ConstantIntPtr FunctionContext::constant(int64_t value, TypePtr type) {
+  ConstantIntPtr& result = constants_[{ type, value }];
+  if(result == nullptr) {
+    result = ArenaNew<ConstantInt>(arena_, value, type);
+  }
+  return result;
+}
+
+UndefValuePtr FunctionContext::undef(TypePtr type) {
+  UndefValuePtr& result = undefs_[type];
+  if(result == nullptr) {
+    result = ArenaNew<UndefValue>(arena_, type);
+  }
+  return result;
+}
+
+}  // namespace SiiIR
@@ -0,0 +1,254 @@
+#include "IR/loop_info.h"
+#include "IR/CFG_utils.h"
+#include <algorithm>
+
+namespace SiiIR {
+
+bool LoopInfo::contains(uint32_t loop, uint32_t group) const {
+  uint32_t inner = loop_of_[group];
+  while(inner != kNoIndex && loops_[inner].depth_ > loops_[loop].depth_) {
+    inner = loops_[inner].parent_;
+  }
+  return inner == loop;
+}
+
+LoopInfoPtr BuildLoopInfo(const FrozenFunction& func) {
+  auto result             = std::make_shared<LoopInfo>();
+  result->dominator_tree_ = BuildDominatorTree(func);
+  const DominatorTree&   tree     = *result->dominator_tree_;
+  std::vector<uint32_t>& loop_of  = result->loop_of_;
+  constexpr uint32_t     kNoIndex = LoopInfo::kNoIndex;
+  loop_of.assign(func.group_count(), kNoIndex);
+
+  // Headers are visited in reverse preorder of the dominator tree, so the
+  // loops nested in a loop are found before it. Walking backwards from the
+  // latches, a group already in a loop stands for the outermost loop found
+  // around it so far, which gets nested in the new loop and is skipped
+  // through its header.
+  std::vector<Loop>     found;
+  std::vector<uint32_t> worklist;
+  auto                  outermost = [&](uint32_t loop) {
+    while(found[loop].parent_ != kNoIndex) {
+      loop = found[loop].parent_;
+    }
+    return loop;
+  };
+  auto push_predecessors = [&](uint32_t group) {
+    for(uint32_t predecessor: func.predecessors(group)) {
+      if(tree.contains(predecessor)) {
+        worklist.push_back(predecessor);
+      }
+    }
+  };
+  for(auto iter = tree.preorder_.rbegin(); iter != tree.preorder_.rend();
+      ++iter) {
+    uint32_t              header = *iter;
+    std::vector<uint32_t> latches;
+    for(uint32_t predecessor: func.predecessors(header)) {
+      if(tree.dominates(header, predecessor)) {
+        latches.push_back(predecessor);
+      }
+    }
+    if(latches.empty()) {
+      continue;
+    }
+    std::sort(latches.begin(), latches.end());
+    latches.erase(std::unique(latches.begin(), latches.end()), latches.end());
+    uint32_t loop = found.size();
+    found.emplace_back();
+    found.back().header_  = header;
+    found.back().latches_ = latches;
+    loop_of[header]       = loop;
+    worklist              = std::move(latches);
+    while(!worklist.empty()) {
+      uint32_t group = worklist.back();
+      worklist.pop_back();
+      if(loop_of[group] == kNoIndex) {
+        loop_of[group] = loop;
+        push_predecessors(group);
+        continue;
+      }
+      uint32_t inner = outermost(loop_of[group]);
+      if(inner != loop) {
+        found[inner].parent_ = loop;
+        push_predecessors(found[inner].header_);
+      }
+    }
+  }
+
+  // Reversed, the loops come in preorder of their headers in the dominator
+  // tree, enclosing loops first.
+  std::vector<Loop>& loops = result->loops_;
+  loops.assign(std::make_move_iterator(found.rbegin()),
+               std::make_move_iterator(found.rend()));
+  uint32_t last = loops.size() - 1;
+  for(uint32_t& loop: loop_of) {
+    if(loop != kNoIndex) {
+      loop = last - loop;
+    }
+  }
+  for(uint32_t loop = 0; loop < loops.size(); loop++) {
+    uint32_t& parent = loops[loop].parent_;
+    if(parent != kNoIndex) {
+      parent             = last - parent;
+      loops[loop].depth_ = loops[parent].depth_ + 1;
+      loops[parent].children_.push_back(loop);
+    }
+  }
+
+  // The header of a loop dominates its other groups, so it comes first in
+  // reverse postorder.
+  std::vector<uint32_t> position(func.group_count(), kNoIndex);
+  for(uint32_t i = 0; i < func.reverse_postorder_.size(); i++) {
+    uint32_t group  = func.reverse_postorder_[i];
+    position[group] = i;
+    for(uint32_t loop = loop_of[group]; loop != kNoIndex;
+        loop          = loops[loop].parent_) {
+      loops[loop].groups_.push_back(group);
+    }
+  }
+  for(uint32_t loop = 0; loop < loops.size(); loop++) {
+    for(uint32_t group: loops[loop].groups_) {
+      for(uint32_t follow: func.successors(group)) {
+        if(!result->contains(loop, follow)) {
+          loops[loop].exits_.push_back({ group, follow });
+        }
+      }
+    }
+  }
+  for(uint32_t group: func.reverse_postorder_) {
+    for(uint32_t follow: func.successors(group)) {
+      if(position[follow] <= position[group]
+         && !tree.dominates(follow, group)) {
+        result->irreducible_edges_.push_back({ group, follow });
+      }
+    }
+  }
+  return result;
+}
+
+LoopInfoPtr BuildLoopInfo(FunctionPtr func) {
+  return BuildLoopInfo(*Freeze(*func));
+}
+
+// Redirect the edges into header from the groups marked in entering to a
+// new group placed right before header.
+static void InsertPreheader(Function&                func,
+                            BasicGroup&              header,
+                            const std::vector<bool>& entering) {
+  std::vector<BasicGroup*> outside;
+  std::vector<BasicGroup*> inside;
+  std::vector<size_t>      source_of;
+  for(size_t i = 0; i < entering.size(); i++) {
+    if(entering[i]) {
+      outside.push_back(header.precedes_[i]);
+    } else {
+      inside.push_back(header.precedes_[i]);
+      source_of.push_back(i);
+    }
+  }
+  size_t first_entering
+      = std::find(entering.begin(), entering.end(), true) - entering.begin();
+
+  auto preheader    = std::make_shared<BasicGroup>();
+  preheader->label_ = std::make_shared<Label>();
+  func.assign_slot(*preheader->label_);
+  // With several edges coming in, their sources are merged before the
+  // header. A single edge keeps its source, none leaves the value undefined.
+  std::vector<ValuePtr> merged;
+  for(auto iter = header.codes_.begin();
+      iter != header.codes_.end() && iter->kind_ == SiiIRCodeKind::PHI;
+      ++iter) {
+    SiiIRPhi& phi = cast<SiiIRPhi>(*iter);
+    if(outside.empty()) {
+      merged.push_back(func.ctx_->undef(phi.type_));
+    } else if(outside.size() > 1) {
+      auto merge = ArenaNew<SiiIRPhi>(
+          func.arena(), func.arena(), phi.type_, outside.size());
+      for(size_t i = 0, k = 0; i < entering.size(); i++) {
+        if(entering[i]) {
+          merge->set_operand(k++, phi.src(i).value_);
+        }
+      }
+      merge->group_ = preheader.get();
+      func.assign_slot(*merge);
+      preheader->codes_.push_back(merge);
+      merged.push_back(merge);
+    }
+  }
+  auto jump   = ArenaNew<SiiIRGoto>(func.arena(), header.label_);
+  jump->group_ = preheader.get();
+  preheader->label_->dest_code_ = preheader->codes_.empty()
+                                      ? jump.get()
+                                      : &*preheader->codes_.begin();
+  preheader->codes_.push_back(jump);
+  preheader->precedes_ = outside;
+  preheader->follows_.push_back(&header);
+
+  for(BasicGroup* precede: outside) {
+    SiiIRCode& terminator = *--precede->codes_.end();
+    for(Use* use = terminator.op_begin(); use != terminator.op_end(); ++use) {
+      if(use->value_ == header.label_) {
+        use->set(preheader->label_);
+      }
+    }
+    std::replace(precede->follows_.begin(),
+                 precede->follows_.end(),
+                 &header,
+                 preheader.get());
+  }
+  inside.push_back(preheader.get());
+  source_of.push_back(first_entering < entering.size() ? first_entering : 0);
+  SetPredecessors(func, header, std::move(inside), source_of);
+  if(!merged.empty()) {
+    auto iter = header.codes_.begin();
+    for(ValuePtr& value: merged) {
+      cast<SiiIRPhi>(*iter).replace_src(source_of.size() - 1, value);
+      ++iter;
+    }
+  }
+
+  auto& groups = func.basic_groups_;
+  groups.insert(std::find_if(groups.begin(),
+                             groups.end(),
+                             [&](const BasicGroupPtr& group) {
+                               return group.get() == &header;
+                             }),
+                preheader);
+  if(func.entry_ == &header) {
+    func.entry_ = preheader.get();
+  }
+  func.cfg_changed();
+}
+
+size_t InsertPreheaders(Function& func) {
+  FrozenFunctionPtr frozen = Freeze(func);
+  LoopInfoPtr       info   = BuildLoopInfo(*frozen);
+  // Indices go stale once groups are added, so the edges into each header
+  // are classified first.
+  std::vector<std::pair<BasicGroup*, std::vector<bool>>> headers;
+  for(uint32_t loop = 0; loop < info->loops_.size(); loop++) {
+    BasicGroup*       header = frozen->groups_[info->loops_[loop].header_];
+    std::vector<bool> entering;
+    size_t            entering_count = 0;
+    for(BasicGroup* precede: header->precedes_) {
+      entering.push_back(!info->contains(loop, precede->number_));
+      entering_count += entering.back();
+    }
+    if(entering_count == 1 && header != func.entry_) {
+      size_t      index = std::find(entering.begin(), entering.end(), true)
+                          - entering.begin();
+      BasicGroup* precede = header->precedes_[index];
+      if(precede->follows_.size() == 1) {
+        continue;
+      }
+    }
+    headers.push_back({ header, std::move(entering) });
+  }
+  for(auto& [header, entering]: headers) {
+    InsertPreheader(func, *header, entering);
+  }
+  return headers.size();
+}
+
+}  // namespace SiiIR
@@ -1,27 +1,29 @@
 #include "IR/type.h"
+#include <functional>
 #include <stdexcept>
 
 namespace SiiIR {
 
 TypePtr Type::Integer(size_t num_bits) {
-  return std::make_shared<IntegerType>(num_bits);
+  return TypeContext::Global().integer(num_bits);
 }
 
 TypePtr Type::Pointer(TypePtr aim_type, uint64_t offset_limit) {
-  return std::make_shared<PointerType>(aim_type, offset_limit);
+  return TypeContext::Global().pointer(aim_type, offset_limit);
 }
 
 TypePtr Type::Pointer(TypePtr aim_type) {
-  return std::make_shared<PointerType>(aim_type);
+  return TypeContext::Global().pointer(aim_type);
 }
 
 TypePtr Type::Array(TypePtr element_type, int64_t element_count) {
-  return std::make_shared<ArrayType>(element_type, element_count);
+  return TypeContext::Global().array(element_type, element_count);
 }
 
 TypePtr Type::Function(TypePtr              return_type,
                        std::vector<TypePtr> parameter_types) {
-  return std::make_shared<FunctionType>(return_type, parameter_types);
+  return TypeContext::Global().function(return_type,
+                                        std::move(parameter_types));
 }
 
 TypePtr Type::GetAimType(TypePtr pointer_type) {
@@ -29,49 +31,104 @@ TypePtr Type::GetAimType(TypePtr pointer_type) {
     throw std::invalid_argument("Parameter of phi is not a address");
   }
 
-  return static_cast<PointerType*>(pointer_type.get())->aim_type_;
+  return static_cast<const PointerType*>(pointer_type)->aim_type_;
 }
 
-// operator overloading
-bool IntegerType::operator==(const Type& other) const {
-  if(other.kind_ != Type::Kind::INT) {
-    return false;
+TypeContext& TypeContext::Global() {
+  // Leaked on purpose, types must stay valid during static destruction.
+  static TypeContext* context = new TypeContext();
+  return *context;
+}
+
+static size_t HashCombine(size_t seed, size_t value) {
+  return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+size_t TypeContext::KeyHash::operator()(const PointerKey& key) const {
+  size_t seed = std::hash<TypePtr>()(std::get<0>(key));
+  seed        = HashCombine(seed, static_cast<size_t>(std::get<1>(key)));
+  return HashCombine(seed, std::get<2>(key));
+}
+
+size_t TypeContext::KeyHash::operator()(const ArrayKey& key) const {
+  return HashCombine(std::hash<TypePtr>()(key.first), key.second);
+}
+
+size_t TypeContext::KeyHash::operator()(const FunctionKey& key) const {
+  size_t seed = key.size();
+  for(TypePtr type: key) {
+    seed = HashCombine(seed, std::hash<TypePtr>()(type));
   }
-  const IntegerType& other_int = static_cast<const IntegerType&>(other);
-  return num_bits_ == other_int.num_bits_;
+  return seed;
 }
 
-bool PointerType::operator==(const Type& other) const {
-  if(other.kind_ != Type::Kind::POINTER) {
-    return false;
+TypePtr TypeContext::intern(std::unique_ptr<Type> type) {
+  types_.emplace_back(std::move(type));
+  return types_.back().get();
+}
+
+TypePtr TypeContext::integer(size_t num_bits) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  TypePtr& result = integers_[num_bits];
+  if(result == nullptr) {
+    result = intern(std::unique_ptr<Type>(new IntegerType(num_bits)));
   }
-  const PointerType& other_ptr = static_cast<const PointerType&>(other);
-  return *aim_type_ == *other_ptr.aim_type_
-         && offset_limit_ == other_ptr.offset_limit_;
+  return result;
 }
 
-bool ArrayType::operator==(const Type& other) const {
-  if(other.kind_ != Type::Kind::ARRAY) {
-    return false;
+TypePtr TypeContext::pointer(TypePtr aim_type, uint64_t offset_limit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  TypePtr& result = pointers_[PointerKey(
+      aim_type, PointerType::OffsetLimitKind::kOffsetLimit, offset_limit)];
+  if(result == nullptr) {
+    result = intern(
+        std::unique_ptr<Type>(new PointerType(aim_type, offset_limit)));
   }
-  const ArrayType& other_arr = static_cast<const ArrayType&>(other);
-  return *element_type_ == *other_arr.element_type_
-         && element_count_ == other_arr.element_count_;
+  return result;
 }
 
-bool FunctionType::operator==(const Type& other) const {
-  if(other.kind_ != Type::Kind::FUNCTION) {
-    return false;
+TypePtr TypeContext::pointer(TypePtr aim_type) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  TypePtr& result = pointers_[PointerKey(
+      aim_type, PointerType::OffsetLimitKind::kOffsetUnLimit, 0)];
+  if(result == nullptr) {
+    result = intern(std::unique_ptr<Type>(new PointerType(aim_type)));
   }
-  const FunctionType& other_func = static_cast<const FunctionType&>(other);
-  if(parameter_types_.size() != other_func.parameter_types_.size()) {
-    return false;
+  return result;
+}
+
+TypePtr TypeContext::array(TypePtr element_type, int64_t element_count) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  TypePtr& result = arrays_[ArrayKey(element_type, element_count)];
+  if(result == nullptr) {
+    result = intern(
+        std::unique_ptr<Type>(new ArrayType(element_type, element_count)));
   }
-  for(size_t i = 0; i < parameter_types_.size(); ++i) {
-    if(*parameter_types_[i] != *other_func.parameter_types_[i]) {
-      return false;
-    }
+  return result;
+}
+
+TypePtr TypeContext::function(TypePtr              return_type,
+                              std::vector<TypePtr> parameter_types) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FunctionKey                 key;
+  key.reserve(parameter_types.size() + 1);
+  key.push_back(return_type);
+  key.insert(key.end(), parameter_types.begin(), parameter_types.end());
+  TypePtr& result = functions_[std::move(key)];
+  if(result == nullptr) {
+    result = intern(std::unique_ptr<Type>(
+        new FunctionType(return_type, std::move(parameter_types))));
   }
-  return *return_type_ == *other_func.return_type_;
+  return result;
 }
+
+size_t TypeContext::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return types_.size();
+}
+
 }  // namespace SiiIR
@@ -1,9 +1,14 @@
 #include "IR/use.h"
+#include "IR/value.h"
 
 namespace SiiIR {
 
-UsePtr NewUse(SiiIRCode* user, ValuePtr value) {
-  return std::make_shared<Use>(user, std::move(value));
+void Use::set(ValuePtr value) {
+  remove_from_parent();
+  value_ = std::move(value);
+  if(value_) {
+    value_->users_.push_back(this);
+  }
 }
 
 }  // namespace SiiIR
@@ -1,24 +1,17 @@
 #include "IR/value.h"
 #include "IR/IR.h"
+#include "IR/function.h"
 #include "IR/function_ctx.h"
 
 #include <sstream>
 
 namespace SiiIR {
-ConstantValuePtr Value::constant(const std::string& literal, TypePtr type) {
-  return std::make_shared<ConstantValue>(literal, std::move(type));
-}
-
-UndefValuePtr Value::undef(TypePtr type) {
-  return std::make_shared<UndefValue>(std::move(type));
-}
-
 std::string ParameterValue::to_string(IDAllocator& id_allocator) const {
   return id_allocator.alloc(this);
 }
 
-std::string ConstantValue::to_string(IDAllocator& id_allocator) const {
-  return literal_;
+std::string ConstantInt::to_string(IDAllocator& id_allocator) const {
+  return std::to_string(value_);
 }
 
 std::string UndefValue::to_string(IDAllocator& id_allocator) const {
@@ -30,6 +23,9 @@ std::string Label::to_string(IDAllocator& id_allocator) const {
 }
 
 std::string FunctionValue::to_string(IDAllocator& id_allocator) const {
+  if(codes_ == nullptr && body_ != nullptr) {
+    return body_->to_string();
+  }
   std::stringstream result;
   result << "@" + name_ + "(";
   for(size_t i = 0; i < ctx_->parameters_.size(); i++) {
@@ -48,6 +44,15 @@ std::string FunctionValue::to_string(IDAllocator& id_allocator) const {
   return result.str();
 }
 
+void Value::replace_all_uses_with(const ValuePtr& value) {
+  if(value.get() == this) {
+    return;
+  }
+  while(!users_.empty()) {
+    users_.begin()->set(value);
+  }
+}
+
 FunctionValuePtr
 Value::Function(std::shared_ptr<std::vector<SiiIRCodePtr>> codes,
                 FunctionContextPtr                         ctx,
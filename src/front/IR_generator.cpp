@@ -34,14 +34,16 @@ struct RValue : public Value {
 
 class IRGeneratorImpl : public IRGenerator {
 public:
-  IRGeneratorImpl(ASTNodePtr ast)
-      : ast_(std::move(ast)) {
+  IRGeneratorImpl(ASTNodePtr ast, bool build_functions)
+      : ast_(std::move(ast))
+      , build_functions_(build_functions) {
     ctx_manager_ = CreateContextManager();
   }
   std::shared_ptr<std::vector<SiiIR::SiiIRCodePtr>> work() override;
 
 protected:
   ASTNodePtr            ast_;
+  bool                  build_functions_;
   ContextManagerPtr     ctx_manager_;
   std::set<std::string> function_definitions;
 
@@ -353,11 +355,11 @@ RValue IRGeneratorImpl::generate_for_prefix_inc_dec_node(
   if(node->kind_ == ASTNodeKind::PREFIX_INC) {
     new_value = code_builder->append_add(
         old_value,
-        std::make_shared<SiiIR::ConstantValue>("1", old_value->type_));
+        ctx_manager_->function_ctx()->constant(1, old_value->type_));
   } else if(node->kind_ == ASTNodeKind::PREFIX_DEC) {
     new_value = code_builder->append_sub(
         old_value,
-        std::make_shared<SiiIR::ConstantValue>("1", old_value->type_));
+        ctx_manager_->function_ctx()->constant(1, old_value->type_));
   }
   code_builder->append_store(new_value, child_value.address_);
   return RValue(child_value.type_, new_value);
@@ -423,9 +425,10 @@ RValue IRGeneratorImpl::generate_for_integer_node(
     const ASTNodePtr&      node,
     SiiIR::CodeBuilderPtr& code_builder) {
   const LiteralNode* literal_node = static_cast<const LiteralNode*>(node.get());
+  int64_t            value        = std::stoll(literal_node->literal_);
   return RValue(
       Type::Basic(TypeKind::INT),
-      SiiIR::Value::constant(literal_node->literal_, SiiIR::Type::Integer(32)));
+      ctx_manager_->function_ctx()->constant(value, SiiIR::Type::Integer(32)));
 }
 
 LValue IRGeneratorImpl::generate_for_identifier_node(
@@ -498,20 +501,17 @@ void IRGeneratorImpl::generate_for_if_else_node(
   auto                           false_label = std::make_shared<SiiIR::Label>();
   SiiIR::SiiIRConditionBranchPtr branh = code_builder->append_condition_branch(
       cond_value.value_, true_label, false_label);
+  auto                           end_label   = std::make_shared<SiiIR::Label>();
   code_builder->append_label(true_label);
   generate_for_non_value_node(if_true_statement, code_builder);
-  SiiIR::SiiIRGotoPtr true_goto_end = code_builder->append_goto(nullptr);
+  code_builder->append_goto(end_label);
 
   // Else
   code_builder->append_label(false_label);
   if(else_statement != nullptr) {
     generate_for_non_value_node(else_statement, code_builder);
   }
-  SiiIR::SiiIRGotoPtr false_goto_end = code_builder->append_goto(nullptr);
-
-  auto end_label = std::make_shared<SiiIR::Label>();
-  true_goto_end->use_setter<0>()(end_label);
-  false_goto_end->use_setter<0>()(end_label);
+  code_builder->append_goto(end_label);
   code_builder->append_label(end_label);
 }
 
@@ -644,7 +644,7 @@ IRGeneratorImpl::generate_for_return_node(const ASTNodePtr&      node,
       = generate_for_rvalue_node(return_node.result_, code_builder);
   const SiiIR::FunctionType* function_type
       = static_cast<const SiiIR::FunctionType*>(
-          ctx_manager_->function_ctx()->function_type_.get());
+          ctx_manager_->function_ctx()->function_type_);
   if(*return_value.value_->type_ != *function_type->return_type_) {
     throw std::runtime_error("return type error");
   }
@@ -662,11 +662,15 @@ SiiIR::FunctionValuePtr IRGeneratorImpl::generate_for_function_declaration_node(
       = static_cast<const FunctionType&>(*function_node.declarator_->type_);
   const auto& function_body = function_node.body_;
   std::shared_ptr<std::vector<SiiIR::SiiIRCodePtr>> function_codes;
+  SiiIR::CodeBuilderPtr                             function_body_builder;
   SiiIR::TypePtr ir_function_type = Type::ToIRType(type);
   ctx_manager_->enter_function(ir_function_type);
   if(function_node.body_) {
     ctx_manager_->push_symbol_ctx();
-    SiiIR::CodeBuilderPtr body_builder = SiiIR::CreateCodeBuilder();
+    const SiiIR::ArenaPtr& arena = ctx_manager_->function_ctx()->arena_;
+    SiiIR::CodeBuilderPtr  body_builder
+        = build_functions_ ? SiiIR::CreateFunctionCodeBuilder(arena)
+                           : SiiIR::CreateCodeBuilder(arena);
     for(auto& parameter: function_type.parameter_types_) {
       auto           parameter_type = parameter->type_;
       SiiIR::TypePtr ir_type_ptr    = Type::ToIRType(parameter_type);
@@ -684,12 +688,20 @@ SiiIR::FunctionValuePtr IRGeneratorImpl::generate_for_function_declaration_node(
                                     parameter_allocated_address));
     }
     generate_for_non_value_node(function_body, body_builder);
-    function_codes = body_builder->finish();
+    if(build_functions_) {
+      function_body_builder = std::move(body_builder);
+    } else {
+      function_codes = body_builder->finish();
+    }
     ctx_manager_->pop_symbol_ctx();
   }
   auto                    function_ctx   = ctx_manager_->leave_function();
   SiiIR::FunctionValuePtr function_value = SiiIR::Value::Function(
       function_codes, function_ctx, function_name, std::move(ir_function_type));
+  if(function_body_builder != nullptr) {
+    function_value->body_
+        = function_body_builder->finish_function(function_ctx, function_name);
+  }
   ctx_manager_->append_function(
       function_name, Symbol::NewFunctionSymbol(type, function_value));
   if(function_body) {
@@ -705,7 +717,8 @@ IRGeneratorImpl::format_condition_value(RValue&                value,
     return;
   }
   if(value.type_->kind_ == TypeKind::INT) {
-    auto temporary_constant = SiiIR::Value::constant("0", value.value_->type_);
+    auto temporary_constant
+        = ctx_manager_->function_ctx()->constant(0, value.value_->type_);
     value
         = { Type::Basic(TypeKind::BOOL),
             code_builder->append_not_equal(value.value_, temporary_constant) };
@@ -714,8 +727,9 @@ IRGeneratorImpl::format_condition_value(RValue&                value,
   }
 }
 
-std::unique_ptr<IRGenerator> CreateIRGenerator(ASTNodePtr ast) {
-  return std::make_unique<IRGeneratorImpl>(std::move(ast));
+std::unique_ptr<IRGenerator> CreateIRGenerator(ASTNodePtr ast,
+                                               bool       build_functions) {
+  return std::make_unique<IRGeneratorImpl>(std::move(ast), build_functions);
 }
 
 }  // namespace front
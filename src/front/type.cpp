@@ -212,8 +212,8 @@ SiiIR::TypePtr Type::ToIRType(const TypePtr& type) {
   }
   case TypeKind::ARRAY: {
     auto& array_type = static_cast<const ArrayType&>(*type);
-    return std::make_shared<SiiIR::ArrayType>(
-        ToIRType(array_type.element_type_), array_type.element_count_);
+    return SiiIR::Type::Array(ToIRType(array_type.element_type_),
+                              array_type.element_count_);
   }
   case TypeKind::FUNCTION: {
     auto& function_type = static_cast<const FunctionType&>(*type);
@@ -221,8 +221,8 @@ SiiIR::TypePtr Type::ToIRType(const TypePtr& type) {
     for(auto& parameter: function_type.parameter_types_) {
       parameter_types.emplace_back(ToIRType(parameter->type_));
     }
-    return std::make_shared<SiiIR::FunctionType>(
-        ToIRType(function_type.return_type_), parameter_types);
+    return SiiIR::Type::Function(ToIRType(function_type.return_type_),
+                                 std::move(parameter_types));
   }
   }
 }
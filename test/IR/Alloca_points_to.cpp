@@ -0,0 +1,92 @@
+#include "IR/alloca_points_to.h"
+#include "IR/code_builder.h"
+#include <gtest/gtest.h>
+
+namespace SiiIR {
+
+// *(p = &x) = 1;       p may only point to x.
+// s = &z; s = &w; *s = 2;  s may point to either.
+// u = &v; u < u;       u escapes, and so does v through it.
+// return y;            y escapes.
+TEST(AllocaPointsTo, EscapeAndAliases) {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), {}));
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto int_type     = Type::Integer(32);
+  auto pointer_type = Type::Pointer(int_type);
+  auto x            = code_builder->append_alloca(4, int_type);
+  auto y            = code_builder->append_alloca(4, int_type);
+  auto z            = code_builder->append_alloca(4, int_type);
+  auto w            = code_builder->append_alloca(4, int_type);
+  auto v            = code_builder->append_alloca(4, int_type);
+  auto p            = code_builder->append_alloca(8, pointer_type);
+  auto s            = code_builder->append_alloca(8, pointer_type);
+  auto u            = code_builder->append_alloca(8, pointer_type);
+  code_builder->append_store(x, p);
+  auto load_p = code_builder->append_load(p);
+  code_builder->append_store(ctx->constant(1, int_type), load_p);
+  code_builder->append_store(z, s);
+  code_builder->append_store(w, s);
+  auto load_s = code_builder->append_load(s);
+  code_builder->append_store(ctx->constant(2, int_type), load_s);
+  code_builder->append_store(v, u);
+  code_builder->append_less_than(u, u);
+  code_builder->append_return(y);
+  FunctionPtr func = code_builder->finish_function(ctx, "f");
+
+  AllocaPointsToPtr points_to = BuildAllocaPointsTo(*func);
+  ASSERT_EQ(points_to->alloca_count(), 8);
+  struct {
+    const SiiIRAllocaPtr& alloca;
+    bool                  escaped;
+    bool                  promotable;
+  } cases[] = {
+    { x, false, true },  { y, true, false },  { z, false, false },
+    { w, false, false }, { v, true, false },  { p, false, true },
+    { s, false, true },  { u, true, false },
+  };
+  for(const auto& entry: cases) {
+    uint32_t index = points_to->index(*entry.alloca);
+    ASSERT_NE(index, AllocaPointsTo::kNoIndex);
+    EXPECT_EQ(points_to->allocas_[index], entry.alloca.get());
+    EXPECT_EQ(points_to->escaped_[index], entry.escaped) << index;
+    EXPECT_EQ(points_to->promotable_[index], entry.promotable) << index;
+  }
+  EXPECT_EQ(points_to->must_point_to(*load_p), points_to->index(*x));
+  EXPECT_EQ(points_to->must_point_to(*load_s), AllocaPointsTo::kNoIndex);
+  EXPECT_EQ(points_to->loaded_[load_s->slot_],
+            (std::vector<uint32_t>{ points_to->index(*z),
+                                    points_to->index(*w) }));
+  EXPECT_EQ(points_to->contents_[points_to->index(*u)],
+            (std::vector<uint32_t>{ points_to->index(*v),
+                                    points_to->unknown() }));
+}
+
+// q = &p; p = &x; **q = 1; The load of q reads &p, the load through it &x.
+TEST(AllocaPointsTo, LoadThroughLoad) {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), {}));
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto int_type     = Type::Integer(32);
+  auto x            = code_builder->append_alloca(4, int_type);
+  auto p = code_builder->append_alloca(8, Type::Pointer(int_type));
+  auto q = code_builder->append_alloca(
+      8, Type::Pointer(Type::Pointer(int_type)));
+  code_builder->append_store(p, q);
+  code_builder->append_store(x, p);
+  auto load_q = code_builder->append_load(q);
+  auto load_p = code_builder->append_load(load_q);
+  code_builder->append_store(ctx->constant(1, int_type), load_p);
+  code_builder->append_return(ctx->constant(0, int_type));
+  FunctionPtr func = code_builder->finish_function(ctx, "f");
+
+  AllocaPointsToPtr points_to = BuildAllocaPointsTo(*func);
+  EXPECT_EQ(points_to->must_point_to(*load_q), points_to->index(*p));
+  EXPECT_EQ(points_to->must_point_to(*load_p), points_to->index(*x));
+  for(uint32_t i = 0; i < points_to->alloca_count(); i++) {
+    EXPECT_FALSE(points_to->escaped_[i]);
+    EXPECT_TRUE(points_to->promotable_[i]);
+  }
+}
+
+}  // namespace SiiIR
@@ -0,0 +1,117 @@
+#include "IR/CFG_utils.h"
+#include "IR/Pass/memory_to_register.h"
+#include "IR/Pass/quit_SSA.h"
+#include "IR/code_builder.h"
+#include <gtest/gtest.h>
+
+namespace SiiIR {
+
+// if(parameter < 1) variable = 1; return variable;
+// The branch goes straight to the return group, which gets a phi.
+static FunctionPtr BuildDiamond() {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), { Type::Integer(32) }));
+  auto parameter = std::make_shared<ParameterValue>(Type::Integer(32));
+  ctx->parameters_.push_back(parameter);
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto one          = ctx->constant(1, Type::Integer(32));
+  auto true_label   = std::make_shared<Label>();
+  auto end_label    = std::make_shared<Label>();
+  auto address      = code_builder->append_alloca(4, Type::Integer(32));
+  code_builder->append_store(parameter, address);
+  auto less = code_builder->append_less_than(parameter, one);
+  code_builder->append_condition_branch(less, true_label, end_label);
+  code_builder->append_label(true_label);
+  code_builder->append_store(one, address);
+  code_builder->append_label(end_label);
+  code_builder->append_return(code_builder->append_load(address));
+  auto func = code_builder->finish_function(ctx, "f");
+  MemoryToRegisterPass().run(func);
+  return func;
+}
+
+static BasicGroup* GroupWithPhi(const Function& func) {
+  for(const BasicGroupPtr& group: func.basic_groups_) {
+    if(!group->codes_.empty()
+       && group->codes_.begin()->kind_ == SiiIRCodeKind::PHI) {
+      return group.get();
+    }
+  }
+  return nullptr;
+}
+
+TEST(CFGUtils, RemoveUnreachableGroups) {
+  FunctionPtr func = BuildDiamond();
+  BasicGroup* end  = GroupWithPhi(*func);
+  ASSERT_NE(end, nullptr);
+  ASSERT_EQ(end->precedes_.size(), 2);
+  SiiIRPhi* phi     = &cast<SiiIRPhi>(*end->codes_.begin());
+  ValuePtr  sources = phi->src(0).value_;
+  ValuePtr  other   = phi->src(1).value_;
+
+  // A group nothing branches to, feeding the phi of end.
+  auto dead    = std::make_shared<BasicGroup>();
+  dead->label_ = std::make_shared<Label>();
+  dead->codes_.push_back(ArenaNew<SiiIRGoto>(func->arena(), end->label_));
+  dead->follows_.push_back(end);
+  func->basic_groups_.push_back(dead);
+  SetPredecessors(*func,
+                  *end,
+                  { end->precedes_[0], end->precedes_[1], dead.get() },
+                  { 0, 1, 0 });
+  phi = &cast<SiiIRPhi>(*end->codes_.begin());
+  ASSERT_EQ(phi->src_size(), 3);
+  EXPECT_EQ(phi->src(2).value_, sources);
+
+  size_t group_count = func->basic_groups_.size();
+  EXPECT_EQ(RemoveUnreachableGroups(*func), 1);
+  EXPECT_EQ(func->basic_groups_.size(), group_count - 1);
+  EXPECT_EQ(end->precedes_.size(), 2);
+  phi = &cast<SiiIRPhi>(*end->codes_.begin());
+  ASSERT_EQ(phi->src_size(), 2);
+  EXPECT_EQ(phi->src(0).value_, sources);
+  EXPECT_EQ(phi->src(1).value_, other);
+  EXPECT_EQ(cast<SiiIRReturn>(*--end->codes_.end()).result().value_.get(),
+            phi);
+  EXPECT_EQ(RemoveUnreachableGroups(*func), 0);
+}
+
+TEST(CFGUtils, SplitCriticalEdges) {
+  FunctionPtr func   = BuildDiamond();
+  BasicGroup* end    = GroupWithPhi(*func);
+  BasicGroup* branch = func->entry_->follows_[0];
+  ASSERT_NE(end, nullptr);
+  ASSERT_EQ(branch->follows_.size(), 2);
+  EXPECT_FALSE(IsCriticalEdge(*branch, 0));
+  EXPECT_TRUE(IsCriticalEdge(*branch, 1));
+  size_t index = std::find(end->precedes_.begin(), end->precedes_.end(), branch)
+                 - end->precedes_.begin();
+  ASSERT_LT(index, end->precedes_.size());
+  SiiIRPhi& phi            = cast<SiiIRPhi>(*end->codes_.begin());
+  ValuePtr  through_branch = phi.src(index).value_;
+
+  size_t group_count = func->basic_groups_.size();
+  EXPECT_EQ(SplitCriticalEdges(*func, true), 1);
+  EXPECT_EQ(SplitCriticalEdges(*func), 0);
+  ASSERT_EQ(func->basic_groups_.size(), group_count + 1);
+  BasicGroup* split = branch->follows_[1];
+  EXPECT_EQ(split, func->basic_groups_.back().get());
+  EXPECT_EQ(cast<SiiIRConditionBranch>(*--branch->codes_.end())
+                .false_label()
+                .value_,
+            split->label_);
+  ASSERT_EQ(split->follows_.size(), 1);
+  EXPECT_EQ(split->follows_[0], end);
+  EXPECT_EQ(split->precedes_[0], branch);
+  EXPECT_EQ(end->precedes_[index], split);
+  EXPECT_EQ(phi.src(index).value_, through_branch);
+
+  // The copy for the branch edge lands in the new group, not in the branch.
+  QuitSSAPass().run(func);
+  for(const SiiIRCode& code: branch->codes_) {
+    EXPECT_NE(code.kind_, SiiIRCodeKind::ASSIGN);
+  }
+  EXPECT_EQ(split->codes_.begin()->kind_, SiiIRCodeKind::ASSIGN);
+}
+
+}  // namespace SiiIR
@@ -0,0 +1,45 @@
+#include "IR/IR.h"
+#include "IR/function_ctx.h"
+#include <gtest/gtest.h>
+
+namespace SiiIR {
+
+TEST(Casting, ValueKinds) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  ValuePtr one   = ctx->constant(1, Type::Integer(32));
+  ValuePtr label = std::make_shared<Label>();
+  EXPECT_TRUE(isa<ConstantInt>(one));
+  EXPECT_FALSE(isa<Label>(one));
+  EXPECT_FALSE(isa<SiiIRCode>(one));
+  EXPECT_EQ(cast<ConstantInt>(one)->value_, 1);
+  EXPECT_EQ(dyn_cast<ConstantInt>(label), nullptr);
+  EXPECT_EQ(dyn_cast<Label>(label), label);
+  EXPECT_TRUE(isa<UndefValue>(*ctx->undef(Type::Integer(32))));
+}
+
+TEST(Casting, CodeKinds) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto     zero   = ctx->constant(0, Type::Integer(32));
+  auto     alloca = std::make_shared<SiiIRAlloca>(4, Type::Integer(32));
+  ValuePtr load   = std::make_shared<SiiIRLoad>(alloca);
+  ValuePtr less   = std::make_shared<SiiIRBinaryOperation>(
+      SiiIRCodeKind::LESS_THAN, zero, zero, Type::Integer(1));
+  EXPECT_TRUE(isa<SiiIRCode>(load));
+  EXPECT_TRUE(isa<SiiIRLoad>(load));
+  EXPECT_FALSE(isa<SiiIRStore>(load));
+  EXPECT_FALSE(isa<SiiIRBinaryOperation>(load));
+  EXPECT_TRUE(isa<SiiIRBinaryOperation>(less));
+  EXPECT_FALSE(isa<SiiIRUnaryOperation>(less));
+
+  SiiIRCode& code = *cast<SiiIRCode>(load);
+  EXPECT_EQ(cast<SiiIRLoad>(code).src().value_, alloca);
+  EXPECT_EQ(dyn_cast<SiiIRAlloca>(&code), nullptr);
+  EXPECT_EQ(dyn_cast<SiiIRAlloca>(alloca.get()), alloca.get());
+
+  const Value* const_load = load.get();
+  EXPECT_EQ(cast<SiiIRLoad>(const_load)->src().value_, alloca);
+}
+
+}  // namespace SiiIR
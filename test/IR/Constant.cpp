@@ -0,0 +1,38 @@
+#include "IR/IR.h"
+#include "IR/function_ctx.h"
+#include <gtest/gtest.h>
+
+namespace SiiIR {
+
+TEST(Constant, UniquedPerFunction) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto one = ctx->constant(1, Type::Integer(32));
+  EXPECT_EQ(one->value_, 1);
+  EXPECT_EQ(one, ctx->constant(1, Type::Integer(32)));
+  EXPECT_NE(one, ctx->constant(2, Type::Integer(32)));
+  EXPECT_NE(one, ctx->constant(1, Type::Integer(8)));
+  EXPECT_EQ(ctx->undef(Type::Integer(32)), ctx->undef(Type::Integer(32)));
+  EXPECT_NE(ctx->undef(Type::Integer(32)), ctx->undef(Type::Integer(8)));
+
+  FunctionContextPtr other
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  EXPECT_NE(one, other->constant(1, Type::Integer(32)));
+}
+
+TEST(Constant, SharedUsers) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto zero = ctx->constant(0, Type::Integer(32));
+  auto add  = std::make_shared<SiiIRBinaryOperation>(
+      SiiIRCodeKind::ADD, zero, zero, Type::Integer(32));
+  EXPECT_EQ(zero->users_.size(), 2);
+  IDAllocator id_allocator;
+  EXPECT_EQ(zero->to_string(id_allocator), "0");
+  EXPECT_EQ(ctx->constant(-3, Type::Integer(32))->to_string(id_allocator),
+            "-3");
+  add.reset();
+  EXPECT_EQ(zero->users_.size(), 0);
+}
+
+}  // namespace SiiIR
@@ -0,0 +1,73 @@
+#include "IR/control_dependence.h"
+#include "IR_test_utils.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+
+namespace SiiIR {
+
+static std::set<uint32_t> ToSet(IndexRange range) {
+  return std::set<uint32_t>(range.begin(), range.end());
+}
+
+TEST(ControlDependence, Diamond) {
+  // 0 branches to 1 and 2, which both go to 3.
+  FunctionPtr func
+      = BuildFunction(4, { { 0, 1 }, { 0, 2 }, { 1, 3 }, { 2, 3 } });
+  ControlDependenceGraphPtr graph = BuildControlDependenceGraph(func);
+  ASSERT_EQ(graph->group_count(), 4);
+  EXPECT_TRUE(graph->dependences(0).empty());
+  EXPECT_EQ(ToSet(graph->dependences(1)), std::set<uint32_t>{ 0 });
+  EXPECT_EQ(ToSet(graph->dependences(2)), std::set<uint32_t>{ 0 });
+  EXPECT_TRUE(graph->dependences(3).empty());
+  EXPECT_EQ(ToSet(graph->dependents(0)), (std::set<uint32_t>{ 1, 2 }));
+}
+
+TEST(ControlDependence, LoopWithTwoReturns) {
+  // 0 -> 1, 1 loops through 2 or leaves to 3; 2 may also return early
+  // through 4.
+  FunctionPtr func = BuildFunction(
+      5, { { 0, 1 }, { 1, 2 }, { 1, 3 }, { 2, 1 }, { 2, 4 } });
+  ControlDependenceGraphPtr graph = BuildControlDependenceGraph(func);
+  EXPECT_TRUE(graph->dependences(0).empty());
+  EXPECT_EQ(ToSet(graph->dependences(1)), std::set<uint32_t>{ 2 });
+  EXPECT_EQ(ToSet(graph->dependences(2)), std::set<uint32_t>{ 1 });
+  EXPECT_EQ(ToSet(graph->dependences(3)), std::set<uint32_t>{ 1 });
+  EXPECT_EQ(ToSet(graph->dependences(4)), std::set<uint32_t>{ 2 });
+}
+
+TEST(ControlDependence, MatchesPostDominators) {
+  for(size_t node_count = 1; node_count < 40; node_count += 3) {
+    for(size_t extra_edge_count: { size_t(0), node_count / 2, node_count }) {
+      FunctionPtr func            = BuildFunction(node_count, extra_edge_count);
+      auto        post_dominators = GetPostDominators(func);
+      ControlDependenceGraphPtr graph = BuildControlDependenceGraph(func);
+      // Groups that never return have no post-dominators, so depend on
+      // nothing.
+      auto post_dominates = [&](const BasicGroup* a, const BasicGroup* b) {
+        auto iter = post_dominators.find(b);
+        return iter != post_dominators.end() && iter->second.count(a) != 0;
+      };
+      for(const BasicGroupPtr& b: func->basic_groups_) {
+        std::set<uint32_t> expected;
+        for(const BasicGroupPtr& a: func->basic_groups_) {
+          for(const BasicGroup* follow: a->follows_) {
+            if(post_dominates(b.get(), follow)
+               && post_dominators.count(a.get()) != 0
+               && (b == a || !post_dominates(b.get(), a.get()))) {
+              expected.insert(a->number_);
+            }
+          }
+        }
+        EXPECT_EQ(ToSet(graph->dependences(b->number_)), expected);
+        for(uint32_t a: graph->dependences(b->number_)) {
+          IndexRange dependents = graph->dependents(a);
+          EXPECT_NE(
+              std::find(dependents.begin(), dependents.end(), b->number_),
+              dependents.end());
+        }
+      }
+    }
+  }
+}
+
+}  // namespace SiiIR
@@ -1,22 +1,28 @@
 #include "IR/dominator_tree.h"
 #include "IR_test_utils.h"
+#include <algorithm>
 #include <gtest/gtest.h>
+#include <iterator>
 
 namespace SiiIR {
 
 static bool VerifyDominatorTree(
-    DominatorTreeNode*                                        node,
-    FunctionPtr                                               func,
+    const DominatorTree&                                      tree,
+    uint32_t                                                  node,
     std::set<const BasicGroup*>&                              dominators,
     std::map<const BasicGroup*, std::set<const BasicGroup*>>& expected) {
-  auto current = node->basic_group_;
+  auto current = tree.groups_[node];
   dominators.insert(current);
   if(expected.find(current) == expected.end()
      || expected[current] != dominators) {
     return false;
   }
-  for(const auto& child: node->children_) {
-    if(!VerifyDominatorTree(child, func, dominators, expected)) {
+  for(uint32_t child: tree.children(node)) {
+    if(tree.immediate_dominator_[child] != node
+       || tree.level_[child] != tree.level_[node] + 1) {
+      return false;
+    }
+    if(!VerifyDominatorTree(tree, child, dominators, expected)) {
       return false;
     }
   }
@@ -24,33 +30,174 @@ static bool VerifyDominatorTree(
   return true;
 }
 
+static const DominatorAlgorithm kAlgorithms[]
+    = { DominatorAlgorithm::ITERATIVE, DominatorAlgorithm::LENGAUER_TARJAN };
+
 TEST(DominatorTreeTest, BuildDominatorTree) {
-  for(size_t node_count = 1; node_count < 10; ++node_count) {
-    for(size_t extra_edge_count = 0; extra_edge_count < node_count * node_count;
-        ++extra_edge_count) {
-      FunctionPtr      func = BuildFunction(node_count, extra_edge_count);
-      DominatorTreePtr tree = BuildDominatorTree(func);
-      std::set<const BasicGroup*>                              dominators;
+  for(DominatorAlgorithm algorithm: kAlgorithms) {
+    for(size_t node_count = 1; node_count < 10; ++node_count) {
+      for(size_t extra_edge_count = 0;
+          extra_edge_count < node_count * node_count;
+          ++extra_edge_count) {
+        FunctionPtr      func = BuildFunction(node_count, extra_edge_count);
+        DominatorTreePtr tree = BuildDominatorTree(func, algorithm);
+        std::set<const BasicGroup*>                              dominators;
+        std::map<const BasicGroup*, std::set<const BasicGroup*>> expected
+            = GetDominators(func);
+        ASSERT_TRUE(
+            VerifyDominatorTree(*tree, tree->root_, dominators, expected));
+      }
+    }
+    for(size_t i = 0; i < 10; i++) {
+      FunctionPtr                 func = BuildFunction(100, 30);
+      DominatorTreePtr            tree = BuildDominatorTree(func, algorithm);
+      std::set<const BasicGroup*> dominators;
+      std::map<const BasicGroup*, std::set<const BasicGroup*>> expected
+          = GetDominators(func);
+      ASSERT_TRUE(
+          VerifyDominatorTree(*tree, tree->root_, dominators, expected));
+    }
+    for(size_t i = 0; i < 1; i++) {
+      FunctionPtr                 func = BuildFunction(1000, 300);
+      DominatorTreePtr            tree = BuildDominatorTree(func, algorithm);
+      std::set<const BasicGroup*> dominators;
       std::map<const BasicGroup*, std::set<const BasicGroup*>> expected
           = GetDominators(func);
-      ASSERT_TRUE(VerifyDominatorTree(tree->root_, func, dominators, expected));
+      ASSERT_TRUE(
+          VerifyDominatorTree(*tree, tree->root_, dominators, expected));
+    }
+  }
+}
+
+TEST(DominatorTreeTest, AlgorithmsAgree) {
+  // Too big for GetDominators.
+  for(size_t extra_edge_count: { 0, 1000, 40000 }) {
+    FunctionPtr       func   = BuildFunction(40000, extra_edge_count);
+    FrozenFunctionPtr frozen = Freeze(*func);
+    DominatorTreePtr  iterative
+        = BuildDominatorTree(*frozen, DominatorAlgorithm::ITERATIVE);
+    DominatorTreePtr lengauer_tarjan
+        = BuildDominatorTree(*frozen, DominatorAlgorithm::LENGAUER_TARJAN);
+    EXPECT_EQ(iterative->immediate_dominator_,
+              lengauer_tarjan->immediate_dominator_);
+    EXPECT_EQ(BuildDominatorTree(*frozen)->immediate_dominator_,
+              lengauer_tarjan->immediate_dominator_);
+  }
+}
+
+TEST(DominatorTreeTest, AutoGivesUpOnManyPasses) {
+  // A chain where every group also branches back to the one before, and the
+  // entry jumps to the last group: each pass of the iterative algorithm
+  // moves one more group under the entry.
+  size_t      group_count = 4 * kIterativeDominatorPassLimit;
+  FunctionPtr func        = BuildChainFunction(group_count);
+  for(uint32_t i = 2; i < group_count; i++) {
+    LinkGroups(*func, i, i - 1);
+  }
+  LinkGroups(*func, 0, group_count - 1);
+  FrozenFunctionPtr frozen = Freeze(*func);
+  for(DominatorAlgorithm algorithm: { DominatorAlgorithm::AUTO,
+                                      DominatorAlgorithm::ITERATIVE,
+                                      DominatorAlgorithm::LENGAUER_TARJAN }) {
+    DominatorTreePtr tree = BuildDominatorTree(*frozen, algorithm);
+    for(uint32_t i = 1; i < group_count; i++) {
+      ASSERT_EQ(tree->immediate_dominator_[i], 0);
     }
   }
-  for(size_t i = 0; i < 10; i++) {
-    FunctionPtr                 func = BuildFunction(100, 30);
-    DominatorTreePtr            tree = BuildDominatorTree(func);
-    std::set<const BasicGroup*> dominators;
-    std::map<const BasicGroup*, std::set<const BasicGroup*>> expected
-        = GetDominators(func);
-    ASSERT_TRUE(VerifyDominatorTree(tree->root_, func, dominators, expected));
+}
+
+TEST(DominatorTreeTest, DominanceQueries) {
+  for(size_t node_count = 1; node_count < 40; node_count += 3) {
+    FunctionPtr      func     = BuildFunction(node_count, node_count / 2);
+    DominatorTreePtr tree     = BuildDominatorTree(func);
+    auto             expected = GetDominators(func);
+    ASSERT_EQ(tree->size(), expected.size());
+    for(uint32_t a = 0; a < node_count; a++) {
+      const BasicGroup* group_a = tree->groups_[a];
+      for(uint32_t b = 0; b < node_count; b++) {
+        const BasicGroup* group_b = tree->groups_[b];
+        bool dominates = expected[group_b].count(group_a) != 0;
+        ASSERT_EQ(tree->dominates(a, b), dominates);
+        ASSERT_EQ(tree->dominates(group_a, group_b), dominates);
+        // The common dominators of a and b are the dominators of their
+        // nearest common dominator.
+        uint32_t nearest = tree->nearest_common_dominator(a, b);
+        std::set<const BasicGroup*> common;
+        std::set_intersection(expected[group_a].begin(),
+                              expected[group_a].end(),
+                              expected[group_b].begin(),
+                              expected[group_b].end(),
+                              std::inserter(common, common.begin()));
+        ASSERT_EQ(expected[tree->groups_[nearest]], common);
+      }
+    }
+  }
+}
+
+TEST(DominatorTreeTest, UnreachableGroups) {
+  FunctionPtr func = BuildFunction(4, 0, false);
+  func->basic_groups_.push_back(std::make_shared<BasicGroup>());
+  BasicGroup* unreachable = func->basic_groups_.back().get();
+  unreachable->follows_.push_back(func->basic_groups_[1].get());
+  func->basic_groups_[1]->precedes_.push_back(unreachable);
+  func->cfg_changed();
+
+  DominatorTreePtr tree  = BuildDominatorTree(func);
+  uint32_t         index = tree->group_index(unreachable);
+  for(DominatorAlgorithm algorithm: kAlgorithms) {
+    EXPECT_EQ(BuildDominatorTree(func, algorithm)->immediate_dominator_,
+              tree->immediate_dominator_);
   }
-  for(size_t i = 0; i < 1; i++) {
-    FunctionPtr                 func = BuildFunction(1000, 300);
-    DominatorTreePtr            tree = BuildDominatorTree(func);
-    std::set<const BasicGroup*> dominators;
-    std::map<const BasicGroup*, std::set<const BasicGroup*>> expected
-        = GetDominators(func);
-    ASSERT_TRUE(VerifyDominatorTree(tree->root_, func, dominators, expected));
+  ASSERT_EQ(index, 4);
+  EXPECT_EQ(tree->size(), 4);
+  EXPECT_FALSE(tree->contains(index));
+  EXPECT_EQ(tree->immediate_dominator_[index], DominatorTree::kNoIndex);
+  EXPECT_FALSE(tree->dominates(index, 1));
+  EXPECT_FALSE(tree->dominates(tree->root_, index));
+  EXPECT_EQ(tree->nearest_common_dominator(index, 1), DominatorTree::kNoIndex);
+}
+
+TEST(DominatorTreeTest, PostDominatorTree) {
+  for(DominatorAlgorithm algorithm: kAlgorithms) {
+    for(size_t node_count = 1; node_count < 30; node_count += 2) {
+      FunctionPtr      func     = BuildFunction(node_count, node_count / 2);
+      auto             expected = GetPostDominators(func);
+      DominatorTreePtr tree     = BuildPostDominatorTree(func, algorithm);
+      uint32_t         exit     = node_count;
+      ASSERT_EQ(tree->root_, exit);
+      EXPECT_EQ(tree->groups_[exit], nullptr);
+      EXPECT_EQ(tree->size(), expected.size() + 1);
+      for(uint32_t a = 0; a < node_count; a++) {
+        const BasicGroup* group_a = tree->groups_[a];
+        ASSERT_EQ(tree->contains(a), expected.count(group_a) != 0);
+        if(!tree->contains(a)) {
+          continue;
+        }
+        EXPECT_TRUE(tree->dominates(exit, a));
+        EXPECT_EQ(tree->immediate_dominator_[a] == exit,
+                  expected[group_a].size() == 1);
+        for(uint32_t b = 0; b < node_count; b++) {
+          const BasicGroup* group_b = tree->groups_[b];
+          if(tree->contains(b)) {
+            ASSERT_EQ(tree->dominates(a, b),
+                      expected[group_b].count(group_a) != 0);
+          }
+        }
+      }
+    }
   }
 }
+
+TEST(DominatorTreeTest, PostDominatorTreeSkipsEndlessLoops) {
+  // 0 -> 1 -> 2 -> 1, and 0 -> 3 which returns.
+  FunctionPtr func
+      = BuildFunction(4, { { 0, 1 }, { 1, 2 }, { 2, 1 }, { 0, 3 } });
+  DominatorTreePtr tree = BuildPostDominatorTree(func);
+  EXPECT_EQ(tree->size(), 3);
+  EXPECT_FALSE(tree->contains(1));
+  EXPECT_FALSE(tree->contains(2));
+  EXPECT_EQ(tree->immediate_dominator_[0], 3);
+  EXPECT_EQ(tree->immediate_dominator_[3], 4);
+}
+
 }  // namespace SiiIR
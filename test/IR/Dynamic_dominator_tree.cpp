@@ -0,0 +1,166 @@
+#include "IR/dynamic_dominator_tree.h"
+#include "IR_test_utils.h"
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+
+namespace SiiIR {
+
+static void UnlinkGroups(Function& func, uint32_t from, uint32_t to) {
+  BasicGroup* from_group = func.basic_groups_[from].get();
+  BasicGroup* to_group   = func.basic_groups_[to].get();
+  auto&       follows    = from_group->follows_;
+  auto&       precedes   = to_group->precedes_;
+  follows.erase(std::find(follows.begin(), follows.end(), to_group));
+  precedes.erase(std::find(precedes.begin(), precedes.end(), from_group));
+  func.cfg_changed();
+}
+
+// Compare against a tree built from scratch out of the edited function.
+static void ExpectSameTree(DynamicDominatorTree& dynamic, FunctionPtr func) {
+  DominatorTreePtr expected = BuildDominatorTree(func);
+  DominatorTreePtr packed   = dynamic.tree();
+  ASSERT_EQ(dynamic.group_count(), expected->group_count());
+  for(uint32_t group = 0; group < expected->group_count(); group++) {
+    ASSERT_EQ(dynamic.contains(group), expected->contains(group));
+    ASSERT_EQ(packed->contains(group), expected->contains(group));
+    if(!expected->contains(group)) {
+      continue;
+    }
+    ASSERT_EQ(dynamic.immediate_dominator(group),
+              expected->immediate_dominator_[group]);
+    ASSERT_EQ(dynamic.level(group), expected->level_[group]);
+    ASSERT_EQ(packed->immediate_dominator_[group],
+              expected->immediate_dominator_[group]);
+  }
+}
+
+TEST(DynamicDominatorTree, RandomUpdates) {
+  std::mt19937 mt(std::random_device{}());
+  for(size_t group_count: { 2, 5, 20, 100 }) {
+    for(size_t batch_size: { 1, 4 }) {
+      FunctionPtr func = BuildFunction(group_count, group_count / 2);
+      DynamicDominatorTree dynamic(*Freeze(*func));
+      ExpectSameTree(dynamic, func);
+      std::uniform_int_distribution<uint32_t> group_dist(0, group_count - 1);
+      for(size_t round = 0; round < 50; round++) {
+        for(size_t i = 0; i < batch_size; i++) {
+          uint32_t     from    = group_dist(mt);
+          const auto&  follows = func->basic_groups_[from]->follows_;
+          // Delete more than insert while the CFG is dense, so parts of it
+          // keep falling off and coming back.
+          if(!follows.empty() && mt() % 3 != 0) {
+            uint32_t to = follows[mt() % follows.size()]->number_;
+            UnlinkGroups(*func, from, to);
+            dynamic.delete_edge(from, to);
+          } else {
+            uint32_t to = group_dist(mt);
+            LinkGroups(*func, from, to);
+            dynamic.insert_edge(from, to);
+          }
+        }
+        dynamic.apply_updates();
+        ASSERT_NO_FATAL_FAILURE(ExpectSameTree(dynamic, func));
+      }
+    }
+  }
+}
+
+TEST(DynamicDominatorTree, RandomInsertions) {
+  std::mt19937 mt(std::random_device{}());
+  for(size_t group_count: { 50, 500 }) {
+    FunctionPtr          func = BuildFunction(group_count, 0);
+    DynamicDominatorTree dynamic(*Freeze(*func));
+    std::uniform_int_distribution<uint32_t> group_dist(0, group_count - 1);
+    for(size_t round = 0; round < 100; round++) {
+      uint32_t from = group_dist(mt);
+      uint32_t to   = group_dist(mt);
+      LinkGroups(*func, from, to);
+      dynamic.insert_edge(from, to);
+      dynamic.apply_updates();
+      ASSERT_NO_FATAL_FAILURE(ExpectSameTree(dynamic, func));
+    }
+  }
+}
+
+TEST(DynamicDominatorTree, DeleteWithDetour) {
+  // 0 -> 1 -> 2 -> 3, and 1 -> 3: deleting 2 -> 3 leaves the tree alone,
+  // deleting 1 -> 3 then moves 3 below 2.
+  FunctionPtr func
+      = BuildFunction(4, { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 1, 3 } });
+  DynamicDominatorTree dynamic(*Freeze(*func));
+  UnlinkGroups(*func, 2, 3);
+  dynamic.delete_edge(2, 3);
+  dynamic.apply_updates();
+  ASSERT_NO_FATAL_FAILURE(ExpectSameTree(dynamic, func));
+  EXPECT_EQ(dynamic.immediate_dominator(3), 1);
+
+  LinkGroups(*func, 2, 3);
+  UnlinkGroups(*func, 1, 3);
+  dynamic.insert_edge(2, 3);
+  dynamic.delete_edge(1, 3);
+  dynamic.apply_updates();
+  ASSERT_NO_FATAL_FAILURE(ExpectSameTree(dynamic, func));
+  EXPECT_EQ(dynamic.immediate_dominator(3), 2);
+  EXPECT_EQ(dynamic.level(3), 3);
+}
+
+TEST(DynamicDominatorTree, ReachAgain) {
+  // 0 -> 1 -> 2 -> 3, and 3 -> 1.
+  FunctionPtr func
+      = BuildFunction(4, { { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 1 } });
+  DynamicDominatorTree dynamic(*Freeze(*func));
+
+  UnlinkGroups(*func, 0, 1);
+  dynamic.delete_edge(0, 1);
+  dynamic.apply_updates();
+  ASSERT_NO_FATAL_FAILURE(ExpectSameTree(dynamic, func));
+  EXPECT_FALSE(dynamic.contains(1));
+  EXPECT_FALSE(dynamic.contains(3));
+
+  // Back in through 2, which now dominates 3 and 1.
+  LinkGroups(*func, 0, 2);
+  dynamic.insert_edge(0, 2);
+  dynamic.apply_updates();
+  ASSERT_NO_FATAL_FAILURE(ExpectSameTree(dynamic, func));
+  EXPECT_EQ(dynamic.immediate_dominator(1), 3);
+  EXPECT_TRUE(dynamic.dominates(2, 1));
+}
+
+TEST(DynamicDominatorTree, CancelledUpdates) {
+  FunctionPtr          func = BuildChainFunction(3);
+  DynamicDominatorTree dynamic(*Freeze(*func));
+  DominatorTreePtr     before = dynamic.tree();
+  dynamic.insert_edge(0, 2);
+  dynamic.delete_edge(0, 2);
+  dynamic.apply_updates();
+  EXPECT_EQ(dynamic.tree(), before);
+  EXPECT_EQ(dynamic.immediate_dominator(2), 1);
+  EXPECT_THROW(
+      {
+        dynamic.delete_edge(2, 0);
+        dynamic.apply_updates();
+      },
+      std::logic_error);
+}
+
+TEST(DynamicDominatorTree, AddGroup) {
+  FunctionPtr          func = BuildChainFunction(3);
+  DynamicDominatorTree dynamic(*Freeze(*func));
+  func->basic_groups_.push_back(std::make_shared<BasicGroup>());
+  uint32_t added = dynamic.add_group(func->basic_groups_.back().get());
+  ASSERT_EQ(added, 3);
+  EXPECT_FALSE(dynamic.contains(added));
+
+  // 0 -> 3 -> 2 bypasses 1.
+  LinkGroups(*func, 0, added);
+  LinkGroups(*func, added, 2);
+  dynamic.insert_edge(added, 2);
+  dynamic.insert_edge(0, added);
+  dynamic.apply_updates();
+  ASSERT_NO_FATAL_FAILURE(ExpectSameTree(dynamic, func));
+  EXPECT_EQ(dynamic.immediate_dominator(2), 0);
+  EXPECT_EQ(dynamic.tree()->groups_[added], func->basic_groups_.back().get());
+}
+
+}  // namespace SiiIR
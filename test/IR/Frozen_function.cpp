@@ -0,0 +1,75 @@
+#include "IR/code_builder.h"
+#include "IR/frozen_function.h"
+#include "IR_test_utils.h"
+#include <gtest/gtest.h>
+
+namespace SiiIR {
+
+TEST(FrozenFunction, Edges) {
+  FunctionPtr       func   = BuildFunction(50, 100);
+  FrozenFunctionPtr frozen = Freeze(*func);
+  ASSERT_EQ(frozen->group_count(), func->basic_groups_.size());
+  EXPECT_EQ(frozen->groups_[frozen->entry_], func->entry_);
+  for(uint32_t i = 0; i < frozen->group_count(); ++i) {
+    const BasicGroup* group = func->basic_groups_[i].get();
+    EXPECT_EQ(frozen->group_index(group), i);
+    IndexRange successors = frozen->successors(i);
+    ASSERT_EQ(successors.size(), group->follows_.size());
+    for(size_t k = 0; k < successors.size(); ++k) {
+      EXPECT_EQ(frozen->groups_[successors[k]], group->follows_[k]);
+    }
+    IndexRange predecessors = frozen->predecessors(i);
+    ASSERT_EQ(predecessors.size(), group->precedes_.size());
+    for(size_t k = 0; k < predecessors.size(); ++k) {
+      EXPECT_EQ(frozen->groups_[predecessors[k]], group->precedes_[k]);
+    }
+  }
+  BasicGroup foreign;
+  EXPECT_EQ(frozen->group_index(&foreign), FrozenFunction::kNoIndex);
+
+  const std::vector<BasicGroup*>& order = func->reverse_postorder();
+  ASSERT_EQ(frozen->reverse_postorder_.size(), order.size());
+  for(size_t i = 0; i < order.size(); ++i) {
+    EXPECT_EQ(frozen->groups_[frozen->reverse_postorder_[i]], order[i]);
+  }
+}
+
+TEST(FrozenFunction, Codes) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto code_builder = CreateCodeBuilder();
+  auto one          = ctx->constant(1, Type::Integer(32));
+  auto address      = code_builder->append_alloca(4, Type::Integer(32));
+  code_builder->append_store(one, address);
+  auto load = code_builder->append_load(address);
+  auto add  = code_builder->append_add(load, one);
+  code_builder->append_return(add);
+  auto              codes  = code_builder->finish();
+  auto              func   = BuildFunction(*codes, ctx, "");
+  FrozenFunctionPtr frozen = Freeze(*func);
+
+  // entry: alloca, goto; group1: store, load, add, return.
+  ASSERT_EQ(frozen->code_count(), 6);
+  auto [first, last] = frozen->codes(1);
+  ASSERT_EQ(last - first, 4);
+  EXPECT_EQ(frozen->kinds_[first], SiiIRCodeKind::STORE);
+  EXPECT_EQ(frozen->kinds_[first + 3], SiiIRCodeKind::RETURN);
+  EXPECT_EQ(frozen->code_slots_[first], FrozenFunction::kNoIndex);
+  EXPECT_EQ(frozen->code_slots_[first + 1], load->slot_);
+
+  ASSERT_EQ(frozen->extra_values_.size(), 1);
+  EXPECT_EQ(frozen->extra_values_[0], one.get());
+  uint32_t one_slot = frozen->function_slot_count_;
+  EXPECT_EQ(frozen->value_count(), func->slot_count_ + 1);
+
+  IndexRange store_operands = frozen->operands(first);
+  ASSERT_EQ(store_operands.size(), 2);
+  EXPECT_EQ(store_operands[0], one_slot);
+  EXPECT_EQ(store_operands[1], address->slot_);
+  IndexRange add_operands = frozen->operands(first + 2);
+  ASSERT_EQ(add_operands.size(), 2);
+  EXPECT_EQ(add_operands[0], load->slot_);
+  EXPECT_EQ(add_operands[1], one_slot);
+}
+
+}  // namespace SiiIR
@@ -1,4 +1,5 @@
 #include "IR/function.h"
+#include "IR/Pass/memory_to_register.h"
 #include "IR/code_builder.h"
 #include <gtest/gtest.h>
 
@@ -74,7 +75,7 @@ TEST(Function, BuildFunctionWithGoto) {
   EXPECT_EQ(group1->codes_.size(), 2LL);
   EXPECT_EQ(&group1->codes_[0], codes->at(0).get());
   EXPECT_EQ(group1->codes_[1].kind_, SiiIRCodeKind::GOTO);
-  EXPECT_EQ(static_cast<SiiIRGoto&>(group1->codes_[1]).dest_label_->value_,
+  EXPECT_EQ(static_cast<SiiIRGoto&>(group1->codes_[1]).dest_label().value_,
             label1);
   EXPECT_EQ(group1->follows_.size(), 1);
 
@@ -91,7 +92,7 @@ TEST(Function, BuildFunctionWithConditionBranch) {
   FunctionContextPtr ctx
       = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
   auto code_builder = CreateCodeBuilder();
-  auto expression   = Value::constant("constant", Type::Integer(1));
+  auto expression   = ctx->constant(1, Type::Integer(1));
   auto true_label   = std::make_shared<Label>();
   auto false_label  = std::make_shared<Label>();
   // group1
@@ -158,4 +159,338 @@ TEST(Function, BuildFunctionWithAlloca) {
   EXPECT_EQ(group1->follows_.size(), 0);
 }
 
+TEST(Function, RenumberGivesDenseSlots) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto code_builder = CreateCodeBuilder();
+  auto address      = code_builder->append_alloca(4, Type::Integer(8));
+  auto load         = code_builder->append_load(address);
+  auto nope         = code_builder->append_nope();
+  auto codes        = code_builder->finish();
+  auto func         = BuildFunction(*codes, ctx, "");
+  // entry label, alloca, then the label of group1 and the load.
+  EXPECT_EQ(func->slot_count_, 4);
+  EXPECT_EQ(func->entry_->label_->slot_, 0);
+  EXPECT_EQ(address->slot_, 1);
+  EXPECT_EQ(func->basic_groups_[1]->label_->slot_, 2);
+  EXPECT_EQ(load->slot_, 3);
+  EXPECT_EQ(nope->slot_, Value::kNoSlot);
+
+  auto phi = std::make_shared<SiiIRPhi>(nullptr, address, 1);
+  EXPECT_EQ(func->assign_slot(*phi), 4);
+  EXPECT_EQ(func->slot_count_, 5);
+  EXPECT_EQ(func->renumber(), 4);
+}
+
+TEST(Function, CodeOrder) {
+  BasicGroup group;
+  auto       first = std::make_shared<SiiIRNope>();
+  auto       last  = std::make_shared<SiiIRNope>();
+  group.codes_.push_back(first);
+  group.codes_.push_back(last);
+  EXPECT_TRUE(first->comes_before(*last));
+  EXPECT_FALSE(last->comes_before(*first));
+  EXPECT_FALSE(first->comes_before(*first));
+
+  // Keep inserting right after first until the gap runs out.
+  std::vector<SiiIRNopePtr> inserted;
+  for(size_t i = 0; i < 64; ++i) {
+    inserted.push_back(std::make_shared<SiiIRNope>());
+    group.codes_.insert_after(first->get_iterator(), inserted.back());
+  }
+  group.codes_.push_front(std::make_shared<SiiIRNope>());
+  EXPECT_EQ(group.codes_.size(), 67);
+  for(size_t i = 0; i < group.codes_.size(); ++i) {
+    for(size_t j = 0; j < group.codes_.size(); ++j) {
+      EXPECT_EQ(group.code_at(i).comes_before(group.code_at(j)), i < j);
+    }
+  }
+  EXPECT_EQ(&group.code_at(1), first.get());
+  EXPECT_EQ(&group.code_at(2), inserted.back().get());
+  EXPECT_EQ(&group.code_at(66), last.get());
+
+  group.codes_.erase(first->get_iterator());
+  EXPECT_EQ(&group.code_at(1), inserted.back().get());
+  EXPECT_TRUE(inserted.front()->comes_before(*last));
+
+  BasicGroup other;
+  other.codes_.push_back(first);
+  EXPECT_THROW(first->comes_before(*last), std::runtime_error);
+}
+
+TEST(Function, CloneFunction) {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), { Type::Integer(32) }));
+  auto parameter = std::make_shared<ParameterValue>(Type::Integer(32));
+  ctx->parameters_.push_back(parameter);
+  auto code_builder = CreateCodeBuilder(ctx->arena_);
+  auto one          = ctx->constant(1, Type::Integer(32));
+  auto true_label   = std::make_shared<Label>();
+  auto end_label    = std::make_shared<Label>();
+  auto address      = code_builder->append_alloca(4, Type::Integer(32));
+  code_builder->append_store(parameter, address);
+  auto less = code_builder->append_less_than(parameter, one);
+  code_builder->append_condition_branch(less, true_label, end_label);
+  code_builder->append_label(true_label);
+  code_builder->append_store(one, address);
+  code_builder->append_label(end_label);
+  code_builder->append_return(code_builder->append_load(address));
+  auto codes = code_builder->finish();
+  auto func  = BuildFunction(*codes, ctx, "f");
+
+  std::string original      = func->to_string();
+  size_t      address_users = address->users_.size();
+  FunctionPtr clone         = CloneFunction(*func);
+  EXPECT_EQ(clone->to_string(), original);
+  EXPECT_EQ(address->users_.size(), address_users);
+  EXPECT_EQ(one->users_.size(), 2);
+  ASSERT_EQ(clone->basic_groups_.size(), func->basic_groups_.size());
+  EXPECT_NE(clone->ctx_, ctx);
+  EXPECT_NE(clone->ctx_->parameters_[0], parameter);
+  for(size_t i = 0; i < func->basic_groups_.size(); ++i) {
+    const BasicGroup& group = *func->basic_groups_[i];
+    const BasicGroup& copy  = *clone->basic_groups_[i];
+    EXPECT_NE(copy.label_, group.label_);
+    ASSERT_EQ(copy.codes_.size(), group.codes_.size());
+    ASSERT_EQ(copy.follows_.size(), group.follows_.size());
+    for(size_t k = 0; k < copy.follows_.size(); ++k) {
+      auto index_of = [](const FunctionPtr& f, const BasicGroup* group) {
+        for(size_t j = 0; j < f->basic_groups_.size(); ++j) {
+          if(f->basic_groups_[j].get() == group) {
+            return j;
+          }
+        }
+        return f->basic_groups_.size();
+      };
+      EXPECT_EQ(index_of(clone, copy.follows_[k]),
+                index_of(func, group.follows_[k]));
+    }
+    for(auto code = copy.codes_.begin(); code != copy.codes_.end(); ++code) {
+      EXPECT_EQ(code->group_, &copy);
+      for(const Use* use = code->op_begin(); use != code->op_end(); ++use) {
+        EXPECT_NE(use->value_, address);
+        EXPECT_NE(use->value_, parameter);
+        EXPECT_NE(use->value_, one);
+      }
+    }
+  }
+
+  // Optimizing the copy leaves the original untouched.
+  MemoryToRegisterPass().run(clone);
+  EXPECT_NE(clone->to_string(), original);
+  EXPECT_EQ(func->to_string(), original);
+  EXPECT_EQ(address->users_.size(), address_users);
+}
+
+TEST(Function, FunctionCodeBuilder) {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), { Type::Integer(32) }));
+  auto parameter = std::make_shared<ParameterValue>(Type::Integer(32));
+  ctx->parameters_.push_back(parameter);
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto one          = ctx->constant(1, Type::Integer(32));
+  auto loop_label   = std::make_shared<Label>();
+  auto body_label   = std::make_shared<Label>();
+  auto end_label    = std::make_shared<Label>();
+  auto address      = code_builder->append_alloca(4, Type::Integer(32));
+  code_builder->append_store(parameter, address);
+  code_builder->append_label(loop_label);
+  auto less
+      = code_builder->append_less_than(code_builder->append_load(address), one);
+  code_builder->append_condition_branch(less, body_label, end_label);
+  code_builder->append_label(body_label);
+  code_builder->append_store(one, address);
+  code_builder->append_goto(loop_label);
+  // Nothing branches here.
+  code_builder->append_store(parameter, address);
+  code_builder->append_label(end_label);
+  code_builder->append_return(code_builder->append_load(address));
+  auto func = code_builder->finish_function(ctx, "f");
+
+  EXPECT_EQ(func->name_, "f");
+  ASSERT_EQ(func->basic_groups_.size(), 5);
+  BasicGroup* entry = func->entry_;
+  EXPECT_EQ(entry, func->basic_groups_[0].get());
+  EXPECT_EQ(entry->codes_.size(), 2LL);
+  EXPECT_EQ(&entry->codes_[0], address.get());
+  EXPECT_EQ(entry->codes_[1].kind_, SiiIRCodeKind::GOTO);
+  EXPECT_EQ(entry->precedes_.size(), 0);
+  ASSERT_EQ(entry->follows_.size(), 1);
+
+  BasicGroup* group1 = entry->follows_[0];
+  EXPECT_EQ(group1->codes_.size(), 2LL);
+  EXPECT_EQ(group1->codes_[1].kind_, SiiIRCodeKind::GOTO);
+  EXPECT_EQ(cast<SiiIRGoto>(group1->codes_[1]).dest_label().value_,
+            loop_label);
+  ASSERT_EQ(group1->follows_.size(), 1);
+
+  BasicGroup* loop = group1->follows_[0];
+  EXPECT_EQ(loop->label_, loop_label);
+  EXPECT_EQ(loop_label->dest_code_, &loop->codes_[0]);
+  ASSERT_EQ(loop->follows_.size(), 2);
+  BasicGroup* body = loop->follows_[0];
+  BasicGroup* end  = loop->follows_[1];
+  EXPECT_EQ(body->label_, body_label);
+  EXPECT_EQ(end->label_, end_label);
+  ASSERT_EQ(body->follows_.size(), 1);
+  EXPECT_EQ(body->follows_[0], loop);
+  ASSERT_EQ(loop->precedes_.size(), 2);
+  EXPECT_EQ(loop->precedes_[0], group1);
+  EXPECT_EQ(loop->precedes_[1], body);
+  // The group of the unreachable store is dropped with its edge into end.
+  ASSERT_EQ(end->precedes_.size(), 1);
+  EXPECT_EQ(end->precedes_[0], loop);
+  EXPECT_EQ(end->follows_.size(), 0);
+  EXPECT_EQ(parameter->users_.size(), 1);
+  for(const BasicGroupPtr& group: func->basic_groups_) {
+    for(auto& code: group->codes_) {
+      EXPECT_EQ(code.group_, group.get());
+    }
+  }
+
+  MemoryToRegisterPass().run(func);
+  EXPECT_EQ(address->users_.size(), 0);
+}
+
+TEST(Function, FunctionCodeBuilderRejectsMissingLabel) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  code_builder->append_goto(std::make_shared<Label>());
+  EXPECT_THROW(code_builder->finish_function(ctx, ""), std::runtime_error);
+}
+
+// Both builders hand out the flat codes and the function alike. The
+// function builder numbers its groups in append order, so only its flat
+// codes are compared, through BuildFunction().
+TEST(Function, CodeBuildersAreInterchangeable) {
+  auto build = [](bool function_builder, bool flat) {
+    FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+        Type::Function(Type::Integer(32), { Type::Integer(32) }));
+    auto parameter = std::make_shared<ParameterValue>(Type::Integer(32));
+    ctx->parameters_.push_back(parameter);
+    CodeBuilderPtr code_builder = function_builder
+                                      ? CreateFunctionCodeBuilder(ctx->arena_)
+                                      : CreateCodeBuilder(ctx->arena_);
+    auto one        = ctx->constant(1, Type::Integer(32));
+    auto loop_label = std::make_shared<Label>();
+    auto end_label  = std::make_shared<Label>();
+    auto address    = code_builder->append_alloca(4, Type::Integer(32));
+    code_builder->append_store(parameter, address);
+    code_builder->append_label(loop_label);
+    auto less = code_builder->append_less_than(
+        code_builder->append_load(address), one);
+    code_builder->append_condition_branch(less, loop_label, end_label);
+    code_builder->append_label(end_label);
+    code_builder->append_return(code_builder->append_load(address));
+    FunctionPtr func
+        = flat ? BuildFunction(*code_builder->finish(), ctx, "f")
+               : code_builder->finish_function(ctx, "f");
+    return func->to_string();
+  };
+  std::string expected = build(false, true);
+  EXPECT_EQ(build(false, false), expected);
+  EXPECT_EQ(build(true, true), expected);
+}
+
+TEST(Function, FunctionCodeBuilderStartsOverAfterFinish) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto zero         = ctx->constant(0, Type::Integer(8));
+  code_builder->append_alloca(1, Type::Integer(8));
+  code_builder->append_return(zero);
+  FunctionPtr first = code_builder->finish_function(ctx, "first");
+  ASSERT_EQ(first->basic_groups_.size(), 2);
+  // The alloca and the goto to the group of the return.
+  EXPECT_EQ(first->entry_->codes_.size(), 2);
+
+  code_builder->append_return(zero);
+  FunctionPtr second = code_builder->finish_function(ctx, "second");
+  ASSERT_EQ(second->basic_groups_.size(), 2);
+  EXPECT_EQ(second->entry_->codes_.size(), 1);
+  EXPECT_NE(second->entry_, first->entry_);
+
+  code_builder->append_return(zero);
+  EXPECT_EQ(code_builder->finish()->size(), 1);
+  EXPECT_TRUE(code_builder->finish()->empty());
+}
+
+TEST(Function, FunctionCodeBuilderPatchedBranch) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto jump         = code_builder->append_goto(nullptr);
+  auto end_label    = std::make_shared<Label>();
+  jump->set_operand(0, end_label);
+  code_builder->append_label(end_label);
+  code_builder->append_nope();
+  auto func = code_builder->finish_function(ctx, "");
+  ASSERT_EQ(func->basic_groups_.size(), 3);
+  BasicGroup* group1 = func->entry_->follows_[0];
+  ASSERT_EQ(group1->follows_.size(), 1);
+  EXPECT_EQ(group1->follows_[0]->label_, end_label);
+  EXPECT_EQ(group1->follows_[0]->precedes_[0], group1);
+}
+
+TEST(Function, BlockOrders) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto condition    = ctx->constant(1, Type::Integer(1));
+  auto loop_label   = std::make_shared<Label>();
+  auto body_label   = std::make_shared<Label>();
+  auto end_label    = std::make_shared<Label>();
+  code_builder->append_label(loop_label);
+  code_builder->append_condition_branch(condition, body_label, end_label);
+  code_builder->append_label(body_label);
+  code_builder->append_goto(loop_label);
+  code_builder->append_label(end_label);
+  code_builder->append_nope();
+  auto func = code_builder->finish_function(ctx, "");
+  ASSERT_EQ(func->basic_groups_.size(), 4);
+  BasicGroup* loop = func->entry_->follows_[0];
+  BasicGroup* body = loop->follows_[0];
+  BasicGroup* end  = loop->follows_[1];
+
+  const std::vector<BasicGroup*>& order = func->reverse_postorder();
+  ASSERT_EQ(order.size(), 4);
+  EXPECT_EQ(order[0], func->entry_);
+  EXPECT_EQ(order[1], loop);
+  std::vector<BasicGroup*> postorder(order.rbegin(), order.rend());
+  EXPECT_EQ(func->postorder(), postorder);
+  for(size_t i = 0; i < func->basic_groups_.size(); ++i) {
+    EXPECT_EQ(func->basic_groups_[i]->number_, i);
+  }
+  // Cached until the CFG changes.
+  EXPECT_EQ(&func->reverse_postorder(), &order);
+  std::vector<BasicGroup*> cached = order;
+  EXPECT_EQ(func->reverse_postorder(), cached);
+
+  // Make the body unreachable.
+  cast<SiiIRConditionBranch>(*--loop->codes_.end())
+      .set_operand(1, end->label_);
+  loop->follows_[0] = end;
+  body->precedes_.clear();
+  func->cfg_changed();
+  EXPECT_EQ(func->reverse_postorder(),
+            std::vector<BasicGroup*>({ func->entry_, loop, end }));
+  EXPECT_EQ(func->postorder().size(), 3);
+
+  // Replace the body by a group end leads to, the group count staying the
+  // same.
+  auto exit = std::make_shared<BasicGroup>();
+  end->follows_.push_back(exit.get());
+  exit->precedes_.push_back(end);
+  std::replace_if(
+      func->basic_groups_.begin(),
+      func->basic_groups_.end(),
+      [&](const BasicGroupPtr& group) { return group.get() == body; },
+      exit);
+  func->cfg_changed();
+  EXPECT_EQ(func->reverse_postorder(),
+            std::vector<BasicGroup*>({ func->entry_, loop, end, exit.get() }));
+  EXPECT_EQ(exit->number_, 2);
+}
+
 }  // namespace SiiIR
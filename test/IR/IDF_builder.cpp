@@ -1,6 +1,8 @@
 #include "IR/IDF_builder.h"
 #include "IR_test_utils.h"
+#include <algorithm>
 #include <gtest/gtest.h>
+#include <random>
 
 namespace SiiIR {
 
@@ -120,4 +122,31 @@ TEST(IDF_builder, IteratedDominanceFrontier) {
   }
 }
 
+TEST(IDF_builder, BatchedIteratedDominanceFrontiers) {
+  std::mt19937 mt(std::random_device{}());
+  for(size_t node_count: { 1, 10, 100, 1000 }) {
+    FunctionPtr func        = BuildFunction(node_count, node_count / 2);
+    auto        IDF_builder = CreateIDFBuilder(func);
+    std::vector<std::vector<uint32_t>>    def_indices(50);
+    std::vector<std::vector<BasicGroup*>> def_groups(50);
+    for(size_t i = 0; i < def_indices.size(); i++) {
+      for(size_t k = 0; k < i % 5; k++) {
+        def_indices[i].push_back(mt() % node_count);
+        def_groups[i].push_back(
+            func->basic_groups_[def_indices[i].back()].get());
+      }
+    }
+    auto IDFs = IDF_builder->get_IDFs(def_indices);
+    ASSERT_EQ(IDFs.size(), def_indices.size());
+    for(size_t i = 0; i < IDFs.size(); i++) {
+      ASSERT_TRUE(std::is_sorted(IDFs[i].begin(), IDFs[i].end()));
+      std::set<BasicGroup*> IDF;
+      for(uint32_t group: IDFs[i]) {
+        IDF.insert(func->basic_groups_[group].get());
+      }
+      ASSERT_EQ(IDF, GetIDF(func, def_groups[i]));
+    }
+  }
+}
+
 }  // namespace SiiIR
@@ -32,16 +32,57 @@ BuildFunction(size_t node_count, size_t extra_edge_count, bool random) {
   return func;
 }
 
-static void TraverseWithout(BasicGroup*            current,
+FunctionPtr BuildChainFunction(size_t node_count) {
+  FunctionPtr func = std::make_shared<Function>();
+  func->basic_groups_.reserve(node_count);
+  for(size_t i = 0; i < node_count; i++) {
+    func->basic_groups_.push_back(std::make_shared<BasicGroup>());
+  }
+  func->entry_ = func->basic_groups_[0].get();
+  for(size_t i = 1; i < node_count; i++) {
+    BasicGroup* father_node = func->basic_groups_[i - 1].get();
+    BasicGroup* node        = func->basic_groups_[i].get();
+    father_node->follows_.push_back(node);
+    node->precedes_.push_back(father_node);
+  }
+  return func;
+}
+
+FunctionPtr
+BuildFunction(size_t                                            group_count,
+              const std::vector<std::pair<uint32_t, uint32_t>>& edges) {
+  FunctionPtr func = std::make_shared<Function>();
+  func->basic_groups_.reserve(group_count);
+  for(size_t i = 0; i < group_count; i++) {
+    func->basic_groups_.push_back(std::make_shared<BasicGroup>());
+  }
+  func->entry_ = func->basic_groups_[0].get();
+  for(auto [from, to]: edges) {
+    LinkGroups(*func, from, to);
+  }
+  return func;
+}
+
+void LinkGroups(Function& func, uint32_t from, uint32_t to) {
+  BasicGroup* from_group = func.basic_groups_[from].get();
+  BasicGroup* to_group   = func.basic_groups_[to].get();
+  from_group->follows_.push_back(to_group);
+  to_group->precedes_.push_back(from_group);
+  func.cfg_changed();
+}
+
+static void TraverseWithout(BasicGroup*            start,
                             BasicGroup*            without,
                             std::set<BasicGroup*>& visited) {
-  if(current == without) {
-    return;
-  }
-  visited.insert(current);
-  for(auto son: current->follows_) {
-    if(visited.find(son) == visited.end()) {
-      TraverseWithout(son, without, visited);
+  std::vector<BasicGroup*> stack{ start };
+  while(!stack.empty()) {
+    BasicGroup* current = stack.back();
+    stack.pop_back();
+    if(current == without || !visited.insert(current).second) {
+      continue;
+    }
+    for(auto son: current->follows_) {
+      stack.push_back(son);
     }
   }
 }
@@ -69,4 +110,46 @@ GetDominators(FunctionPtr func) {
   return dominators;
 }
 
+// Groups that reach a group without followers only through node.
+static std::set<BasicGroup*> CutFromExits(FunctionPtr func, BasicGroup* node) {
+  std::set<BasicGroup*>    visited;
+  std::vector<BasicGroup*> stack;
+  for(const auto& basic_group: func->basic_groups_) {
+    if(basic_group->follows_.empty()) {
+      stack.push_back(basic_group.get());
+    }
+  }
+  while(!stack.empty()) {
+    BasicGroup* current = stack.back();
+    stack.pop_back();
+    if(current == node || !visited.insert(current).second) {
+      continue;
+    }
+    for(auto father: current->precedes_) {
+      stack.push_back(father);
+    }
+  }
+  std::set<BasicGroup*> result;
+  for(const auto& basic_group: func->basic_groups_) {
+    if(visited.find(basic_group.get()) == visited.end()) {
+      result.insert(basic_group.get());
+    }
+  }
+  return result;
+}
+
+std::map<const BasicGroup*, std::set<const BasicGroup*>>
+GetPostDominators(FunctionPtr func) {
+  std::map<const BasicGroup*, std::set<const BasicGroup*>> post_dominators;
+  std::set<BasicGroup*> endless = CutFromExits(func, nullptr);
+  for(const auto& basic_group: func->basic_groups_) {
+    for(const auto& post_dominated: CutFromExits(func, basic_group.get())) {
+      if(endless.find(post_dominated) == endless.end()) {
+        post_dominators[post_dominated].insert(basic_group.get());
+      }
+    }
+  }
+  return post_dominators;
+}
+
 }  // namespace SiiIR
@@ -7,7 +7,19 @@ namespace SiiIR {
 
 FunctionPtr
 BuildFunction(size_t node_count, size_t extra_edge_count, bool random = true);
+// Groups 0 -> 1 -> ... -> node_count - 1, the deepest CFG of its size.
+FunctionPtr BuildChainFunction(size_t node_count);
+// Groups 0 to group_count - 1 linked by edges, 0 being the entry.
+FunctionPtr
+BuildFunction(size_t                                            group_count,
+              const std::vector<std::pair<uint32_t, uint32_t>>& edges);
+// Add the edge from -> to between groups of func.
+void LinkGroups(Function& func, uint32_t from, uint32_t to);
 std::map<const BasicGroup*, std::set<const BasicGroup*>>
 GetDominators(FunctionPtr func);
+// Brute force post-dominators. Groups that reach no group without followers
+// have no entry.
+std::map<const BasicGroup*, std::set<const BasicGroup*>>
+GetPostDominators(FunctionPtr func);
 
 }  // namespace SiiIR
@@ -0,0 +1,209 @@
+#include "IR/loop_info.h"
+#include "IR/Pass/memory_to_register.h"
+#include "IR/code_builder.h"
+#include "IR_test_utils.h"
+#include <gtest/gtest.h>
+
+namespace SiiIR {
+
+using Edges = std::vector<std::pair<uint32_t, uint32_t>>;
+
+TEST(LoopInfo, NestedLoops) {
+  // 1 heads the outer loop, left for 5; 2 heads the inner loop, closed by
+  // 3 and left for 4, which closes the outer loop.
+  FunctionPtr func = BuildFunction(
+      6,
+      { { 0, 1 }, { 1, 2 }, { 1, 5 }, { 2, 3 }, { 3, 2 }, { 3, 4 }, { 4, 1 } });
+  LoopInfoPtr info = BuildLoopInfo(func);
+  ASSERT_EQ(info->loops_.size(), 2);
+  EXPECT_TRUE(info->reducible());
+  const Loop& outer = info->loops_[0];
+  const Loop& inner = info->loops_[1];
+  EXPECT_EQ(outer.header_, 1);
+  EXPECT_EQ(outer.parent_, Loop::kNoIndex);
+  EXPECT_EQ(outer.depth_, 1);
+  EXPECT_EQ(outer.latches_, std::vector<uint32_t>{ 4 });
+  EXPECT_EQ(outer.groups_, (std::vector<uint32_t>{ 1, 2, 3, 4 }));
+  EXPECT_EQ(outer.children_, std::vector<uint32_t>{ 1 });
+  EXPECT_EQ(outer.exits_, (Edges{ { 1, 5 } }));
+  EXPECT_EQ(inner.header_, 2);
+  EXPECT_EQ(inner.parent_, 0);
+  EXPECT_EQ(inner.depth_, 2);
+  EXPECT_EQ(inner.latches_, std::vector<uint32_t>{ 3 });
+  EXPECT_EQ(inner.groups_, (std::vector<uint32_t>{ 2, 3 }));
+  EXPECT_EQ(inner.exits_, (Edges{ { 3, 4 } }));
+
+  EXPECT_EQ(info->depth(0), 0);
+  EXPECT_EQ(info->depth(1), 1);
+  EXPECT_EQ(info->depth(3), 2);
+  EXPECT_EQ(info->depth(4), 1);
+  EXPECT_EQ(info->depth(5), 0);
+  EXPECT_TRUE(info->is_header(2));
+  EXPECT_FALSE(info->is_header(3));
+  EXPECT_TRUE(info->contains(0, 3));
+  EXPECT_FALSE(info->contains(1, 4));
+}
+
+TEST(LoopInfo, IrreducibleCycle) {
+  // 1 and 2 form a cycle entered at both, inside the natural loop of 3.
+  FunctionPtr func = BuildFunction(
+      5,
+      { { 0, 3 }, { 3, 1 }, { 3, 2 }, { 1, 2 }, { 2, 1 }, { 2, 3 }, { 3, 4 } });
+  LoopInfoPtr info = BuildLoopInfo(func);
+  EXPECT_FALSE(info->reducible());
+  ASSERT_EQ(info->irreducible_edges_.size(), 1);
+  ASSERT_EQ(info->loops_.size(), 1);
+  EXPECT_EQ(info->loops_[0].header_, 3);
+  EXPECT_EQ(info->loops_[0].latches_, std::vector<uint32_t>{ 2 });
+  EXPECT_EQ(info->depth(1), 1);
+  EXPECT_EQ(info->depth(2), 1);
+  EXPECT_FALSE(info->is_header(1));
+  EXPECT_FALSE(info->is_header(2));
+}
+
+// The natural loop of each header: the header and the groups reaching one
+// of its latches without going through it.
+static std::map<uint32_t, std::set<uint32_t>>
+NaturalLoops(const FrozenFunction& func, const DominatorTree& tree) {
+  std::map<uint32_t, std::set<uint32_t>> result;
+  for(uint32_t header = 0; header < func.group_count(); header++) {
+    for(uint32_t latch: func.predecessors(header)) {
+      if(!tree.dominates(header, latch)) {
+        continue;
+      }
+      std::set<uint32_t>&   body = result[header];
+      std::vector<uint32_t> stack{ latch };
+      body.insert(header);
+      while(!stack.empty()) {
+        uint32_t group = stack.back();
+        stack.pop_back();
+        if(!body.insert(group).second) {
+          continue;
+        }
+        for(uint32_t predecessor: func.predecessors(group)) {
+          stack.push_back(predecessor);
+        }
+      }
+    }
+  }
+  return result;
+}
+
+TEST(LoopInfo, MatchesNaturalLoops) {
+  for(size_t group_count: { 5, 20, 100 }) {
+    for(size_t i = 0; i < 20; i++) {
+      FunctionPtr       func   = BuildFunction(group_count, group_count / 2);
+      FrozenFunctionPtr frozen = Freeze(*func);
+      LoopInfoPtr       info   = BuildLoopInfo(*frozen);
+      std::map<uint32_t, std::set<uint32_t>> expected
+          = NaturalLoops(*frozen, *info->dominator_tree_);
+      ASSERT_EQ(info->loops_.size(), expected.size());
+      std::vector<uint32_t> depth(group_count, 0);
+      for(uint32_t loop = 0; loop < info->loops_.size(); loop++) {
+        const Loop& current = info->loops_[loop];
+        ASSERT_EQ(current.groups_[0], current.header_);
+        ASSERT_EQ(std::set<uint32_t>(current.groups_.begin(),
+                                     current.groups_.end()),
+                  expected[current.header_]);
+        for(uint32_t group: current.groups_) {
+          depth[group]++;
+        }
+        if(current.parent_ != Loop::kNoIndex) {
+          ASSERT_LT(current.parent_, loop);
+          ASSERT_TRUE(info->contains(current.parent_, current.header_));
+        }
+      }
+      for(uint32_t group = 0; group < group_count; group++) {
+        ASSERT_EQ(info->depth(group), depth[group]);
+      }
+    }
+  }
+}
+
+// x = parameter < 1 ? 1 : 2; while(x < 10) x = x + 1; return x;
+// Both arms of the branch jump straight into the loop.
+static FunctionPtr BuildTwoEntryLoop() {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), { Type::Integer(32) }));
+  auto parameter = std::make_shared<ParameterValue>(Type::Integer(32));
+  ctx->parameters_.push_back(parameter);
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto one          = ctx->constant(1, Type::Integer(32));
+  auto two          = ctx->constant(2, Type::Integer(32));
+  auto ten          = ctx->constant(10, Type::Integer(32));
+  auto one_label    = std::make_shared<Label>();
+  auto two_label    = std::make_shared<Label>();
+  auto head_label   = std::make_shared<Label>();
+  auto body_label   = std::make_shared<Label>();
+  auto end_label    = std::make_shared<Label>();
+  auto address      = code_builder->append_alloca(4, Type::Integer(32));
+  code_builder->append_condition_branch(
+      code_builder->append_less_than(parameter, one), one_label, two_label);
+  code_builder->append_label(one_label);
+  code_builder->append_store(one, address);
+  code_builder->append_goto(head_label);
+  code_builder->append_label(two_label);
+  code_builder->append_store(two, address);
+  code_builder->append_goto(head_label);
+  code_builder->append_label(head_label);
+  code_builder->append_condition_branch(
+      code_builder->append_less_than(code_builder->append_load(address), ten),
+      body_label,
+      end_label);
+  code_builder->append_label(body_label);
+  code_builder->append_store(
+      code_builder->append_add(code_builder->append_load(address), one),
+      address);
+  code_builder->append_goto(head_label);
+  code_builder->append_label(end_label);
+  code_builder->append_return(code_builder->append_load(address));
+  auto func = code_builder->finish_function(ctx, "f");
+  MemoryToRegisterPass().run(func);
+  return func;
+}
+
+TEST(LoopInfo, InsertPreheaders) {
+  FunctionPtr func = BuildTwoEntryLoop();
+  LoopInfoPtr info = BuildLoopInfo(func);
+  ASSERT_EQ(info->loops_.size(), 1);
+  BasicGroup* header = info->dominator_tree_->groups_[info->loops_[0].header_];
+  ASSERT_EQ(header->precedes_.size(), 3);
+  SiiIRPhi* phi = &cast<SiiIRPhi>(*header->codes_.begin());
+  std::set<ValuePtr> entering_sources;
+  ValuePtr           latch_source;
+  for(size_t i = 0; i < 3; i++) {
+    if(info->contains(0, header->precedes_[i]->number_)) {
+      latch_source = phi->src(i).value_;
+    } else {
+      entering_sources.insert(phi->src(i).value_);
+    }
+  }
+  ASSERT_EQ(entering_sources.size(), 2);
+
+  size_t group_count = func->basic_groups_.size();
+  EXPECT_EQ(InsertPreheaders(*func), 1);
+  ASSERT_EQ(func->basic_groups_.size(), group_count + 1);
+  ASSERT_EQ(header->precedes_.size(), 2);
+  BasicGroup* preheader = header->precedes_[1];
+  EXPECT_EQ(preheader->follows_, std::vector<BasicGroup*>{ header });
+  EXPECT_EQ(preheader->precedes_.size(), 2);
+  for(BasicGroup* precede: preheader->precedes_) {
+    EXPECT_EQ(precede->follows_, std::vector<BasicGroup*>{ preheader });
+    EXPECT_EQ(cast<SiiIRGoto>(*--precede->codes_.end()).dest_label().value_,
+              preheader->label_);
+  }
+  // The two entering values meet in the preheader.
+  SiiIRPhi& merge = cast<SiiIRPhi>(*preheader->codes_.begin());
+  EXPECT_EQ(std::set<ValuePtr>({ merge.src(0).value_, merge.src(1).value_ }),
+            entering_sources);
+  phi = &cast<SiiIRPhi>(*header->codes_.begin());
+  EXPECT_EQ(phi->src(0).value_, latch_source);
+  EXPECT_EQ(phi->src(1).value_.get(), &merge);
+
+  EXPECT_EQ(InsertPreheaders(*func), 0);
+  info = BuildLoopInfo(func);
+  ASSERT_EQ(info->loops_.size(), 1);
+  EXPECT_EQ(info->depth(preheader->number_), 0);
+}
+
+}  // namespace SiiIR
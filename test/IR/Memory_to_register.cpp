@@ -0,0 +1,302 @@
+#include "IR/Pass/memory_to_register.h"
+#include "IR/Pass/quit_SSA.h"
+#include "IR/code_builder.h"
+#include <gtest/gtest.h>
+#include <set>
+
+namespace SiiIR {
+
+using PhiPlacement = MemoryToRegisterPass::PhiPlacement;
+
+// x = 0; if(parameter < 1) { x = 1; if(parameter < 0) return x; }
+// x = 3; return x;
+// The IDF of the stores holds the join before x = 3, where x is dead. x is
+// still read before being stored in the inner return group.
+static FunctionPtr BuildDeadJoin() {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), { Type::Integer(32) }));
+  auto parameter = std::make_shared<ParameterValue>(Type::Integer(32));
+  ctx->parameters_.push_back(parameter);
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto zero         = ctx->constant(0, Type::Integer(32));
+  auto one          = ctx->constant(1, Type::Integer(32));
+  auto three        = ctx->constant(3, Type::Integer(32));
+  auto then_label   = std::make_shared<Label>();
+  auto return_label = std::make_shared<Label>();
+  auto join_label   = std::make_shared<Label>();
+  auto address      = code_builder->append_alloca(4, Type::Integer(32));
+  code_builder->append_store(zero, address);
+  code_builder->append_condition_branch(
+      code_builder->append_less_than(parameter, one), then_label, join_label);
+  code_builder->append_label(then_label);
+  code_builder->append_store(one, address);
+  code_builder->append_condition_branch(
+      code_builder->append_less_than(parameter, zero),
+      return_label,
+      join_label);
+  code_builder->append_label(return_label);
+  code_builder->append_return(code_builder->append_load(address));
+  code_builder->append_label(join_label);
+  code_builder->append_store(three, address);
+  code_builder->append_return(code_builder->append_load(address));
+  return code_builder->finish_function(ctx, "f");
+}
+
+static size_t CountCodes(const Function& func, SiiIRCodeKind kind) {
+  size_t count = 0;
+  for(const BasicGroupPtr& group: func.basic_groups_) {
+    for(const SiiIRCode& code: group->codes_) {
+      count += code.kind_ == kind;
+    }
+  }
+  return count;
+}
+
+static size_t CountPhis(const Function& func) {
+  return CountCodes(func, SiiIRCodeKind::PHI);
+}
+
+TEST(MemoryToRegister, PhiPlacement) {
+  struct {
+    PhiPlacement placement;
+    size_t       phi_count;
+  } cases[] = { { PhiPlacement::MINIMAL, 1 },
+                { PhiPlacement::SEMI_PRUNED, 1 },
+                { PhiPlacement::PRUNED, 0 } };
+  for(auto [placement, phi_count]: cases) {
+    FunctionPtr          func = BuildDeadJoin();
+    MemoryToRegisterPass pass(placement);
+    pass.run(func);
+    EXPECT_EQ(CountPhis(*func), phi_count);
+    EXPECT_EQ(pass.statistics().promoted_count, 1);
+    EXPECT_EQ(pass.statistics().phi_count, phi_count);
+    EXPECT_EQ(pass.statistics().avoided_phi_count, 1 - phi_count);
+    // Both returns still see the right store.
+    std::set<const Value*> returned;
+    for(const BasicGroupPtr& group: func->basic_groups_) {
+      SiiIRCode& last = *--group->codes_.end();
+      if(last.kind_ == SiiIRCodeKind::RETURN) {
+        returned.insert(cast<SiiIRReturn>(last).result().value_.get());
+      }
+    }
+    EXPECT_EQ(returned,
+              (std::set<const Value*>{
+                  func->ctx_->constant(1, Type::Integer(32)).get(),
+                  func->ctx_->constant(3, Type::Integer(32)).get() }));
+  }
+}
+
+// x = 0; while(0 < 1) { x = 1; x = x + 1; } return 0;
+// x is stored before every read, so the phi minimal SSA puts in the loop
+// header is not needed.
+TEST(MemoryToRegister, SemiPrunedDropsLocalVariables) {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), {}));
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto zero         = ctx->constant(0, Type::Integer(32));
+  auto one          = ctx->constant(1, Type::Integer(32));
+  auto head_label   = std::make_shared<Label>();
+  auto body_label   = std::make_shared<Label>();
+  auto end_label    = std::make_shared<Label>();
+  auto local        = code_builder->append_alloca(4, Type::Integer(32));
+  code_builder->append_store(zero, local);
+  code_builder->append_label(head_label);
+  code_builder->append_condition_branch(
+      code_builder->append_less_than(zero, one), body_label, end_label);
+  code_builder->append_label(body_label);
+  code_builder->append_store(one, local);
+  code_builder->append_store(
+      code_builder->append_add(code_builder->append_load(local), one), local);
+  code_builder->append_goto(head_label);
+  code_builder->append_label(end_label);
+  code_builder->append_return(zero);
+  FunctionPtr func = code_builder->finish_function(ctx, "f");
+
+  FunctionPtr          minimal = CloneFunction(*func);
+  MemoryToRegisterPass minimal_pass(PhiPlacement::MINIMAL);
+  minimal_pass.run(minimal);
+  EXPECT_EQ(minimal_pass.statistics().phi_count, 1);
+
+  MemoryToRegisterPass semi_pruned_pass(PhiPlacement::SEMI_PRUNED);
+  semi_pruned_pass.run(func);
+  EXPECT_EQ(semi_pruned_pass.statistics().phi_count, 0);
+  EXPECT_EQ(semi_pruned_pass.statistics().avoided_phi_count, 1);
+  EXPECT_EQ(CountPhis(*func), 0);
+  QuitSSAPass().run(func);
+}
+
+// a = parameter; c = 1;
+// if(parameter < 1) { b = a + 1; c = b; }
+// return c;
+TEST(MemoryToRegister, FastPaths) {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), { Type::Integer(32) }));
+  auto parameter = std::make_shared<ParameterValue>(Type::Integer(32));
+  ctx->parameters_.push_back(parameter);
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto one          = ctx->constant(1, Type::Integer(32));
+  auto then_label   = std::make_shared<Label>();
+  auto end_label    = std::make_shared<Label>();
+  auto a            = code_builder->append_alloca(4, Type::Integer(32));
+  auto b            = code_builder->append_alloca(4, Type::Integer(32));
+  auto c            = code_builder->append_alloca(4, Type::Integer(32));
+  code_builder->append_store(parameter, a);
+  code_builder->append_store(one, c);
+  code_builder->append_condition_branch(
+      code_builder->append_less_than(parameter, one), then_label, end_label);
+  code_builder->append_label(then_label);
+  auto sum = code_builder->append_add(code_builder->append_load(a), one);
+  code_builder->append_store(sum, b);
+  code_builder->append_store(code_builder->append_load(b), c);
+  code_builder->append_label(end_label);
+  code_builder->append_return(code_builder->append_load(c));
+  FunctionPtr func = code_builder->finish_function(ctx, "f");
+
+  MemoryToRegisterPass pass;
+  pass.run(func);
+  EXPECT_EQ(pass.statistics().single_store_count, 1);
+  EXPECT_EQ(pass.statistics().single_group_count, 1);
+  EXPECT_EQ(pass.statistics().promoted_count, 1);
+  EXPECT_EQ(CountPhis(*func), 1);
+  EXPECT_EQ(sum->operand(0).value_, parameter);
+  for(const BasicGroupPtr& group: func->basic_groups_) {
+    for(const SiiIRCode& code: group->codes_) {
+      EXPECT_NE(code.kind_, SiiIRCodeKind::ALLOCA);
+      EXPECT_NE(code.kind_, SiiIRCodeKind::LOAD);
+      EXPECT_NE(code.kind_, SiiIRCodeKind::STORE);
+    }
+  }
+  SiiIRPhi& phi = cast<SiiIRPhi>(*func->basic_groups_.back()->codes_.begin());
+  EXPECT_EQ(std::set<const Value*>(
+                { phi.src(0).value_.get(), phi.src(1).value_.get() }),
+            (std::set<const Value*>{ one.get(), sum.get() }));
+}
+
+// loop: x = x + 1; if(x < 10) goto loop; return 0;
+// x is only used in the loop group, but it is read before being stored, so
+// it needs a phi.
+TEST(MemoryToRegister, LoopCarriedSingleGroup) {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), {}));
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto one          = ctx->constant(1, Type::Integer(32));
+  auto ten          = ctx->constant(10, Type::Integer(32));
+  auto loop_label   = std::make_shared<Label>();
+  auto end_label    = std::make_shared<Label>();
+  auto x            = code_builder->append_alloca(4, Type::Integer(32));
+  code_builder->append_goto(loop_label);
+  code_builder->append_label(loop_label);
+  auto sum = code_builder->append_add(code_builder->append_load(x), one);
+  code_builder->append_store(sum, x);
+  code_builder->append_condition_branch(
+      code_builder->append_less_than(sum, ten), loop_label, end_label);
+  code_builder->append_label(end_label);
+  code_builder->append_return(ctx->constant(0, Type::Integer(32)));
+  FunctionPtr func = code_builder->finish_function(ctx, "f");
+
+  MemoryToRegisterPass pass;
+  pass.run(func);
+  EXPECT_EQ(pass.statistics().single_group_count, 0);
+  EXPECT_EQ(pass.statistics().promoted_count, 1);
+  ASSERT_EQ(CountPhis(*func), 1);
+  EXPECT_EQ(sum->operand(0).value_->kind_, ValueKind::INSTRUCTION);
+  EXPECT_EQ(cast<SiiIRCode>(sum->operand(0).value_.get())->kind_,
+            SiiIRCodeKind::PHI);
+}
+
+// x = 0; p = &x; q = &p; **q = parameter; *p = *p + 1; return x;
+// The loads of p and q can only read &x and &p, then p and q are only
+// stored to and x is accessed directly.
+TEST(MemoryToRegister, PointerChain) {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), { Type::Integer(32) }));
+  auto parameter = std::make_shared<ParameterValue>(Type::Integer(32));
+  ctx->parameters_.push_back(parameter);
+  auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+  auto int_type     = Type::Integer(32);
+  auto x            = code_builder->append_alloca(4, int_type);
+  auto p = code_builder->append_alloca(8, Type::Pointer(int_type));
+  auto q = code_builder->append_alloca(
+      8, Type::Pointer(Type::Pointer(int_type)));
+  code_builder->append_store(ctx->constant(0, int_type), x);
+  code_builder->append_store(x, p);
+  code_builder->append_store(p, q);
+  code_builder->append_store(
+      parameter,
+      code_builder->append_load(code_builder->append_load(q)));
+  auto sum = code_builder->append_add(
+      code_builder->append_load(code_builder->append_load(p)),
+      ctx->constant(1, int_type));
+  code_builder->append_store(sum, code_builder->append_load(p));
+  code_builder->append_return(code_builder->append_load(x));
+  FunctionPtr func = code_builder->finish_function(ctx, "f");
+
+  MemoryToRegisterPass pass;
+  pass.run(func);
+  EXPECT_EQ(pass.statistics().resolved_load_count, 4);
+  EXPECT_EQ(pass.statistics().store_only_count, 2);
+  EXPECT_EQ(pass.statistics().single_group_count, 1);
+  EXPECT_EQ(pass.statistics().promoted_count, 0);
+  EXPECT_EQ(CountCodes(*func, SiiIRCodeKind::ALLOCA), 0);
+  EXPECT_EQ(CountCodes(*func, SiiIRCodeKind::LOAD), 0);
+  EXPECT_EQ(CountCodes(*func, SiiIRCodeKind::STORE), 0);
+  EXPECT_EQ(sum->operand(0).value_, parameter);
+}
+
+// x = 0; y = 0; if(parameter < 1) p = &x; else p = &y; *p = 1; return x;
+// p becomes a phi of both addresses, so x and y stay in memory. With y in
+// place of x, p may only point to x and everything is promoted.
+TEST(MemoryToRegister, AddressOnEitherPath) {
+  for(bool same_address: { false, true }) {
+    FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+        Type::Function(Type::Integer(32), { Type::Integer(32) }));
+    auto parameter = std::make_shared<ParameterValue>(Type::Integer(32));
+    ctx->parameters_.push_back(parameter);
+    auto code_builder = CreateFunctionCodeBuilder(ctx->arena_);
+    auto int_type     = Type::Integer(32);
+    auto one          = ctx->constant(1, int_type);
+    auto then_label   = std::make_shared<Label>();
+    auto else_label   = std::make_shared<Label>();
+    auto end_label    = std::make_shared<Label>();
+    auto x            = code_builder->append_alloca(4, int_type);
+    auto y            = code_builder->append_alloca(4, int_type);
+    auto p = code_builder->append_alloca(8, Type::Pointer(int_type));
+    code_builder->append_store(ctx->constant(0, int_type), x);
+    code_builder->append_store(ctx->constant(0, int_type), y);
+    code_builder->append_condition_branch(
+        code_builder->append_less_than(parameter, one),
+        then_label,
+        else_label);
+    code_builder->append_label(then_label);
+    code_builder->append_store(x, p);
+    code_builder->append_goto(end_label);
+    code_builder->append_label(else_label);
+    code_builder->append_store(same_address ? x : y, p);
+    code_builder->append_label(end_label);
+    code_builder->append_store(one, code_builder->append_load(p));
+    auto result = code_builder->append_load(x);
+    code_builder->append_return(result);
+    FunctionPtr func = code_builder->finish_function(ctx, "f");
+
+    MemoryToRegisterPass pass;
+    pass.run(func);
+    const SiiIRCode& last = *--func->basic_groups_.back()->codes_.end();
+    if(same_address) {
+      EXPECT_EQ(pass.statistics().resolved_load_count, 1);
+      EXPECT_EQ(pass.statistics().store_only_count, 2);
+      EXPECT_EQ(CountCodes(*func, SiiIRCodeKind::ALLOCA), 0);
+      EXPECT_EQ(CountCodes(*func, SiiIRCodeKind::LOAD), 0);
+      EXPECT_EQ(CountCodes(*func, SiiIRCodeKind::STORE), 0);
+      EXPECT_EQ(last.operand(0).value_, one);
+    } else {
+      EXPECT_EQ(pass.statistics().resolved_load_count, 0);
+      EXPECT_EQ(pass.statistics().promoted_count, 1);
+      EXPECT_EQ(CountPhis(*func), 1);
+      EXPECT_EQ(CountCodes(*func, SiiIRCodeKind::ALLOCA), 2);
+      EXPECT_EQ(CountCodes(*func, SiiIRCodeKind::STORE), 3);
+      EXPECT_EQ(last.operand(0).value_, result);
+    }
+  }
+}
+
+}  // namespace SiiIR
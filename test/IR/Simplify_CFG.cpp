@@ -0,0 +1,166 @@
+#include "IR/Pass/memory_to_register.h"
+#include "IR/Pass/simplify_CFG.h"
+#include "IR/code_builder.h"
+#include <gtest/gtest.h>
+
+namespace SiiIR {
+
+static size_t CountCodes(const Function& func, SiiIRCodeKind kind) {
+  size_t count = 0;
+  for(const BasicGroupPtr& group: func.basic_groups_) {
+    for(const SiiIRCode& code: group->codes_) {
+      count += code.kind_ == kind;
+    }
+  }
+  return count;
+}
+
+static void ExpectConsistent(const Function& func) {
+  for(const BasicGroupPtr& group: func.basic_groups_) {
+    for(const BasicGroup* follow: group->follows_) {
+      EXPECT_NE(std::find(follow->precedes_.begin(),
+                          follow->precedes_.end(),
+                          group.get()),
+                follow->precedes_.end());
+    }
+    for(const SiiIRCode& code: group->codes_) {
+      EXPECT_EQ(code.group_, group.get());
+      if(code.kind_ == SiiIRCodeKind::PHI) {
+        EXPECT_EQ(cast<SiiIRPhi>(code).src_size(), group->precedes_.size());
+      }
+    }
+  }
+}
+
+TEST(SimplifyCFG, MergeStraightLine) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto code_builder = CreateCodeBuilder(ctx->arena_);
+  code_builder->append_nope();
+  code_builder->append_label(std::make_shared<Label>());
+  code_builder->append_nope();
+  auto label = std::make_shared<Label>();
+  code_builder->append_goto(label);
+  code_builder->append_label(label);
+  code_builder->append_return(ctx->constant(0, Type::Integer(8)));
+  auto codes = code_builder->finish();
+  auto func  = BuildFunction(*codes, ctx, "");
+  EXPECT_EQ(func->basic_groups_.size(), 4);
+
+  SimplifyCFGPass().run(func);
+  ASSERT_EQ(func->basic_groups_.size(), 1);
+  EXPECT_EQ(func->entry_, func->basic_groups_[0].get());
+  EXPECT_EQ(func->entry_->follows_.size(), 0);
+  EXPECT_EQ(func->entry_->codes_.size(), 3LL);
+  EXPECT_EQ(CountCodes(*func, SiiIRCodeKind::GOTO), 0);
+  ExpectConsistent(*func);
+}
+
+TEST(SimplifyCFG, ForwardGotoOnlyGroups) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto code_builder = CreateCodeBuilder(ctx->arena_);
+  auto condition    = ctx->constant(1, Type::Integer(1));
+  auto loop_label   = std::make_shared<Label>();
+  auto body_label   = std::make_shared<Label>();
+  auto hop_label    = std::make_shared<Label>();
+  auto end_label    = std::make_shared<Label>();
+  code_builder->append_label(loop_label);
+  code_builder->append_condition_branch(condition, body_label, end_label);
+  code_builder->append_label(body_label);
+  code_builder->append_goto(hop_label);
+  code_builder->append_label(hop_label);
+  code_builder->append_goto(loop_label);
+  code_builder->append_label(end_label);
+  code_builder->append_nope();
+  auto codes = code_builder->finish();
+  auto func  = BuildFunction(*codes, ctx, "");
+
+  SimplifyCFGPass().run(func);
+  // The entry keeps its goto since the loop header has two predecessors.
+  ASSERT_EQ(func->basic_groups_.size(), 3);
+  BasicGroup* loop = func->entry_->follows_[0];
+  EXPECT_EQ(loop->label_, loop_label);
+  ASSERT_EQ(loop->follows_.size(), 2);
+  EXPECT_EQ(loop->follows_[0], loop);
+  EXPECT_EQ(cast<SiiIRConditionBranch>(*--loop->codes_.end())
+                .true_label()
+                .value_,
+            loop_label);
+  EXPECT_EQ(loop->follows_[1]->label_, end_label);
+  ExpectConsistent(*func);
+}
+
+TEST(SimplifyCFG, FoldBranchToSameGroup) {
+  FunctionContextPtr ctx
+      = std::make_shared<FunctionContext>(Type::Function(Type::Integer(8), {}));
+  auto code_builder = CreateCodeBuilder(ctx->arena_);
+  auto condition    = ctx->constant(1, Type::Integer(1));
+  auto true_label   = std::make_shared<Label>();
+  auto false_label  = std::make_shared<Label>();
+  auto end_label    = std::make_shared<Label>();
+  code_builder->append_condition_branch(condition, true_label, false_label);
+  code_builder->append_label(true_label);
+  code_builder->append_goto(end_label);
+  code_builder->append_label(false_label);
+  code_builder->append_goto(end_label);
+  code_builder->append_label(end_label);
+  code_builder->append_return(ctx->constant(0, Type::Integer(8)));
+  auto codes = code_builder->finish();
+  auto func  = BuildFunction(*codes, ctx, "");
+
+  SimplifyCFGPass().run(func);
+  ASSERT_EQ(func->basic_groups_.size(), 1);
+  EXPECT_EQ(CountCodes(*func, SiiIRCodeKind::CONDITION_BRANCH), 0);
+  EXPECT_EQ(condition->users_.size(), 0);
+  ExpectConsistent(*func);
+}
+
+TEST(SimplifyCFG, KeepPhisInStep) {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), { Type::Integer(32) }));
+  auto parameter = std::make_shared<ParameterValue>(Type::Integer(32));
+  ctx->parameters_.push_back(parameter);
+  auto code_builder = CreateCodeBuilder(ctx->arena_);
+  auto one          = ctx->constant(1, Type::Integer(32));
+  auto true_label   = std::make_shared<Label>();
+  auto false_label  = std::make_shared<Label>();
+  auto end_label    = std::make_shared<Label>();
+  auto address      = code_builder->append_alloca(4, Type::Integer(32));
+  code_builder->append_store(parameter, address);
+  auto less = code_builder->append_less_than(parameter, one);
+  code_builder->append_condition_branch(less, true_label, false_label);
+  code_builder->append_label(true_label);
+  code_builder->append_store(one, address);
+  code_builder->append_goto(end_label);
+  code_builder->append_label(false_label);
+  code_builder->append_goto(end_label);
+  code_builder->append_label(end_label);
+  code_builder->append_return(code_builder->append_load(address));
+  auto codes = code_builder->finish();
+  auto func  = BuildFunction(*codes, ctx, "");
+
+  MemoryToRegisterPass().run(func);
+  ASSERT_EQ(CountCodes(*func, SiiIRCodeKind::PHI), 1);
+  SimplifyCFGPass().run(func);
+  // One empty arm is skipped. The other one stays, else the entry would
+  // reach the end twice with two different phi sources.
+  ASSERT_EQ(func->basic_groups_.size(), 3);
+  BasicGroup* entry = func->entry_;
+  ASSERT_EQ(entry->follows_.size(), 2);
+  BasicGroup* end = entry->follows_[0];
+  EXPECT_EQ(end->label_, end_label);
+  EXPECT_EQ(entry->follows_[1]->follows_[0], end);
+  ASSERT_EQ(end->precedes_.size(), 2);
+  // The true arm, now the direct edge from the entry, stores one.
+  SiiIRPhi& phi = cast<SiiIRPhi>(*end->codes_.begin());
+  for(size_t i = 0; i < end->precedes_.size(); i++) {
+    EXPECT_EQ(phi.src(i).value_,
+              end->precedes_[i] == entry ? one : ValuePtr(parameter));
+  }
+  EXPECT_EQ(
+      cast<SiiIRReturn>(*--end->codes_.end()).result().value_.get(), &phi);
+  ExpectConsistent(*func);
+}
+
+}  // namespace SiiIR
@@ -0,0 +1,43 @@
+#include "IR/type.h"
+#include <gtest/gtest.h>
+
+namespace SiiIR {
+
+TEST(Type, InternBasicTypes) {
+  EXPECT_EQ(Type::Integer(32), Type::Integer(32));
+  EXPECT_NE(Type::Integer(32), Type::Integer(8));
+  EXPECT_EQ(Type::Pointer(Type::Integer(32)), Type::Pointer(Type::Integer(32)));
+  EXPECT_EQ(Type::Pointer(Type::Integer(32), 10),
+            Type::Pointer(Type::Integer(32), 10));
+  EXPECT_NE(Type::Pointer(Type::Integer(32), 10),
+            Type::Pointer(Type::Integer(32), 4));
+  EXPECT_NE(Type::Pointer(Type::Integer(32)),
+            Type::Pointer(Type::Integer(32), 0));
+  EXPECT_EQ(Type::Array(Type::Integer(8), 4), Type::Array(Type::Integer(8), 4));
+  EXPECT_NE(Type::Array(Type::Integer(8), 4), Type::Array(Type::Integer(8), 5));
+}
+
+TEST(Type, InternFunctionTypes) {
+  TypePtr int_type = Type::Integer(32);
+  TypePtr ptr_type = Type::Pointer(int_type);
+  EXPECT_EQ(Type::Function(int_type, {int_type, ptr_type}),
+            Type::Function(int_type, {int_type, ptr_type}));
+  EXPECT_NE(Type::Function(int_type, {int_type, ptr_type}),
+            Type::Function(int_type, {ptr_type, int_type}));
+  EXPECT_NE(Type::Function(int_type, {}), Type::Function(ptr_type, {}));
+  EXPECT_NE(Type::Function(int_type, {int_type}), Type::Function(int_type, {}));
+}
+
+TEST(Type, NoDuplicateTypes) {
+  TypeContext& context = TypeContext::Global();
+  Type::Pointer(Type::Array(Type::Integer(16), 3));
+  size_t size = context.size();
+  for(int i = 0; i < 100; i++) {
+    Type::Pointer(Type::Array(Type::Integer(16), 3));
+  }
+  EXPECT_EQ(context.size(), size);
+  EXPECT_EQ(Type::GetAimType(Type::Pointer(Type::Integer(16))),
+            Type::Integer(16));
+}
+
+}  // namespace SiiIR
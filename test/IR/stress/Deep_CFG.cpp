@@ -0,0 +1,65 @@
+#include "IR/IDF_builder.h"
+#include "IR/Pass/memory_to_register.h"
+#include "IR/code_builder.h"
+#include "IR/dominator_tree.h"
+#include "IR_test_utils.h"
+#include <gtest/gtest.h>
+
+namespace SiiIR {
+
+// Deep enough to overflow the call stack of any walk recursing per group.
+static constexpr size_t kDepth = 1000000;
+
+TEST(DeepCFG, ChainAnalyses) {
+  FunctionPtr func = BuildChainFunction(kDepth);
+
+  const std::vector<BasicGroup*>& reverse_postorder = func->reverse_postorder();
+  ASSERT_EQ(reverse_postorder.size(), kDepth);
+  EXPECT_EQ(reverse_postorder.back(), func->basic_groups_.back().get());
+
+  FrozenFunctionPtr frozen = Freeze(*func);
+  DominatorTreePtr  tree   = BuildDominatorTree(*frozen);
+  ASSERT_EQ(tree->size(), kDepth);
+  EXPECT_EQ(tree->level_[kDepth - 1], kDepth - 1);
+  EXPECT_EQ(tree->immediate_dominator_[kDepth - 1], kDepth - 2);
+  EXPECT_TRUE(tree->dominates(tree->root_, kDepth - 1));
+  EXPECT_EQ(tree->nearest_common_dominator(kDepth - 1, kDepth / 2),
+            kDepth / 2);
+
+  std::unique_ptr<IDFBuilder> idf_builder = CreateIDFBuilder(frozen);
+  EXPECT_TRUE(
+      idf_builder->get_IDF({ func->basic_groups_.back().get() }).empty());
+}
+
+TEST(DeepCFG, BuildAndPromoteChain) {
+  FunctionContextPtr ctx = std::make_shared<FunctionContext>(
+      Type::Function(Type::Integer(32), {}));
+  auto code_builder = CreateCodeBuilder(ctx->arena_);
+  auto address      = code_builder->append_alloca(4, Type::Integer(32));
+  code_builder->append_store(ctx->constant(0, Type::Integer(32)), address);
+  // Every group falls through to the next one with a store on the way.
+  auto one = ctx->constant(1, Type::Integer(32));
+  for(size_t i = 0; i < kDepth; i++) {
+    code_builder->append_label(std::make_shared<Label>());
+    code_builder->append_store(one, address);
+  }
+  code_builder->append_return(code_builder->append_load(address));
+  auto codes = code_builder->finish();
+  auto func  = BuildFunction(*codes, ctx, "");
+  // The entry group, the chain and the group of the first store.
+  ASSERT_EQ(func->basic_groups_.size(), kDepth + 2);
+
+  MemoryToRegisterPass().run(func);
+  BasicGroup* last = func->basic_groups_[0].get();
+  for(const BasicGroupPtr& group: func->basic_groups_) {
+    EXPECT_TRUE(group->codes_.empty()
+                || group->codes_.begin()->kind_ != SiiIRCodeKind::STORE);
+    if(group->follows_.empty()) {
+      last = group.get();
+    }
+  }
+  const SiiIRReturn& result = cast<SiiIRReturn>(*--last->codes_.end());
+  EXPECT_EQ(result.result().value_, ValuePtr(one));
+}
+
+}  // namespace SiiIR
@@ -0,0 +1,59 @@
+#include "utils/arena.h"
+#include <gtest/gtest.h>
+
+namespace SiiIR {
+
+struct Counted {
+  int& counter_;
+  int  payload_[4];
+  Counted(int& counter)
+      : counter_(counter) {
+    ++counter_;
+  }
+  ~Counted() { --counter_; }
+};
+
+TEST(Arena, allocate_aligned) {
+  Arena arena(256);
+  for(size_t alignment: { 1, 2, 4, 8, 16 }) {
+    void* address = arena.allocate(3, alignment);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(address) % alignment, 0);
+  }
+  void* large = arena.allocate(1024, 8);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(large) % 8, 0);
+  EXPECT_EQ(arena.allocated_bytes(), 3 * 5 + 1024);
+}
+
+TEST(Arena, shared_objects_outlive_arena_owner) {
+  int                      counter = 0;
+  std::shared_ptr<Counted> survivor;
+  std::weak_ptr<Arena>     weak_arena;
+  {
+    ArenaPtr arena = CreateArena();
+    weak_arena     = arena;
+    for(int i = 0; i < 100; i++) {
+      auto object = ArenaNew<Counted>(arena, counter);
+      if(i == 50) {
+        survivor = object;
+      }
+    }
+    EXPECT_EQ(counter, 1);
+    EXPECT_GE(arena->allocated_bytes(), 100 * sizeof(Counted));
+  }
+  // The surviving object keeps the arena alive.
+  EXPECT_FALSE(weak_arena.expired());
+  EXPECT_EQ(counter, 1);
+  survivor.reset();
+  EXPECT_EQ(counter, 0);
+  EXPECT_TRUE(weak_arena.expired());
+}
+
+TEST(Arena, heap_fallback) {
+  int  counter = 0;
+  auto object  = ArenaNew<Counted>(nullptr, counter);
+  EXPECT_EQ(counter, 1);
+  object.reset();
+  EXPECT_EQ(counter, 0);
+}
+
+}  // namespace SiiIR
@@ -140,4 +140,77 @@ TEST(List, erase_from_parent) {
   EXPECT_EQ(0, counter);
 }
 
+class RawIntNode : public ListNode<RawIntNode, ListOwnership::kRaw> {
+public:
+  int value_;
+  RawIntNode(int value)
+      : value_(value) {}
+};
+
+TEST(List, raw_ownership) {
+  std::vector<std::unique_ptr<RawIntNode>> nodes;
+  List<RawIntNode, ListOwnership::kRaw>    a;
+  for(int i = 0; i < 10; i++) {
+    nodes.push_back(std::make_unique<RawIntNode>(i));
+    a.push_back(nodes.back().get());
+  }
+  EXPECT_EQ(a.size(), 10);
+  auto iter = a.begin();
+  for(int i = 0; i < 10; i++, ++iter) {
+    EXPECT_EQ(iter->value_, i);
+  }
+  // Destroying a node unlinks it from the list.
+  for(int i = 0; i < 10; i += 2) {
+    nodes[i].reset();
+  }
+  EXPECT_EQ(a.size(), 5);
+  iter = a.begin();
+  for(int i = 1; i < 10; i += 2, ++iter) {
+    EXPECT_EQ(iter->value_, i);
+  }
+  EXPECT_EQ(iter, a.end());
+
+  auto* erased = static_cast<RawIntNode*>(a.erase(a.begin()));
+  EXPECT_EQ(erased, nodes[1].get());
+  EXPECT_EQ(erased->get_parent(), nullptr);
+  EXPECT_EQ(a.size(), 4);
+}
+
+TEST(List, move_reparent) {
+  int counter = 0;
+  {
+    List<IntNode>                         b;
+    std::vector<std::shared_ptr<IntNode>> nodes;
+    {
+      List<IntNode> a;
+      for(int i = 0; i < 10; i++) {
+        nodes.push_back(std::make_shared<IntNode>(i, counter));
+        a.push_back(nodes.back());
+      }
+      b = std::move(a);
+    }
+    for(auto& node: nodes) {
+      EXPECT_EQ(node->get_parent(), &b);
+    }
+    nodes[0]->remove_from_parent();
+    EXPECT_EQ(b.size(), 9);
+    EXPECT_EQ(b.begin()->value_, 1);
+  }
+  EXPECT_EQ(0, counter);
+}
+
+TEST(List, version) {
+  int           counter = 0;
+  List<IntNode> list;
+  uint64_t      version = list.version();
+  auto          node    = std::make_shared<IntNode>(0, counter);
+  list.push_back(node);
+  EXPECT_GT(list.version(), version);
+  version = list.version();
+  EXPECT_EQ(list.begin()->value_, 0);
+  EXPECT_EQ(list.version(), version);
+  list.erase(list.begin());
+  EXPECT_GT(list.version(), version);
+}
+
 }  // namespace SiiIR